@@ -0,0 +1,215 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// Adversarial input benchmark: compares parse throughput on pathological command lines against
+// a typical one. Every scenario is expected to stay within a small constant factor of the
+// typical throughput in bytes per second.
+//
+#include "over9000/cmd_line_args/parser.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+using over9000::cmd_line_args::Char;
+using over9000::cmd_line_args::Error;
+using over9000::cmd_line_args::Limits;
+using over9000::cmd_line_args::OPTIONAL;
+using over9000::cmd_line_args::Parser;
+
+struct CommandLine
+{
+    std::vector<std::basic_string<Char>> strings;
+    std::vector<const Char*> argv;
+    size_t bytes = 0;
+
+    void add(const std::string& arg)
+    {
+        bytes += arg.size() + 1;
+        strings.emplace_back(arg.begin(), arg.end());
+    }
+
+    void finish()
+    {
+        argv.clear();
+        for (const auto& string : strings)
+        {
+            argv.push_back(string.c_str());
+        }
+    }
+};
+
+struct Schema
+{
+    Parser parser{"Adversarial benchmark"};
+    std::vector<std::string> strings;
+    std::vector<int> ints;
+    std::vector<std::string> positional;
+    std::vector<int> values{std::vector<int>(1000)};
+    int enumeration = 0;
+    std::string value;
+
+    explicit Schema(const std::string& namePrefix)
+    {
+        parser.addParam(strings, "strings", 's', "Strings", OPTIONAL);
+        parser.addParam(ints, "ints", 'i', "Integers", OPTIONAL);
+        parser.addParam(value, "value", "Value", OPTIONAL);
+
+        std::map<std::string, int> enumValues;
+        for (int i = 0; i < 10000; ++i)
+        {
+            enumValues.emplace("enum-value-" + std::to_string(i), i);
+        }
+        parser.addParam(enumeration, "enum", "Enumeration", enumValues, OPTIONAL);
+
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            parser.addParam(values[i], namePrefix + std::to_string(i), "Value", OPTIONAL);
+        }
+
+        parser.addPositional(positional, "positional", "Positional", OPTIONAL);
+
+        Limits limits;
+        limits.maxErrorLength = 256;
+        parser.setLimits(limits);
+    }
+};
+
+// Returns bytes per second
+double run(const char* name, Schema& schema, CommandLine& commandLine, bool expectError = false)
+{
+    commandLine.finish();
+    auto argc = static_cast<int>(commandLine.argv.size());
+
+    const auto minDuration = std::chrono::milliseconds(200);
+    size_t iterations = 0;
+    size_t errorLength = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto duration = std::chrono::steady_clock::duration();
+    do
+    {
+        try
+        {
+            schema.parser.parse(argc, commandLine.argv.data());
+        }
+        catch (const Error& e)
+        {
+            if (!expectError)
+            {
+                std::fprintf(stderr, "%s: %s\n", name, e.what());
+                return 0;
+            }
+            errorLength = std::string(e.what()).size();
+        }
+        ++iterations;
+        duration = std::chrono::steady_clock::now() - start;
+    } while (duration < minDuration);
+
+    double seconds = std::chrono::duration<double>(duration).count();
+    double bytesPerSecond = static_cast<double>(commandLine.bytes * iterations) / seconds;
+    std::printf("%-28s %10zu bytes %10.1f us/parse %10.1f MB/s", name, commandLine.bytes,
+                seconds / static_cast<double>(iterations) * 1e6, bytesPerSecond / 1e6);
+    if (expectError)
+    {
+        std::printf("  (error message %zu bytes)", errorLength);
+    }
+    std::printf("\n");
+    return bytesPerSecond;
+}
+
+} // namespace
+
+int main()
+{
+    Schema schema("value-");
+    Schema longPrefixSchema(std::string(4096, 'p'));
+
+    std::vector<std::pair<std::string, double>> results;
+    auto report = [&](const char* name, double bytesPerSecond) {
+        results.emplace_back(name, bytesPerSecond);
+    };
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        for (int i = 0; i < 10000; ++i)
+        {
+            commandLine.add("--strings=value" + std::to_string(i));
+            commandLine.add("-i");
+            commandLine.add(std::to_string(i));
+            commandLine.add("--value-" + std::to_string(i % 1000));
+            commandLine.add(std::to_string(i));
+            commandLine.add("file" + std::to_string(i));
+        }
+        report("typical", run("typical", schema, commandLine));
+    }
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        for (int i = 0; i < 100; ++i)
+        {
+            commandLine.add("--" + std::string(100000, 'n'));
+        }
+        report("long unknown names", run("long unknown names", schema, commandLine));
+    }
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        for (int i = 0; i < 1000; ++i)
+        {
+            commandLine.add("--" + std::string(4096, 'p') + std::to_string(i) + "x");
+        }
+        report("long shared name prefixes",
+               run("long shared name prefixes", longPrefixSchema, commandLine));
+    }
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        commandLine.add("--value=" + std::string(10000000, 'v'));
+        report("huge --x=value", run("huge --x=value", schema, commandLine));
+    }
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        commandLine.add("--enum=" + std::string(100000, 'e'));
+        report("bad enum value", run("bad enum value", schema, commandLine, true));
+    }
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        for (int i = 0; i < 100000; ++i)
+        {
+            commandLine.add("-i");
+            commandLine.add("1");
+        }
+        report("repeated list param", run("repeated list param", schema, commandLine));
+    }
+
+    {
+        CommandLine commandLine;
+        commandLine.add("exe");
+        for (int i = 0; i < 100000; ++i)
+        {
+            commandLine.add("-");
+        }
+        report("tiny tokens", run("tiny tokens", schema, commandLine));
+    }
+
+    std::printf("\nThroughput relative to the typical command line:\n");
+    for (const auto& result : results)
+    {
+        std::printf("%-28s %6.2f\n", result.first.c_str(), result.second / results[0].second);
+    }
+}
@@ -0,0 +1,233 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// Corpus replay benchmark: parses the command lines of a corpus captured by CorpusWriter (see
+// corpus.h) and reports per command line latency percentiles and allocations.
+//
+// Usage: cmd-line-args-bench-replay <corpus file> [rounds]
+//
+// The schema is inferred from the corpus: every --name or -s seen with a value becomes a string
+// list parameter, every other one a flag, and the remaining arguments a positional string list.
+// A real tool schema can be replayed the same way by registering it instead of inferSchema().
+//
+#include "over9000/cmd_line_args/corpus.h"
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size != 0 ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using over9000::cmd_line_args::Char;
+using over9000::cmd_line_args::CorpusRecord;
+using over9000::cmd_line_args::Error;
+using over9000::cmd_line_args::OPTIONAL;
+using over9000::cmd_line_args::Parser;
+using over9000::cmd_line_args::readCorpus;
+
+struct Schema
+{
+    Parser parser{"Corpus replay benchmark"};
+    std::deque<std::vector<std::string>> lists;
+    std::deque<int> flags;
+    std::vector<std::string> positional;
+};
+
+// Whether an argument is classified as a name by the parser
+bool isName(const std::string& arg)
+{
+    return arg.size() >= 2 && arg[0] == '-' && (arg[1] == '-' || arg.size() == 2);
+}
+
+void inferSchema(const std::vector<CorpusRecord>& records, Schema& schema)
+{
+    // Votes of every name for taking a value
+    std::map<std::string, int> names;
+    for (const auto& record : records)
+    {
+        for (size_t i = 0; i < record.args.size(); ++i)
+        {
+            const auto& arg = record.args[i];
+            if (!isName(arg))
+            {
+                continue;
+            }
+
+            auto equalPos = arg.find('=');
+            if (arg[1] == '-' && equalPos != std::string::npos)
+            {
+                ++names[arg.substr(2, equalPos - 2)];
+                continue;
+            }
+
+            auto name = arg[1] == '-' ? arg.substr(2) : arg.substr(1);
+            bool value = i + 1 < record.args.size() && !isName(record.args[i + 1]);
+            names[name] += value ? 1 : -1;
+        }
+    }
+
+    for (const auto& name : names)
+    {
+        auto longName = name.first.size() == 1 ? "short-" + name.first : name.first;
+        char shortName = name.first.size() == 1 ? name.first[0] : '\0';
+        try
+        {
+            if (name.second > 0)
+            {
+                schema.lists.emplace_back();
+                schema.parser.addParam(schema.lists.back(), longName, shortName, "List",
+                                       OPTIONAL);
+            }
+            else
+            {
+                schema.flags.push_back(0);
+                schema.parser.addFlag(schema.flags.back(), longName, shortName, "Flag");
+            }
+        }
+        catch (const Error& e)
+        {
+            std::fprintf(stderr, "Skipped parameter: %s\n", e.what());
+        }
+    }
+
+    schema.parser.addPositional(schema.positional, "positional", "Positional", OPTIONAL);
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <corpus file> [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<CorpusRecord> records;
+    try
+    {
+        records = readCorpus(argv[1]);
+    }
+    catch (const Error& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (records.empty())
+    {
+        std::fprintf(stderr, "Empty corpus: %s\n", argv[1]);
+        return 1;
+    }
+
+    int rounds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 10;
+
+    Schema schema;
+    inferSchema(records, schema);
+
+    // The corpus keeps the arguments in ASCII with '?' for other characters, so they are
+    // widened character by character for a wchar_t Char
+    static const Char exe[] = {'e', 'x', 'e', '\0'};
+    std::deque<std::basic_string<Char>> args;
+    std::vector<std::vector<const Char*>> commandLines;
+    size_t bytes = 0;
+    for (const auto& record : records)
+    {
+        commandLines.emplace_back(1, exe);
+        for (const auto& arg : record.args)
+        {
+            args.emplace_back(arg.begin(), arg.end());
+            commandLines.back().push_back(args.back().c_str());
+            bytes += arg.size() + 1;
+        }
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(records.size() * static_cast<size_t>(rounds));
+    size_t errors = 0;
+    size_t recordedErrors = 0;
+    size_t totalAllocations = 0;
+    size_t maxAllocations = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (size_t i = 0; i < commandLines.size(); ++i)
+        {
+            const auto& commandLine = commandLines[i];
+            bool error = false;
+            size_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            try
+            {
+                schema.parser.parse(static_cast<int>(commandLine.size()), commandLine.data());
+            }
+            catch (const Error&)
+            {
+                error = true;
+            }
+            auto duration = std::chrono::steady_clock::now() - start;
+            size_t parseAllocations = allocations.load(std::memory_order_relaxed) -
+                                      allocationsBefore;
+
+            latencies.push_back(std::chrono::duration<double, std::micro>(duration).count());
+            totalAllocations += parseAllocations;
+            maxAllocations = std::max(maxAllocations, parseAllocations);
+            if (round == 0)
+            {
+                errors += error;
+                recordedErrors += records[i].error;
+            }
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%zu command lines, %zu bytes, %d rounds\n", records.size(), bytes, rounds);
+    std::printf("errors: %zu recorded, %zu replayed\n", recordedErrors, errors);
+    std::printf("latency us: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+                percentile(latencies, 0.5), percentile(latencies, 0.9),
+                percentile(latencies, 0.99), percentile(latencies, 0.999), latencies.back());
+    std::printf("allocations per parse: mean %.1f  max %zu\n",
+                static_cast<double>(totalAllocations) / static_cast<double>(latencies.size()),
+                maxAllocations);
+}
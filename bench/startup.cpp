@@ -0,0 +1,196 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// End-to-end process startup benchmark: repeatedly fork/execs a CLI built on the parser and its
+// getopt_long baseline with 10, 1k and 10k options and reports the median wall time and
+// instructions of each phase:
+// - exec: fork/exec, dynamic loading and static initialization up to main()
+// - register: Parser construction and option registration (struct option table for getopt)
+// - parse: parsing a command line passing every 10th option
+// - exit: from the parsed command line to the reaped process
+//
+// Usage: cmd-line-args-bench-startup [runs]
+//
+#include "startup.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+namespace {
+
+struct Run
+{
+    uint64_t execNs = 0;
+    uint64_t registerNs = 0;
+    uint64_t parseNs = 0;
+    uint64_t exitNs = 0;
+    uint64_t totalNs = 0;
+    uint64_t registerInstructions = 0;
+    uint64_t parseInstructions = 0;
+    uint64_t totalInstructions = 0;
+};
+
+bool runOnce(const char* path, size_t options, const std::vector<std::string>& args, Run& run)
+{
+    int reportPipe[2];
+    if (pipe(reportPipe) != 0)
+    {
+        std::perror("pipe");
+        return false;
+    }
+
+    int goPipe[2];
+    if (pipe(goPipe) != 0)
+    {
+        std::perror("pipe");
+        close(reportPipe[0]);
+        close(reportPipe[1]);
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::perror("fork");
+        for (int fd : {reportPipe[0], reportPipe[1], goPipe[0], goPipe[1]})
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        close(reportPipe[0]);
+        close(goPipe[1]);
+        setenv("CMD_LINE_ARGS_BENCH_FD", std::to_string(reportPipe[1]).c_str(), 1);
+        setenv("CMD_LINE_ARGS_BENCH_OPTIONS", std::to_string(options).c_str(), 1);
+
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(path));
+        for (const auto& arg : args)
+        {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        // Wait until the parent sets up the instruction counter
+        char go = 0;
+        if (read(goPipe[0], &go, 1) != 1)
+        {
+            _exit(1);
+        }
+        execv(path, argv.data());
+        _exit(127);
+    }
+
+    close(reportPipe[1]);
+    close(goPipe[0]);
+
+    startup::InstructionCounter counter(pid);
+    uint64_t startNs = startup::nowNs();
+    if (write(goPipe[1], "1", 1) != 1)
+    {
+        std::perror("write");
+    }
+    close(goPipe[1]);
+
+    std::string report;
+    char buffer[256];
+    ssize_t size = 0;
+    while ((size = read(reportPipe[0], buffer, sizeof(buffer))) > 0)
+    {
+        report.append(buffer, static_cast<size_t>(size));
+    }
+    close(reportPipe[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    uint64_t endNs = startup::nowNs();
+
+    unsigned long long values[5] = {};
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        std::sscanf(report.c_str(), "%llu %llu %llu %llu %llu", &values[0], &values[1],
+                    &values[2], &values[3], &values[4]) != 5)
+    {
+        std::fprintf(stderr, "%s failed\n", path);
+        return false;
+    }
+
+    run.execNs = values[0] - startNs;
+    run.registerNs = values[1] - values[0];
+    run.parseNs = values[2] - values[1];
+    run.exitNs = endNs - values[2];
+    run.totalNs = endNs - startNs;
+    run.registerInstructions = values[3];
+    run.parseInstructions = values[4];
+    run.totalInstructions = counter.read();
+    return true;
+}
+
+template<class Field>
+uint64_t median(std::vector<Run>& runs, Field field)
+{
+    std::sort(runs.begin(), runs.end(),
+              [&](const Run& lhs, const Run& rhs) { return lhs.*field < rhs.*field; });
+    return runs[runs.size() / 2].*field;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t runCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50;
+    if (runCount == 0)
+    {
+        runCount = 1;
+    }
+
+    const std::pair<const char*, const char*> clis[] = {
+        {"parser", CMD_LINE_ARGS_BENCH_CLI},
+        {"getopt_long", CMD_LINE_ARGS_BENCH_GETOPT},
+    };
+
+    std::printf("%-8s %-12s %9s %9s %9s %9s %9s %12s %12s %12s\n", "options", "cli", "exec us",
+                "reg us", "parse us", "exit us", "total us", "reg instr", "parse instr",
+                "total instr");
+
+    for (size_t options : {10, 1000, 10000})
+    {
+        std::vector<std::string> args;
+        for (size_t i = 0; i < options; i += 10)
+        {
+            args.push_back("--" + startup::optionName(i) + "=" + std::to_string(i));
+        }
+
+        for (const auto& cli : clis)
+        {
+            std::vector<Run> runs;
+            for (size_t i = 0; i < runCount; ++i)
+            {
+                Run run;
+                if (!runOnce(cli.second, options, args, run))
+                {
+                    return 1;
+                }
+                runs.push_back(run);
+            }
+
+            std::printf("%-8zu %-12s %9.1f %9.1f %9.1f %9.1f %9.1f %12llu %12llu %12llu\n", options,
+                        cli.first, median(runs, &Run::execNs) / 1e3,
+                        median(runs, &Run::registerNs) / 1e3, median(runs, &Run::parseNs) / 1e3,
+                        median(runs, &Run::exitNs) / 1e3, median(runs, &Run::totalNs) / 1e3,
+                        static_cast<unsigned long long>(median(runs, &Run::registerInstructions)),
+                        static_cast<unsigned long long>(median(runs, &Run::parseInstructions)),
+                        static_cast<unsigned long long>(median(runs, &Run::totalInstructions)));
+        }
+    }
+
+    std::printf("\nInstruction counts are 0 where perf_event_open is not available.\n");
+}
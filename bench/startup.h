@@ -0,0 +1,129 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// Process startup benchmark helpers shared by the driver and the benchmarked CLIs.
+// The CLIs report their phase timestamps and instruction counts to the driver through the file
+// descriptor given in the CMD_LINE_ARGS_BENCH_FD environment variable.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+namespace startup {
+
+inline uint64_t nowNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/// Counts user and kernel instructions of a process with perf_event_open where available.
+///
+class InstructionCounter
+{
+public:
+    /// Counts instructions of the calling process (pid 0) or of another one after it calls exec.
+    explicit InstructionCounter(pid_t pid = 0)
+    {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.exclude_hv = 1;
+        attr.disabled = 1;
+        attr.enable_on_exec = pid != 0 ? 1 : 0;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0));
+        if (fd_ >= 0 && pid == 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#else
+        (void) pid;
+#endif // __linux__
+    }
+
+    ~InstructionCounter()
+    {
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    InstructionCounter(const InstructionCounter&) = delete;
+    InstructionCounter& operator=(const InstructionCounter&) = delete;
+
+    /// Returns the instruction count so far or 0 if not available.
+    uint64_t read() const
+    {
+        uint64_t count = 0;
+        if (fd_ < 0 || ::read(fd_, &count, sizeof(count)) != sizeof(count))
+        {
+            return 0;
+        }
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+/// Phase timestamps and instruction counts reported by a benchmarked CLI.
+///
+struct Phases
+{
+    uint64_t mainNs = 0;       ///< main() entered
+    uint64_t registeredNs = 0; ///< options registered
+    uint64_t parsedNs = 0;     ///< command line parsed
+    uint64_t registerInstructions = 0;
+    uint64_t parseInstructions = 0;
+};
+
+inline size_t optionCount()
+{
+    const char* count = std::getenv("CMD_LINE_ARGS_BENCH_OPTIONS");
+    return count != nullptr ? std::strtoul(count, nullptr, 10) : 10;
+}
+
+inline std::string optionName(size_t index)
+{
+    return "option-" + std::to_string(index);
+}
+
+inline void report(const Phases& phases)
+{
+    const char* fd = std::getenv("CMD_LINE_ARGS_BENCH_FD");
+    if (fd == nullptr)
+    {
+        return;
+    }
+
+    char buffer[256];
+    int size = std::snprintf(buffer, sizeof(buffer), "%llu %llu %llu %llu %llu\n",
+                             static_cast<unsigned long long>(phases.mainNs),
+                             static_cast<unsigned long long>(phases.registeredNs),
+                             static_cast<unsigned long long>(phases.parsedNs),
+                             static_cast<unsigned long long>(phases.registerInstructions),
+                             static_cast<unsigned long long>(phases.parseInstructions));
+    if (write(std::atoi(fd), buffer, static_cast<size_t>(size)) != size)
+    {
+        std::perror("write");
+    }
+}
+
+} // namespace startup
@@ -0,0 +1,39 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// A CLI with CMD_LINE_ARGS_BENCH_OPTIONS integer options built on the parser, see startup.cpp.
+//
+#include "over9000/cmd_line_args/parser.h"
+
+#include "startup.h"
+
+#include <string>
+#include <vector>
+
+int main(int argc, const char* argv[])
+{
+    startup::Phases phases;
+    phases.mainNs = startup::nowNs();
+    startup::InstructionCounter counter;
+
+    over9000::cmd_line_args::Parser parser("Startup benchmark");
+    std::vector<int> values(startup::optionCount());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        parser.addParam(values[i], startup::optionName(i), "Option",
+                        over9000::cmd_line_args::OPTIONAL);
+    }
+
+    phases.registeredNs = startup::nowNs();
+    phases.registerInstructions = counter.read();
+
+    parser.parse(argc, argv);
+
+    phases.parsedNs = startup::nowNs();
+    phases.parseInstructions = counter.read() - phases.registerInstructions;
+
+    startup::report(phases);
+    return 0;
+}
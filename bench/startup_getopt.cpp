@@ -0,0 +1,47 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// The getopt_long baseline of startup_cli.cpp, see startup.cpp.
+//
+#include "startup.h"
+
+#include <cstdlib>
+#include <getopt.h>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    startup::Phases phases;
+    phases.mainNs = startup::nowNs();
+    startup::InstructionCounter counter;
+
+    std::vector<int> values(startup::optionCount());
+    std::vector<std::string> names;
+    names.reserve(values.size());
+    std::vector<option> options;
+    options.reserve(values.size() + 1);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        names.push_back(startup::optionName(i));
+        options.push_back({names.back().c_str(), required_argument, nullptr, 0});
+    }
+    options.push_back({nullptr, 0, nullptr, 0});
+
+    phases.registeredNs = startup::nowNs();
+    phases.registerInstructions = counter.read();
+
+    int index = 0;
+    while (getopt_long(argc, argv, "", options.data(), &index) == 0)
+    {
+        values[static_cast<size_t>(index)] = std::atoi(optarg);
+    }
+
+    phases.parsedNs = startup::nowNs();
+    phases.parseInstructions = counter.read() - phases.registerInstructions;
+
+    startup::report(phases);
+    return 0;
+}
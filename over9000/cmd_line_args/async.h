@@ -0,0 +1,182 @@
+// Command line argument parser: asynchronous converters
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Converts values of any type with the default converter
+struct DefaultConverter
+{
+    template<class T>
+    auto operator()(std::basic_istream<Char>& stream, T& value)
+        -> decltype(std::declval<std::basic_istream<Char>&>() >> value, void())
+    {
+        Converter<T>()(stream, value);
+    }
+
+    std::string getValidValues() const { return {}; }
+};
+
+// Number of std::async threads running default asynchronous conversions
+inline std::atomic<unsigned>& asyncThreadCount()
+{
+    static std::atomic<unsigned> count{0};
+    return count;
+}
+
+inline unsigned maxAsyncThreads()
+{
+    static const unsigned max = std::max(2u, std::thread::hardware_concurrency());
+    return max;
+}
+
+template<class T, class Converter>
+class AsyncValueImpl : public AsyncValue<T>
+{
+public:
+    AsyncValueImpl(std::shared_ptr<Converter> converter, const Char* begin, const Char* end,
+                   const Executor& executor)
+        : state_(std::make_shared<State>(begin, end))
+    {
+        // The task shares the state and the converter, so it may outlive this object and the
+        // parser, e.g. when queued to an executor that is shutting down
+        auto task = std::make_shared<std::packaged_task<bool()>>(
+            [state = state_, converter = std::move(converter)] {
+                if (state->cancelled)
+                {
+                    return false;
+                }
+                std::basic_stringstream<Char> stream;
+                return convert(*converter, state->arg.data(),
+                               state->arg.data() + state->arg.size(), stream, state->value);
+            });
+        result_ = task->get_future();
+
+        if (executor)
+        {
+            executor([task] { (*task)(); });
+            return;
+        }
+
+        // Past maxAsyncThreads() conversions run on the parsing thread
+        auto& threadCount = asyncThreadCount();
+        if (threadCount.fetch_add(1) < maxAsyncThreads())
+        {
+            thread_ = std::async(std::launch::async, [task, &threadCount] {
+                (*task)();
+                --threadCount;
+            });
+        }
+        else
+        {
+            --threadCount;
+            (*task)();
+        }
+    }
+
+    ~AsyncValueImpl() override
+    {
+        // A conversion not started yet is skipped, one running on an executor is not waited for
+        state_->cancelled = true;
+    }
+
+    bool get(T& value) override
+    {
+        if (!result_.get())
+        {
+            return false;
+        }
+        value = std::move(state_->value);
+        return true;
+    }
+
+private:
+    struct State
+    {
+        State(const Char* begin, const Char* end) : arg(begin, end) {}
+
+        std::basic_string<Char> arg;
+        T value{};
+        std::atomic<bool> cancelled{false};
+    };
+
+    std::shared_ptr<State> state_;
+    std::future<bool> result_;
+    std::future<void> thread_; // Joins a default conversion thread
+};
+
+template<class Converter>
+struct AsyncConverter
+{
+    template<class T>
+    typename std::enable_if<CanConvert<Converter, T>::value, bool>::type operator()(
+        const Char* begin, const Char* end, T& value)
+    {
+        std::basic_stringstream<Char> stream;
+        return convert(*converter, begin, end, stream, value);
+    }
+
+    template<class T>
+    typename std::enable_if<CanConvert<Converter, T>::value, std::unique_ptr<AsyncValue<T>>>::type
+    launch(const Char* begin, const Char* end, const Executor& executor)
+    {
+        return std::make_unique<AsyncValueImpl<T, Converter>>(converter, begin, end, executor);
+    }
+
+    std::string getValidValues() const { return converter->getValidValues(); }
+
+    std::string getValidValues(size_t maxLength) const
+    {
+        return details::getTruncatedValidValues(*converter, maxLength);
+    }
+
+    std::string describeError(const Char* begin, const Char* end) const
+    {
+        return details::describeError(*converter, begin, end);
+    }
+
+    std::shared_ptr<Converter> converter; // Shared with the running conversions
+};
+
+} // namespace details
+
+/// Returns a converter running the given one asynchronously, so that expensive conversions
+/// (e.g. loading a file) run concurrently. Parser::parse() joins them before returning.
+/// The converter may be called concurrently for several arguments.
+/// E.g. parser.addParam(manifest, "manifest", "Manifest", async(ManifestConverter()));
+/// Without an executor (see Parser::setExecutor()) a conversion runs on a std::async thread,
+/// at most as many at once as there are hardware threads, and otherwise on the parsing thread.
+/// Conversions not joined, e.g. those after a bad argument, are cancelled: ones not started
+/// yet are skipped, and none is waited for except on the default threads.
+///
+template<class Converter>
+details::AsyncConverter<Converter> async(Converter converter)
+{
+    return {std::make_shared<Converter>(std::move(converter))};
+}
+
+/// Returns a converter running the default converter (operator>>) asynchronously.
+///
+inline details::AsyncConverter<details::DefaultConverter> async()
+{
+    return async(details::DefaultConverter());
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
@@ -0,0 +1,286 @@
+// Command line argument parser: byte string converters
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OVER9000_CMD_LINE_ARGS_SSE2 1
+#endif
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Byte string targets: std::vector<uint8_t> of any size or std::array<uint8_t, N> of exactly N.
+// resize() sizes the target and returns false on a size mismatch.
+
+template<class T>
+struct ByteTarget
+{
+};
+
+template<>
+struct ByteTarget<std::vector<uint8_t>>
+{
+    static bool resize(std::vector<uint8_t>& value, size_t size)
+    {
+        value.resize(size);
+        return true;
+    }
+};
+
+template<size_t N>
+struct ByteTarget<std::array<uint8_t, N>>
+{
+    static bool resize(std::array<uint8_t, N>&, size_t size) { return size == N; }
+};
+
+// Returns the hex digit value or a value above 0xf for a bad character
+inline uint32_t hexDigit(Char c)
+{
+    uint32_t digit = static_cast<uint32_t>(c) - '0';
+    uint32_t letter = (static_cast<uint32_t>(c) | 0x20) - 'a';
+    return digit < 10 ? digit : (letter < 6 ? letter + 10 : 0x100);
+}
+
+// Returns the base64 digit value or a value above 0x3f for a bad character
+inline uint32_t base64Digit(Char c)
+{
+    uint32_t u = static_cast<uint32_t>(c);
+    if (u - 'A' < 26)
+    {
+        return u - 'A';
+    }
+    if (u - 'a' < 26)
+    {
+        return u - 'a' + 26;
+    }
+    if (u - '0' < 10)
+    {
+        return u - '0' + 52;
+    }
+    return u == '+' ? 62 : (u == '/' ? 63 : 0x100);
+}
+
+#if defined(OVER9000_CMD_LINE_ARGS_SSE2) && !defined(_WIN32)
+
+// Decodes 16 hex characters into 8 bytes, returns false on a bad character
+inline bool decodeHex16(const char* src, uint8_t* dst)
+{
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+
+    const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+
+    const __m128i letters = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)),
+                                         _mm_set1_epi8('a'));
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff)
+    {
+        return false;
+    }
+
+    const __m128i nibbles =
+        _mm_or_si128(_mm_and_si128(digits, isDigit),
+                     _mm_and_si128(_mm_add_epi8(letters, _mm_set1_epi8(10)), isLetter));
+
+    // Each 16-bit lane holds the high nibble in its low byte and the low nibble in its high byte
+    const __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0xff)), 4);
+    const __m128i low = _mm_srli_epi16(nibbles, 8);
+    const __m128i bytes = _mm_packus_epi16(_mm_or_si128(high, low), _mm_setzero_si128());
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), bytes);
+    return true;
+}
+
+#endif
+
+inline bool decodeHex(const Char* begin, const Char* end, uint8_t* dst)
+{
+#if defined(OVER9000_CMD_LINE_ARGS_SSE2) && !defined(_WIN32)
+    for (; end - begin >= 16; begin += 16, dst += 8)
+    {
+        if (!decodeHex16(begin, dst))
+        {
+            return false;
+        }
+    }
+#endif
+
+    uint32_t error = 0;
+    for (; begin != end; begin += 2, ++dst)
+    {
+        uint32_t high = hexDigit(begin[0]);
+        uint32_t low = hexDigit(begin[1]);
+        error |= high | low;
+        *dst = static_cast<uint8_t>((high << 4) | (low & 0xf));
+    }
+    return error <= 0xf;
+}
+
+inline size_t base64DecodedSize(const Char* begin, const Char* end)
+{
+    size_t size = static_cast<size_t>(end - begin);
+    if (size % 4 == 1)
+    {
+        return static_cast<size_t>(-1);
+    }
+    return size / 4 * 3 + (size % 4 == 0 ? 0 : size % 4 - 1);
+}
+
+// Decodes unpadded base64 characters
+inline bool decodeBase64(const Char* begin, const Char* end, uint8_t* dst)
+{
+    uint32_t error = 0;
+    for (; end - begin >= 4; begin += 4, dst += 3)
+    {
+        uint32_t d0 = base64Digit(begin[0]);
+        uint32_t d1 = base64Digit(begin[1]);
+        uint32_t d2 = base64Digit(begin[2]);
+        uint32_t d3 = base64Digit(begin[3]);
+        error |= d0 | d1 | d2 | d3;
+        uint32_t bits = (d0 << 18) | (d1 << 12) | (d2 << 6) | d3;
+        dst[0] = static_cast<uint8_t>(bits >> 16);
+        dst[1] = static_cast<uint8_t>(bits >> 8);
+        dst[2] = static_cast<uint8_t>(bits);
+    }
+
+    if (begin != end)
+    {
+        // 2 or 3 trailing characters, the unused low bits must be zero
+        uint32_t d0 = base64Digit(begin[0]);
+        uint32_t d1 = base64Digit(begin[1]);
+        uint32_t d2 = end - begin == 3 ? base64Digit(begin[2]) : 0;
+        error |= d0 | d1 | d2;
+        uint32_t bits = (d0 << 18) | (d1 << 12) | (d2 << 6);
+        dst[0] = static_cast<uint8_t>(bits >> 16);
+        if (end - begin == 3)
+        {
+            dst[1] = static_cast<uint8_t>(bits >> 8);
+            error |= (bits & 0xff) << 8;
+        }
+        else
+        {
+            error |= (bits & 0xffff) << 8;
+        }
+    }
+    return error <= 0x3f;
+}
+
+struct HexConverter
+{
+    template<class T>
+    auto operator()(const Char* begin, const Char* end, T& value) const
+        -> decltype(ByteTarget<T>::resize(value, 0))
+    {
+        size_t size = static_cast<size_t>(end - begin);
+        if (size % 2 != 0)
+        {
+            return false;
+        }
+
+        return ByteTarget<T>::resize(value, size / 2) && decodeHex(begin, end, value.data());
+    }
+
+    std::string getValidValues() const { return {}; }
+};
+
+struct Base64Converter
+{
+    template<class T>
+    auto operator()(const Char* begin, const Char* end, T& value) const
+        -> decltype(ByteTarget<T>::resize(value, 0))
+    {
+        // Optional padding
+        if ((end - begin) % 4 == 0)
+        {
+            for (int i = 0; i < 2 && end != begin && end[-1] == '='; ++i)
+            {
+                --end;
+            }
+        }
+
+        size_t size = base64DecodedSize(begin, end);
+        if (size == static_cast<size_t>(-1))
+        {
+            return false;
+        }
+
+        return ByteTarget<T>::resize(value, size) && decodeBase64(begin, end, value.data());
+    }
+
+    std::string getValidValues() const { return {}; }
+};
+
+struct PrefixedBytesConverter
+{
+    template<class T>
+    auto operator()(const Char* begin, const Char* end, T& value) const
+        -> decltype(ByteTarget<T>::resize(value, 0))
+    {
+        if (hasPrefix(begin, end, "hex:"))
+        {
+            return HexConverter()(begin + 4, end, value);
+        }
+        if (hasPrefix(begin, end, "b64:"))
+        {
+            return Base64Converter()(begin + 4, end, value);
+        }
+        return false;
+    }
+
+    std::string getValidValues() const { return "hex:<hex digits>, b64:<base64 digits>"; }
+
+private:
+    static bool hasPrefix(const Char* begin, const Char* end, const char* prefix)
+    {
+        for (; *prefix != '\0'; ++begin, ++prefix)
+        {
+            if (begin == end || *begin != static_cast<Char>(*prefix))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace details
+
+/// Returns a converter of hex strings into std::vector<uint8_t> or std::array<uint8_t, N> values.
+/// E.g. parser.addParam(key, "key", "Key", hex());
+///
+inline details::HexConverter hex()
+{
+    return {};
+}
+
+/// Returns a converter of base64 strings (optionally padded) into std::vector<uint8_t> or
+/// std::array<uint8_t, N> values.
+///
+inline details::Base64Converter base64()
+{
+    return {};
+}
+
+/// Returns a converter of "hex:"/"b64:" prefixed strings into std::vector<uint8_t> or
+/// std::array<uint8_t, N> values.
+///
+inline details::PrefixedBytesConverter bytes()
+{
+    return {};
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
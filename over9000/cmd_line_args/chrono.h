@@ -0,0 +1,404 @@
+// Command line argument parser: ISO-8601 date and time converters
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Parses count digits, sets bad to non-zero on a non-digit
+inline uint32_t parseDigits(const Char* p, size_t count, uint32_t& bad)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t digit = static_cast<uint32_t>(p[i]) - '0';
+        bad |= digit > 9;
+        value = value * 10 + digit;
+    }
+    return value;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+inline int64_t daysFromCivil(int64_t year, uint32_t month, uint32_t day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    auto yearOfEra = static_cast<uint32_t>(year - era * 400);
+    uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+// Inverse of daysFromCivil()
+inline void civilFromDays(int64_t days, int64_t& year, uint32_t& month, uint32_t& day)
+{
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    auto dayOfEra = static_cast<uint32_t>(days - era * 146097);
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// Parses YYYY-MM-DD into the days since 1970-01-01
+inline bool parseDate(const Char*& p, const Char* end, int64_t& days)
+{
+    if (end - p < 10)
+    {
+        return false;
+    }
+
+    uint32_t bad = (p[4] != '-') | (p[7] != '-');
+    uint32_t year = parseDigits(p, 4, bad);
+    uint32_t month = parseDigits(p + 5, 2, bad);
+    uint32_t day = parseDigits(p + 8, 2, bad);
+    if (bad != 0 || month - 1 >= 12)
+    {
+        return false;
+    }
+
+    static const uint8_t DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    uint32_t monthDays = DAYS_IN_MONTH[month - 1] + (month == 2 && leap);
+    if (day - 1 >= monthDays)
+    {
+        return false;
+    }
+
+    days = daysFromCivil(year, month, day);
+    p += 10;
+    return true;
+}
+
+// Parses HH:MM[:SS[.fraction]] with up to 9 fraction digits after '.' or ','
+inline bool parseTime(const Char*& p, const Char* end, int64_t& seconds, uint32_t& nanoseconds)
+{
+    if (end - p < 5)
+    {
+        return false;
+    }
+
+    uint32_t bad = p[2] != ':';
+    uint32_t hour = parseDigits(p, 2, bad);
+    uint32_t minute = parseDigits(p + 3, 2, bad);
+    uint32_t second = 0;
+    bool hasSeconds = false;
+    p += 5;
+
+    if (end - p >= 3 && *p == ':')
+    {
+        second = parseDigits(p + 1, 2, bad);
+        hasSeconds = true;
+        p += 3;
+    }
+
+    // A fraction of minutes, e.g. 12:30.5, is left unparsed and so rejected
+    nanoseconds = 0;
+    if (hasSeconds && end - p >= 2 && (*p == '.' || *p == ','))
+    {
+        ++p;
+        size_t count = 0;
+        while (p + count != end && count < 10 && static_cast<uint32_t>(p[count]) - '0' <= 9)
+        {
+            ++count;
+        }
+        if (count == 0 || count > 9)
+        {
+            return false;
+        }
+
+        static const uint32_t SCALE[] = {1,      10,      100,      1000,      10000,
+                                         100000, 1000000, 10000000, 100000000, 1000000000};
+        nanoseconds = parseDigits(p, count, bad) * SCALE[9 - count];
+        p += count;
+    }
+
+    if (bad != 0 || hour > 23 || minute > 59 || second > 59)
+    {
+        return false;
+    }
+
+    seconds = hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+// Parses Z or +HH:MM, +HHMM, +HH or the same with '-' into the seconds east of UTC
+inline bool parseOffset(const Char*& p, const Char* end, int64_t& seconds)
+{
+    if (end - p == 1 && (*p == 'Z' || *p == 'z'))
+    {
+        seconds = 0;
+        ++p;
+        return true;
+    }
+
+    auto size = end - p;
+    if ((size != 3 && size != 5 && size != 6) || (*p != '+' && *p != '-'))
+    {
+        return false;
+    }
+
+    uint32_t bad = 0;
+    uint32_t hours = parseDigits(p + 1, 2, bad);
+    uint32_t minutes = 0;
+    if (size == 5)
+    {
+        minutes = parseDigits(p + 3, 2, bad);
+    }
+    else if (size == 6)
+    {
+        bad |= p[3] != ':';
+        minutes = parseDigits(p + 4, 2, bad);
+    }
+    if (bad != 0 || hours > 23 || minutes > 59)
+    {
+        return false;
+    }
+
+    seconds = (*p == '-' ? -1 : 1) * static_cast<int64_t>(hours * 3600 + minutes * 60);
+    p = end;
+    return true;
+}
+
+// Converts the seconds and nanoseconds to a floating point duration, returns false if it
+// cannot hold them
+template<class Rep, class Period>
+bool toDuration(int64_t seconds, uint32_t nanoseconds, std::chrono::duration<Rep, Period>& value,
+                std::true_type)
+{
+    using Duration = std::chrono::duration<Rep, Period>;
+    using Seconds = std::chrono::duration<double>;
+    auto max = std::chrono::duration_cast<Seconds>(Duration::max()).count();
+    auto min = std::chrono::duration_cast<Seconds>(Duration::min()).count();
+    if (static_cast<double>(seconds) >= max || static_cast<double>(seconds) <= min)
+    {
+        return false;
+    }
+
+    value = std::chrono::duration_cast<Duration>(std::chrono::seconds(seconds)) +
+            std::chrono::duration_cast<Duration>(std::chrono::nanoseconds(nanoseconds));
+    return true;
+}
+
+// Converts the seconds and nanoseconds to an integral duration in integer arithmetic, returns
+// false if it cannot hold their sum. A fraction below the duration period is truncated.
+template<class Rep, class Period>
+bool toDuration(int64_t seconds, uint32_t nanoseconds, std::chrono::duration<Rep, Period>& value,
+                std::false_type)
+{
+    using Duration = std::chrono::duration<Rep, Period>;
+    using Ticks = std::chrono::duration<intmax_t, Period>;
+    using PerSecond = std::ratio_divide<std::ratio<1>, Period>;
+
+    intmax_t fraction =
+        std::chrono::duration_cast<Ticks>(std::chrono::nanoseconds(nanoseconds)).count();
+
+    // A negative time with a fraction is taken as the next second minus the rest of the
+    // fraction, so that the seconds of the lowest time of the duration fit in it as well
+    if (PerSecond::den == 1 && seconds < 0 && fraction > 0)
+    {
+        ++seconds;
+        fraction -= PerSecond::num;
+    }
+
+    // The ticks of the seconds are seconds * PerSecond::num / PerSecond::den
+    const intmax_t limit = INTMAX_MAX / PerSecond::num;
+    if (seconds > limit || seconds < -limit)
+    {
+        return false;
+    }
+    intmax_t ticks = static_cast<intmax_t>(seconds) * PerSecond::num / PerSecond::den;
+
+    auto max = static_cast<intmax_t>(Duration::max().count());
+    auto min = static_cast<intmax_t>(Duration::min().count());
+    if (ticks > max || ticks < min || (fraction > 0 && ticks > max - fraction) ||
+        (fraction < 0 && ticks < min - fraction))
+    {
+        return false;
+    }
+
+    value = Duration(static_cast<Rep>(ticks + fraction));
+    return true;
+}
+
+template<class Rep, class Period>
+bool toDuration(int64_t seconds, uint32_t nanoseconds, std::chrono::duration<Rep, Period>& value)
+{
+    return toDuration(seconds, nanoseconds, value,
+                      std::integral_constant<bool, std::is_floating_point<Rep>::value>());
+}
+
+struct TimestampConverter
+{
+    template<class Duration>
+    bool operator()(const Char* begin, const Char* end,
+                    std::chrono::time_point<std::chrono::system_clock, Duration>& value) const
+    {
+        int64_t days = 0;
+        int64_t seconds = 0;
+        uint32_t nanoseconds = 0;
+        int64_t offset = 0;
+        if (!parseDate(begin, end, days))
+        {
+            return false;
+        }
+
+        // A date alone is its midnight in UTC
+        if (begin != end)
+        {
+            if ((*begin != 'T' && *begin != 't' && *begin != ' ') ||
+                !parseTime(++begin, end, seconds, nanoseconds) ||
+                !parseOffset(begin, end, offset))
+            {
+                return false;
+            }
+        }
+
+        Duration duration;
+        if (!toDuration(days * 86400 + seconds - offset, nanoseconds, duration))
+        {
+            return false;
+        }
+        value = std::chrono::time_point<std::chrono::system_clock, Duration>(duration);
+        return true;
+    }
+
+    std::string getValidValues() const
+    {
+        return "ISO-8601 dates or UTC offset times, e.g. 2024-06-01 or 2024-06-01T12:30:00.5Z";
+    }
+};
+
+struct DateConverter
+{
+    template<class Duration>
+    bool operator()(const Char* begin, const Char* end,
+                    std::chrono::time_point<std::chrono::system_clock, Duration>& value) const
+    {
+        int64_t days = 0;
+        Duration duration;
+        if (!parseDate(begin, end, days) || begin != end || !toDuration(days * 86400, 0, duration))
+        {
+            return false;
+        }
+        value = std::chrono::time_point<std::chrono::system_clock, Duration>(duration);
+        return true;
+    }
+
+    std::string getValidValues() const { return "ISO-8601 dates, e.g. 2024-06-01"; }
+};
+
+struct TimeOfDayConverter
+{
+    template<class Rep, class Period>
+    bool operator()(const Char* begin, const Char* end,
+                    std::chrono::duration<Rep, Period>& value) const
+    {
+        int64_t seconds = 0;
+        uint32_t nanoseconds = 0;
+        return parseTime(begin, end, seconds, nanoseconds) && begin == end &&
+               toDuration(seconds, nanoseconds, value);
+    }
+
+    std::string getValidValues() const { return "ISO-8601 times of day, e.g. 12:30 or 12:30:00.5"; }
+};
+
+template<>
+struct Converter<std::chrono::system_clock::time_point> : TimestampConverter
+{
+};
+
+// Writes a time point as an ISO-8601 UTC time
+template<class Duration>
+struct ValueWriter<std::chrono::time_point<std::chrono::system_clock, Duration>>
+{
+    static void write(std::string& buffer,
+                      const std::chrono::time_point<std::chrono::system_clock, Duration>& value,
+                      bool json)
+    {
+        auto nanoseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(value.time_since_epoch()).count();
+        int64_t seconds = nanoseconds / 1000000000;
+        int64_t fraction = nanoseconds % 1000000000;
+        if (fraction < 0)
+        {
+            --seconds;
+            fraction += 1000000000;
+        }
+        int64_t days = (seconds >= 0 ? seconds : seconds - 86399) / 86400;
+        int64_t daySeconds = seconds - days * 86400;
+
+        int64_t year = 0;
+        uint32_t month = 0;
+        uint32_t day = 0;
+        civilFromDays(days, year, month, day);
+
+        char text[40];
+        int size = std::snprintf(text, sizeof(text), "%04lld-%02u-%02uT%02u:%02u:%02u",
+                                 static_cast<long long>(year), month, day,
+                                 static_cast<unsigned>(daySeconds / 3600),
+                                 static_cast<unsigned>(daySeconds / 60 % 60),
+                                 static_cast<unsigned>(daySeconds % 60));
+        if (fraction != 0)
+        {
+            int digits = 9;
+            while (fraction % 10 == 0)
+            {
+                fraction /= 10;
+                --digits;
+            }
+            size += std::snprintf(text + size, sizeof(text) - static_cast<size_t>(size), ".%0*lld",
+                                  digits, static_cast<long long>(fraction));
+        }
+        text[size++] = 'Z';
+        appendString(buffer, text, text + size, json);
+    }
+};
+
+} // namespace details
+
+/// Returns a converter of ISO-8601 dates or times with a UTC offset into
+/// std::chrono::time_point<std::chrono::system_clock, D> values, e.g. 2024-06-01T00:00:00Z,
+/// 2024-06-01 12:30:00.25+02:00 or 2024-06-01 for its midnight in UTC. It is the default
+/// converter of std::chrono::system_clock::time_point values. A fraction below the period of
+/// D is truncated, a time out of its range is a bad value.
+///
+inline details::TimestampConverter timestamp()
+{
+    return {};
+}
+
+/// Returns a converter of ISO-8601 dates, e.g. 2024-06-01, into their midnights in UTC as
+/// std::chrono::time_point<std::chrono::system_clock, D> values.
+///
+inline details::DateConverter date()
+{
+    return {};
+}
+
+/// Returns a converter of ISO-8601 times of day, e.g. 12:30 or 12:30:00.25, into
+/// std::chrono::duration values since midnight.
+///
+inline details::TimeOfDayConverter timeOfDay()
+{
+    return {};
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
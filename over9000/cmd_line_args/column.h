@@ -0,0 +1,249 @@
+// Command line argument parser: string column list targets
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+
+/// List of strings kept in one character buffer with an array of offsets, a list parameter
+/// target for large string lists, e.g. of file paths:
+///     StringColumn files;
+///     parser.addPositional(files, "files", "Files");
+///     for (auto file : files) ...
+/// The arguments are appended to the buffer directly without a string per element. With
+/// interning a repeated string refers to the characters of its first occurrence.
+///
+class StringColumn
+{
+public:
+    /// Characters of an element, valid until the column is modified.
+    ///
+    class View
+    {
+    public:
+        View() = default;
+        View(const Char* data, size_t size) : data_(data), size_(size) {}
+
+        const Char* data() const { return data_; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        const Char* begin() const { return data_; }
+        const Char* end() const { return data_ + size_; }
+
+        std::basic_string<Char> str() const { return {data_, size_}; }
+
+        friend bool operator==(View lhs, View rhs)
+        {
+            return lhs.size_ == rhs.size_ &&
+                   (lhs.size_ == 0 ||
+                    std::char_traits<Char>::compare(lhs.data_, rhs.data_, lhs.size_) == 0);
+        }
+
+        friend bool operator!=(View lhs, View rhs) { return !(lhs == rhs); }
+
+    private:
+        const Char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = View;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const View*;
+        using reference = View;
+
+        Iterator(const StringColumn* column, size_t index) : column_(column), index_(index) {}
+
+        View operator*() const { return (*column_)[index_]; }
+
+        Iterator& operator++()
+        {
+            ++index_;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator result = *this;
+            ++index_;
+            return result;
+        }
+
+        friend bool operator==(Iterator lhs, Iterator rhs) { return lhs.index_ == rhs.index_; }
+        friend bool operator!=(Iterator lhs, Iterator rhs) { return lhs.index_ != rhs.index_; }
+
+    private:
+        const StringColumn* column_;
+        size_t index_;
+    };
+
+    using value_type = View;
+    using const_iterator = Iterator;
+
+    explicit StringColumn(bool interning = false) : interning_(interning) {}
+
+    void push_back(View value) { push_back(value.data(), value.size()); }
+
+    void push_back(const std::basic_string<Char>& value) { push_back(value.data(), value.size()); }
+
+    void push_back(const Char* data, size_t size)
+    {
+        if (!interning_)
+        {
+            entries_.push_back({chars_.size(), size});
+            chars_.append(data, size);
+            return;
+        }
+
+        if (2 * (uniqueCount_ + 1) > index_.size())
+        {
+            rehash(index_.empty() ? 64 : index_.size() * 2);
+        }
+
+        size_t hash = hashChars(data, size);
+        size_t& slot = index_[findSlot(hash, View(data, size))];
+        if (slot != 0)
+        {
+            entries_.push_back(entries_[slot - 1]);
+            hashes_.push_back(hash);
+            return;
+        }
+
+        slot = entries_.size() + 1;
+        ++uniqueCount_;
+        entries_.push_back({chars_.size(), size});
+        hashes_.push_back(hash);
+        chars_.append(data, size);
+    }
+
+    View operator[](size_t i) const
+    {
+        const Entry& entry = entries_[i];
+        return {chars_.data() + entry.offset, entry.size};
+    }
+
+    Iterator begin() const { return {this, 0}; }
+    Iterator end() const { return {this, entries_.size()}; }
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    /// Returns the number of characters kept for all elements.
+    ///
+    size_t charCount() const { return chars_.size(); }
+
+    void reserve(size_t size, size_t charCount)
+    {
+        entries_.reserve(size);
+        chars_.reserve(charCount);
+    }
+
+    /// Removes all elements keeping the memory for reuse.
+    ///
+    void clear()
+    {
+        entries_.clear();
+        chars_.clear();
+        hashes_.clear();
+        std::fill(index_.begin(), index_.end(), 0);
+        uniqueCount_ = 0;
+    }
+
+private:
+    struct Entry
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    static size_t hashChars(const Char* data, size_t size)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<uint64_t>(data[i])) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    // Returns the slot of an equal element or an empty slot for it
+    size_t findSlot(size_t hash, View value) const
+    {
+        size_t mask = index_.size() - 1;
+        size_t i = hash & mask;
+        for (; index_[i] != 0; i = (i + 1) & mask)
+        {
+            size_t entry = index_[i] - 1;
+            if (hashes_[entry] == hash && (*this)[entry] == value)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+
+    void rehash(size_t size)
+    {
+        index_.assign(size, 0);
+        for (size_t entry = 0; entry < entries_.size(); ++entry)
+        {
+            size_t& slot = index_[findSlot(hashes_[entry], (*this)[entry])];
+            if (slot == 0)
+            {
+                slot = entry + 1;
+            }
+        }
+    }
+
+    bool interning_;
+    std::vector<Entry> entries_;
+    std::basic_string<Char> chars_;
+    std::vector<size_t> hashes_;
+    std::vector<size_t> index_; // entry index + 1 of the first occurrences, 0 for empty slots
+    size_t uniqueCount_ = 0;
+};
+
+namespace details {
+
+// Refers to the argument characters, the column copies them
+template<>
+struct Converter<StringColumn::View>
+{
+    bool operator()(const Char* begin, const Char* end, StringColumn::View& value) const
+    {
+        value = StringColumn::View(begin, static_cast<size_t>(end - begin));
+        return true;
+    }
+
+    std::string getValidValues() const { return {}; }
+};
+
+template<>
+struct ValueWriter<StringColumn::View>
+{
+    static void write(std::string& buffer, StringColumn::View value, bool json)
+    {
+        ValueWriter<std::basic_string<Char>>::write(buffer, value.str(), json);
+    }
+};
+
+} // namespace details
+
+} // namespace cmd_line_args
+} // namespace over9000
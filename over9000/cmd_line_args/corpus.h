@@ -0,0 +1,299 @@
+// Command line argument parser: command line corpus capture for benchmarks
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+inline uint64_t mixBits(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Appends a character escaping tab, line break, backslash and other control characters
+inline void appendCorpusChar(std::string& line, uint32_t c)
+{
+    static const char HEX[] = "0123456789abcdef";
+    if (c == '\\')
+    {
+        line += "\\\\";
+    }
+    else if (c == '\t')
+    {
+        line += "\\t";
+    }
+    else if (c == '\n')
+    {
+        line += "\\n";
+    }
+    else if (c < 0x20 || c == 0x7f)
+    {
+        line += "\\x";
+        line += HEX[c >> 4];
+        line += HEX[c & 0xf];
+    }
+    else
+    {
+        line += static_cast<char>(c);
+    }
+}
+
+// Appends a value replacing its digits and letters by ones derived from a keyed hash of the
+// whole value. The length and the character classes are kept, so numbers stay numbers and
+// paths keep their separators, and equal values stay equal.
+inline void appendHashedValue(std::string& line, const Char* begin, const Char* end, uint64_t key)
+{
+    uint64_t hash = 14695981039346656037ull ^ key;
+    for (const Char* c = begin; c != end; ++c)
+    {
+        hash = (hash ^ static_cast<uint64_t>(*c)) * 1099511628211ull;
+    }
+
+    bool digitRun = false;
+    for (const Char* c = begin; c != end; ++c)
+    {
+        auto u = static_cast<uint32_t>(*c);
+        uint64_t random = mixBits(hash + static_cast<uint64_t>(c - begin) * 0x9e3779b97f4a7c15ull);
+        if (u - '0' <= 9)
+        {
+            // A leading zero is kept as the only one a number may have
+            bool keepZero = u == '0' && !digitRun;
+            line += keepZero ? '0' : static_cast<char>((digitRun ? '0' : '1') +
+                                                       random % (digitRun ? 10 : 9));
+            digitRun = true;
+            continue;
+        }
+
+        digitRun = false;
+        if (u - 'a' < 26)
+        {
+            line += static_cast<char>('a' + random % 26);
+        }
+        else if (u - 'A' < 26)
+        {
+            line += static_cast<char>('A' + random % 26);
+        }
+        else if (u > 127)
+        {
+            line += 'x';
+        }
+        else
+        {
+            appendCorpusChar(line, u);
+        }
+    }
+}
+
+inline void appendValue(std::string& line, const Char* begin, const Char* end, bool hash,
+                        uint64_t key)
+{
+    if (hash)
+    {
+        appendHashedValue(line, begin, end, key);
+        return;
+    }
+
+    for (const Char* c = begin; c != end; ++c)
+    {
+        auto u = static_cast<uint32_t>(static_cast<typename std::make_unsigned<Char>::type>(*c));
+        // Wide characters are not encoded
+        appendCorpusChar(line, sizeof(Char) == 1 || u <= 127 ? u : '?');
+    }
+}
+
+// A random hash key, e.g. of a corpus writer
+inline uint64_t randomKey()
+{
+    std::random_device device;
+    uint64_t key = (uint64_t(device()) << 32) ^ device();
+    return mixBits(key ^ static_cast<uint64_t>(
+                             std::chrono::steady_clock::now().time_since_epoch().count()));
+}
+
+} // namespace details
+
+/// Command line of a corpus, see CorpusWriter.
+///
+struct CorpusRecord
+{
+    bool error = false;            ///< Whether the parse failed
+    std::vector<std::string> args; ///< The arguments after the executable name
+};
+
+/// Appends the command lines of Parser::parse() calls to a corpus file, e.g. to replay real
+/// command lines in benchmarks (see bench/replay.cpp):
+///     parser.setCapture(CorpusWriter("/var/tmp/tool.corpus"));
+/// Parameter names are kept while the values and positional arguments are hashed unless
+/// hashValues is false. A hashed value keeps its length and character classes but not its
+/// digits and letters, so e.g. enumerated values become bad values. Since short values like
+/// PINs could be recovered by brute force given the hash key, the key is random per writer
+/// unless given: hashed values can only be compared within the records of one writer and its
+/// copies, or of writers sharing a secret key. Records are lines of "ok" or "error" followed
+/// by the tab separated arguments with tab, line break, backslash and other control characters
+/// escaped. A writer may be shared by parsers on several threads.
+///
+class CorpusWriter
+{
+public:
+    explicit CorpusWriter(const std::string& path, bool hashValues = true)
+        : CorpusWriter(path, hashValues, details::randomKey())
+    {
+    }
+
+    CorpusWriter(const std::string& path, bool hashValues, uint64_t key)
+        : state_(std::make_shared<State>()), hashValues_(hashValues), key_(key)
+    {
+        state_->file = std::fopen(path.c_str(), "ab");
+        if (state_->file == nullptr)
+        {
+            throw Error() << "Cannot open corpus file: " << path;
+        }
+    }
+
+    void operator()(int argc, const Char* const argv[], const char* error) const
+    {
+        std::string line = error != nullptr ? "error" : "ok";
+        for (int i = 1; i < argc; ++i)
+        {
+            const Char* arg = argv[i];
+            const Char* end = arg + details::length(arg);
+            size_t size = static_cast<size_t>(end - arg);
+            line += '\t';
+
+            // Arguments classified as names by the parser are kept, including values like -1
+            bool dash = size >= 2 && arg[0] == '-';
+            if (dash && arg[1] == '-' && size > 2) // --name[=value]
+            {
+                const Char* equal = details::find(arg, end, '=');
+                const Char* nameEnd = equal != nullptr ? equal + 1 : end;
+                details::appendValue(line, arg, nameEnd, false, 0);
+                details::appendValue(line, nameEnd, end, hashValues_, key_);
+            }
+            else
+            {
+                details::appendValue(line, arg, end, hashValues_ && !(dash && size == 2), key_);
+            }
+        }
+        line += '\n';
+
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        std::fwrite(line.data(), 1, line.size(), state_->file);
+        std::fflush(state_->file);
+    }
+
+private:
+    struct State
+    {
+        ~State()
+        {
+            if (file != nullptr)
+            {
+                std::fclose(file);
+            }
+        }
+
+        std::mutex mutex;
+        FILE* file = nullptr;
+    };
+
+    std::shared_ptr<State> state_;
+    bool hashValues_;
+    uint64_t key_;
+};
+
+/// Reads the records of a corpus file written by CorpusWriter.
+///
+inline std::vector<CorpusRecord> readCorpus(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        throw Error() << "Cannot open corpus file: " << path;
+    }
+
+    std::string contents;
+    char buffer[65536];
+    size_t count = 0;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+    {
+        contents.append(buffer, count);
+    }
+    std::fclose(file);
+
+    std::vector<CorpusRecord> records;
+    size_t lineNumber = 0;
+    size_t pos = 0;
+    while (pos < contents.size())
+    {
+        size_t lineEnd = std::min(contents.find('\n', pos), contents.size());
+        ++lineNumber;
+
+        CorpusRecord record;
+        size_t fieldEnd = std::min(contents.find('\t', pos), lineEnd);
+        auto outcome = contents.substr(pos, fieldEnd - pos);
+        if (outcome != "ok" && outcome != "error")
+        {
+            throw Error() << "Bad corpus record at line " << lineNumber << ": " << path;
+        }
+        record.error = outcome == "error";
+
+        for (pos = fieldEnd; pos < lineEnd;)
+        {
+            std::string arg;
+            for (++pos; pos < lineEnd && contents[pos] != '\t'; ++pos)
+            {
+                char c = contents[pos];
+                if (c != '\\')
+                {
+                    arg += c;
+                    continue;
+                }
+
+                char escape = pos + 1 < lineEnd ? contents[++pos] : '\0';
+                if (escape == 'x' && pos + 2 < lineEnd)
+                {
+                    arg += static_cast<char>(std::strtol(contents.substr(pos + 1, 2).c_str(),
+                                                         nullptr, 16));
+                    pos += 2;
+                }
+                else if (escape == '\\' || escape == 't' || escape == 'n')
+                {
+                    arg += escape == 't' ? '\t' : (escape == 'n' ? '\n' : '\\');
+                }
+                else
+                {
+                    throw Error() << "Bad corpus record at line " << lineNumber << ": " << path;
+                }
+            }
+            record.args.push_back(std::move(arg));
+        }
+
+        records.push_back(std::move(record));
+        pos = lineEnd + 1;
+    }
+    return records;
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
@@ -0,0 +1,462 @@
+// Command line argument parser: early options parsed before initialization
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Early option values: integral, floating point and const Char* pointing into the arguments.
+// The value characters are always terminated by the argument terminator.
+
+template<class T, class = void>
+struct EarlyValue
+{
+};
+
+template<class T>
+struct EarlyValue<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    static bool parse(const Char* begin, const Char* end, T& value)
+    {
+        bool negative = begin != end && *begin == '-';
+        begin += begin != end && (*begin == '-' || *begin == '+');
+        if (begin == end)
+        {
+            return false;
+        }
+
+        using Magnitude = unsigned long long;
+        Magnitude magnitude = 0;
+        for (; begin != end; ++begin)
+        {
+            auto digit = static_cast<Magnitude>(*begin) - '0';
+            if (digit > 9 || magnitude > (std::numeric_limits<Magnitude>::max() - digit) / 10)
+            {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+
+        if (negative)
+        {
+            auto min = static_cast<Magnitude>(-(std::numeric_limits<T>::min() + 1)) + 1;
+            if (!std::is_signed<T>::value ? magnitude != 0 : magnitude > min)
+            {
+                return false;
+            }
+            value = static_cast<T>(0 - magnitude);
+            return true;
+        }
+
+        if (magnitude > static_cast<Magnitude>(std::numeric_limits<T>::max()))
+        {
+            return false;
+        }
+        value = static_cast<T>(magnitude);
+        return true;
+    }
+
+    static bool equal(T lhs, T rhs) { return lhs == rhs; }
+
+    static void write(std::string& buffer, T value, bool json)
+    {
+        ValueWriter<T>::write(buffer, value, json);
+    }
+};
+
+template<>
+struct EarlyValue<bool>
+{
+    static bool parse(const Char* begin, const Char* end, bool& value)
+    {
+        static const char* const NAMES[] = {"0", "false", "1", "true"};
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const Char* c = begin;
+            const char* name = NAMES[i];
+            while (c != end && *name != '\0' && *c == static_cast<Char>(*name))
+            {
+                ++c;
+                ++name;
+            }
+
+            if (c == end && *name == '\0')
+            {
+                value = i >= 2;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool equal(bool lhs, bool rhs) { return lhs == rhs; }
+
+    static void write(std::string& buffer, bool value, bool json)
+    {
+        ValueWriter<bool>::write(buffer, value, json);
+    }
+};
+
+template<class T>
+struct EarlyValue<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static bool parse(const Char* begin, const Char* end, T& value)
+    {
+        if (begin == end || *begin == ' ' || *begin == '\t')
+        {
+            return false;
+        }
+
+        return readFloatingPoint(begin, end, value);
+    }
+
+    static bool equal(T lhs, T rhs) { return lhs == rhs; }
+
+    static void write(std::string& buffer, T value, bool json)
+    {
+        ValueWriter<T>::write(buffer, value, json);
+    }
+};
+
+template<>
+struct EarlyValue<const Char*>
+{
+    static bool parse(const Char* begin, const Char*, const Char*& value)
+    {
+        value = begin;
+        return true;
+    }
+
+    static bool equal(const Char* lhs, const Char* rhs)
+    {
+        if (lhs == nullptr || rhs == nullptr)
+        {
+            return lhs == rhs;
+        }
+
+        while (*lhs != '\0' && *lhs == *rhs)
+        {
+            ++lhs;
+            ++rhs;
+        }
+        return *lhs == *rhs;
+    }
+
+    static void write(std::string& buffer, const Char* value, bool json)
+    {
+        if (value == nullptr)
+        {
+            buffer += json ? "null" : "";
+            return;
+        }
+        ValueWriter<std::basic_string<Char>>::write(buffer, value, json);
+    }
+};
+
+struct EarlyOption
+{
+    const char* longName;
+    char shortName;
+    const char* help;
+    bool flag;
+    void* value;
+    bool (*parse)(const Char* begin, const Char* end, void* value);
+    std::unique_ptr<Param> (*makeParam)(const EarlyOption& option);
+};
+
+template<class T>
+bool parseEarly(const Char* begin, const Char* end, void* value)
+{
+    return EarlyValue<T>::parse(begin, end, *static_cast<T*>(value));
+}
+
+// Parameter of an early option for the full parse, checks that the value is the same
+template<class T>
+class EarlyParam : public Param
+{
+public:
+    explicit EarlyParam(const EarlyOption& option)
+        : Param(option.longName, option.shortName, option.help != nullptr ? option.help : "",
+                ParamType::OPTIONAL, option.flag)
+        , value_(static_cast<T*>(option.value))
+    {
+    }
+
+protected:
+    bool isList() const override { return false; }
+
+    bool parse(const Char* begin, const Char* end, std::basic_stringstream<Char>&) override
+    {
+        parsed_ = true;
+        T value{};
+        return EarlyValue<T>::parse(begin, end, value) && EarlyValue<T>::equal(value, *value_);
+    }
+
+    bool isAsync() const override { return false; }
+
+    std::unique_ptr<Pending> parseAsync(const Char*, const Char*, const Executor&) override
+    {
+        return nullptr;
+    }
+
+    std::string getValidValues() const override { return {}; }
+
+    std::string describeError(const Char* begin, const Char* end) const override
+    {
+        T value{};
+        return EarlyValue<T>::parse(begin, end, value) ? "differs from the early parse" : "";
+    }
+
+    void dump(std::string& buffer, bool json) const override
+    {
+        EarlyValue<T>::write(buffer, *value_, json);
+    }
+
+    size_t save(ValueSnapshot& snapshot) const override { return snapshot.save(*value_); }
+
+    void restore(const ValueSnapshot& snapshot, size_t slot) override
+    {
+        snapshot.restore(slot, *value_);
+    }
+
+private:
+    T* value_;
+};
+
+template<class T>
+std::unique_ptr<Param> makeEarlyParam(const EarlyOption& option)
+{
+    return std::make_unique<EarlyParam<T>>(option);
+}
+
+class EarlyGroup : public ParamGroup
+{
+public:
+    size_t size() const override { return params_.size(); }
+    Param& param(size_t i) override { return *params_[i]; }
+    bool isPositional(size_t) const override { return false; }
+
+    std::vector<std::unique_ptr<Param>> params_;
+};
+
+inline bool equalName(const Char* begin, const Char* end, const char* name)
+{
+    for (; begin != end && *name != '\0'; ++begin, ++name)
+    {
+        if (*begin != static_cast<Char>(static_cast<unsigned char>(*name)))
+        {
+            return false;
+        }
+    }
+    return begin == end && *name == '\0';
+}
+
+} // namespace details
+
+/// Options taking effect before the rest of the program initializes, e.g. a log level or
+/// allocator settings. parse() scans the arguments for them without heap allocation and without
+/// streams, before the full parser and its parameters exist:
+///     EarlyOptions<> early;
+///     early.addParam(arenas, "malloc-arenas", "Malloc arenas");
+///     early.addFlag(hugepages, "hugepages", "Use huge pages");
+///     if (!early.parse(argc, argv)) ...
+///     ...
+///     parser.addEarly(early);
+///     parser.parse(argc, argv);
+/// The values are integral, floating point or const Char* pointing into the arguments.
+/// Other arguments are skipped, and an argument that equals an early option is taken as one
+/// even if it is the value of another parameter. After Parser::addEarly() the full parse
+/// accepts the early options and checks that their values are the same.
+///
+template<size_t N = 16>
+class EarlyOptions
+{
+public:
+    /// Registers an early option:
+    /// - --longName value
+    /// - --longName=value
+    /// - -s value
+    ///
+    template<class T>
+    void addParam(T& value, const char* longName, char shortName, const char* help)
+    {
+        add(value, longName, shortName, help, false);
+    }
+
+    template<class T>
+    void addParam(T& value, const char* longName, const char* help)
+    {
+        add(value, longName, '\0', help, false);
+    }
+
+    /// Registers an early flag option setting the value to 1:
+    /// - --longName
+    /// - -s
+    ///
+    template<class T>
+    void addFlag(T& value, const char* longName, char shortName, const char* help)
+    {
+        static_assert(std::is_integral<T>::value, "Value must be of integral type");
+        add(value, longName, shortName, help, true);
+    }
+
+    template<class T>
+    void addFlag(T& value, const char* longName, const char* help)
+    {
+        addFlag(value, longName, '\0', help);
+    }
+
+    /// Parses the early options, returns false on a bad or missing value, see error().
+    ///
+    bool parse(int argc, const Char* const argv[])
+    {
+        static const Char FLAG_VALUE[] = {'1', '\0'};
+
+        error_ = nullptr;
+        errorArg_ = 0;
+        for (int i = 1; i < argc; ++i)
+        {
+            const Char* arg = argv[i];
+            if (arg == nullptr || arg[0] != '-' || arg[1] == '\0')
+            {
+                continue;
+            }
+
+            const Char* value = nullptr;
+            const details::EarlyOption* option = nullptr;
+            if (arg[1] != '-') // -s
+            {
+                if (arg[2] == '\0')
+                {
+                    option = findShortName(arg[1]);
+                }
+            }
+            else
+            {
+                const Char* end = arg + 2;
+                while (*end != '\0' && *end != '=')
+                {
+                    ++end;
+                }
+                option = findLongName(arg + 2, end);
+                value = *end == '=' ? end + 1 : nullptr;
+            }
+
+            if (option == nullptr)
+            {
+                continue;
+            }
+
+            int optionArg = i;
+            if (value == nullptr)
+            {
+                if (option->flag)
+                {
+                    value = FLAG_VALUE;
+                }
+                else if (i + 1 < argc && argv[i + 1] != nullptr)
+                {
+                    value = argv[++i];
+                }
+                else
+                {
+                    error_ = "Missing value of an early option";
+                    errorArg_ = i;
+                    return false;
+                }
+            }
+
+            const Char* valueEnd = value;
+            while (*valueEnd != '\0')
+            {
+                ++valueEnd;
+            }
+
+            if (!option->parse(value, valueEnd, option->value))
+            {
+                error_ = "Bad value of an early option";
+                errorArg_ = optionArg;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Returns the error of the last parse() or nullptr.
+    ///
+    const char* error() const { return error_; }
+
+    /// Returns the argv index of the early option with the error.
+    ///
+    int errorArg() const { return errorArg_; }
+
+    /// Returns the parameters of the options for Parser::addEarly().
+    ///
+    std::unique_ptr<details::ParamGroup> bind() const
+    {
+        auto group = std::make_unique<details::EarlyGroup>();
+        for (size_t i = 0; i < size_; ++i)
+        {
+            group->params_.push_back(options_[i].makeParam(options_[i]));
+        }
+        return group;
+    }
+
+private:
+    template<class T>
+    void add(T& value, const char* longName, char shortName, const char* help, bool flag)
+    {
+        if (size_ == N)
+        {
+            throw Error() << "Too many early options: --" << longName;
+        }
+        options_[size_++] = {longName, shortName, help, flag, &value, &details::parseEarly<T>,
+                             &details::makeEarlyParam<T>};
+    }
+
+    const details::EarlyOption* findShortName(Char name) const
+    {
+        for (size_t i = 0; i < size_; ++i)
+        {
+            if (options_[i].shortName != '\0' && static_cast<Char>(options_[i].shortName) == name)
+            {
+                return &options_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const details::EarlyOption* findLongName(const Char* begin, const Char* end) const
+    {
+        for (size_t i = 0; i < size_; ++i)
+        {
+            if (details::equalName(begin, end, options_[i].longName))
+            {
+                return &options_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::array<details::EarlyOption, N> options_{};
+    size_t size_ = 0;
+    const char* error_ = nullptr;
+    int errorArg_ = 0;
+};
+
+} // namespace cmd_line_args
+} // namespace over9000
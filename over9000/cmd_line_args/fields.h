@@ -0,0 +1,380 @@
+// Command line argument parser: options struct binding
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+enum class FieldKind
+{
+    NAMED,
+    FLAG,
+    POSITIONAL,
+};
+
+template<class S, class T>
+struct Field
+{
+    T S::*member;
+    const char* longName;
+    char shortName;
+    const char* help;
+    ParamType type;
+    FieldKind kind;
+};
+
+// Parameter of a struct field, the field type is erased into the parse function so that all
+// fields of a struct are kept in one array
+class FieldParam : public Param
+{
+public:
+    using ParseFunction = bool (*)(const void* field, void* object, const Char* begin,
+                                   const Char* end, std::basic_stringstream<Char>& stream,
+                                   bool first);
+    using DumpFunction = void (*)(const void* field, const void* object, std::string& buffer,
+                                  bool json);
+    using SaveFunction = size_t (*)(const void* field, const void* object,
+                                    ValueSnapshot& snapshot);
+    using RestoreFunction = void (*)(const void* field, void* object, size_t slot,
+                                     const ValueSnapshot& snapshot);
+    using FinishFunction = void (*)(const void* field, void* object);
+
+    FieldParam(ParamText longName, char shortName, ParamText help, ParamType type, bool flag,
+               bool list, ParseFunction parseFunction, DumpFunction dumpFunction,
+               SaveFunction saveFunction, RestoreFunction restoreFunction,
+               FinishFunction finishFunction, const void* field, void* object)
+        : Param(std::move(longName), shortName, std::move(help), type, flag)
+        , list_(list)
+        , parse_(parseFunction)
+        , dump_(dumpFunction)
+        , save_(saveFunction)
+        , restore_(restoreFunction)
+        , finish_(finishFunction)
+        , field_(field)
+        , object_(object)
+    {
+    }
+
+protected:
+    bool isList() const override { return list_; }
+
+    bool parse(const Char* begin, const Char* end, std::basic_stringstream<Char>& stream) override
+    {
+        bool first = !parsed_;
+        parsed_ = true;
+        return parse_(field_, object_, begin, end, stream, first);
+    }
+
+    bool isAsync() const override { return false; }
+
+    std::unique_ptr<Pending> parseAsync(const Char*, const Char*, const Executor&) override
+    {
+        return nullptr;
+    }
+
+    std::string getValidValues() const override { return {}; }
+    std::string describeError(const Char*, const Char*) const override { return {}; }
+
+    void dump(std::string& buffer, bool json) const override
+    {
+        dump_(field_, object_, buffer, json);
+    }
+
+    size_t save(ValueSnapshot& snapshot) const override { return save_(field_, object_, snapshot); }
+
+    void restore(const ValueSnapshot& snapshot, size_t slot) override
+    {
+        restore_(field_, object_, slot, snapshot);
+    }
+
+    void finish() override { finish_(field_, object_); }
+
+private:
+    bool list_;
+    ParseFunction parse_;
+    DumpFunction dump_;
+    SaveFunction save_;
+    RestoreFunction restore_;
+    FinishFunction finish_;
+    const void* field_;
+    void* object_;
+};
+
+template<class T>
+bool convertField(T& value, const Char* begin, const Char* end,
+                  std::basic_stringstream<Char>& stream, bool, std::false_type)
+{
+    Converter<T> converter;
+    return convert(converter, begin, end, stream, value);
+}
+
+template<class T>
+bool convertField(T& list, const Char* begin, const Char* end,
+                  std::basic_stringstream<Char>& stream, bool first, std::true_type)
+{
+    // Handle repeated Parser::parse() calls
+    if (first)
+    {
+        list.clear();
+    }
+
+    using ValueType = typename TypeTraits<T>::ValueType;
+    Converter<ValueType> converter;
+    ValueType value;
+    if (!convert(converter, begin, end, stream, value))
+    {
+        return false;
+    }
+    list.push_back(std::move(value));
+    return true;
+}
+
+template<class S, class T>
+bool parseField(const void* field, void* object, const Char* begin, const Char* end,
+                std::basic_stringstream<Char>& stream, bool first)
+{
+    auto member = static_cast<const Field<S, T>*>(field)->member;
+    return convertField(static_cast<S*>(object)->*member, begin, end, stream, first,
+                        std::integral_constant<bool, TypeTraits<T>::IS_LIST>());
+}
+
+template<class T>
+void writeField(std::string& buffer, const T& value, bool json, std::false_type)
+{
+    ValueWriter<T>::write(buffer, value, json);
+}
+
+template<class T>
+void writeField(std::string& buffer, const T& list, bool json, std::true_type)
+{
+    writeList(buffer, Converter<typename TypeTraits<T>::ValueType>(), list, json);
+}
+
+template<class S, class T>
+void dumpField(const void* field, const void* object, std::string& buffer, bool json)
+{
+    auto member = static_cast<const Field<S, T>*>(field)->member;
+    writeField(buffer, static_cast<const S*>(object)->*member, json,
+               std::integral_constant<bool, TypeTraits<T>::IS_LIST>());
+}
+
+template<class S, class T>
+size_t saveField(const void* field, const void* object, ValueSnapshot& snapshot)
+{
+    auto member = static_cast<const Field<S, T>*>(field)->member;
+    return snapshot.save(static_cast<const S*>(object)->*member);
+}
+
+template<class S, class T>
+void restoreField(const void* field, void* object, size_t slot, const ValueSnapshot& snapshot)
+{
+    auto member = static_cast<const Field<S, T>*>(field)->member;
+    snapshot.restore(slot, static_cast<S*>(object)->*member);
+}
+
+template<class T>
+void buildField(T&, std::false_type)
+{
+}
+
+template<class T>
+void buildField(T& list, std::true_type)
+{
+    buildList(list);
+}
+
+template<class S, class T>
+void finishField(const void* field, void* object)
+{
+    auto member = static_cast<const Field<S, T>*>(field)->member;
+    buildField(static_cast<S*>(object)->*member,
+               std::integral_constant<bool, TypeTraits<T>::IS_LIST>());
+}
+
+// All field parameters of a struct instance in a single allocation, the field descriptors are
+// shared with the table and the parameters refer to their names and help. The prefixed names of
+// a mounted group are composed into one string.
+template<class S, class... T>
+class FieldGroup : public ParamGroup
+{
+public:
+    using Fields = std::tuple<Field<S, T>...>;
+
+    FieldGroup(S& object, std::shared_ptr<const Fields> fields, const std::string& prefix)
+        : FieldGroup(object, std::move(fields), prefix, std::index_sequence_for<T...>())
+    {
+    }
+
+    size_t size() const override { return sizeof...(T); }
+    Param& param(size_t i) override { return params_[i]; }
+    bool isPositional(size_t i) const override { return positional_[i]; }
+
+private:
+    template<size_t... I>
+    FieldGroup(S& object, std::shared_ptr<const Fields> fields, const std::string& prefix,
+               std::index_sequence<I...>)
+        : fields_(std::move(fields))
+        , names_(joinNames(prefix, {{std::get<I>(*fields_).longName...}}))
+        , params_{{makeParam(std::get<I>(*fields_), object, prefix.empty() ? nullptr : name(I))...}}
+        , positional_{{(std::get<I>(*fields_).kind == FieldKind::POSITIONAL)...}}
+    {
+    }
+
+    // Returns the null separated prefixed names, empty without a prefix
+    static std::string joinNames(const std::string& prefix,
+                                 const std::array<const char*, sizeof...(T)>& names)
+    {
+        std::string result;
+        if (prefix.empty())
+        {
+            return result;
+        }
+
+        size_t size = 0;
+        for (const char* name : names)
+        {
+            size += prefix.size() + std::strlen(name) + 1;
+        }
+        result.reserve(size);
+        for (const char* name : names)
+        {
+            result += prefix;
+            result += name;
+            result += '\0';
+        }
+        return result;
+    }
+
+    // Returns the i-th prefixed name
+    const char* name(size_t i) const
+    {
+        const char* name = names_.c_str();
+        for (; i != 0; --i)
+        {
+            name += std::strlen(name) + 1;
+        }
+        return name;
+    }
+
+    // A mounted field gets its prefixed name and no short name
+    template<class U>
+    static FieldParam makeParam(const Field<S, U>& field, S& object, const char* prefixedName)
+    {
+        static_assert(!std::is_enum<typename TypeTraits<U>::ValueType>(),
+                      "Enum fields are not supported");
+        bool flag = field.kind == FieldKind::FLAG;
+        return FieldParam(ParamText::view(prefixedName != nullptr ? prefixedName : field.longName),
+                          prefixedName != nullptr ? '\0' : field.shortName,
+                          ParamText::view(field.help), flag ? ParamType::OPTIONAL : field.type,
+                          flag, TypeTraits<U>::IS_LIST, &parseField<S, U>, &dumpField<S, U>,
+                          &saveField<S, U>, &restoreField<S, U>, &finishField<S, U>, &field,
+                          &object);
+    }
+
+    std::shared_ptr<const Fields> fields_; // Referred to by the parameters
+    std::string names_;                    // Prefixed names referred to by the parameters
+    std::array<FieldParam, sizeof...(T)> params_;
+    std::array<bool, sizeof...(T)> positional_;
+};
+
+template<class S, class... T>
+class FieldTable
+{
+public:
+    explicit FieldTable(Field<S, T>... fields)
+        : fields_(std::make_shared<const typename FieldGroup<S, T...>::Fields>(fields...))
+    {
+    }
+
+    std::unique_ptr<ParamGroup> bind(S& object, const std::string& prefix = {}) const
+    {
+        return std::make_unique<FieldGroup<S, T...>>(object, fields_, prefix);
+    }
+
+private:
+    std::shared_ptr<const typename FieldGroup<S, T...>::Fields> fields_;
+};
+
+} // namespace details
+
+/// Describes a named parameter bound to a struct field, see fields().
+///
+template<class S, class T>
+details::Field<S, T> field(T S::*member, const char* longName, char shortName, const char* help,
+                           ParamType type = ParamType::REQUIRED)
+{
+    return {member, longName, shortName, help, type, details::FieldKind::NAMED};
+}
+
+/// Describes a named parameter bound to a struct field, see fields().
+///
+template<class S, class T>
+details::Field<S, T> field(T S::*member, const char* longName, const char* help,
+                           ParamType type = ParamType::REQUIRED)
+{
+    return {member, longName, '\0', help, type, details::FieldKind::NAMED};
+}
+
+/// Describes a flag parameter bound to a struct field, see fields().
+///
+template<class S, class T>
+details::Field<S, T> flagField(T S::*member, const char* longName, char shortName,
+                               const char* help)
+{
+    static_assert(std::is_integral<T>::value, "Value must be of integral type");
+    return {member, longName, shortName, help, ParamType::OPTIONAL, details::FieldKind::FLAG};
+}
+
+/// Describes a flag parameter bound to a struct field, see fields().
+///
+template<class S, class T>
+details::Field<S, T> flagField(T S::*member, const char* longName, const char* help)
+{
+    return flagField(member, longName, '\0', help);
+}
+
+/// Describes a positional parameter bound to a struct field, see fields().
+///
+template<class S, class T>
+details::Field<S, T> positionalField(T S::*member, const char* longName, const char* help,
+                                     ParamType type = ParamType::REQUIRED)
+{
+    return {member, longName, '\0', help, type, details::FieldKind::POSITIONAL};
+}
+
+/// Returns a table of the parameters of an options struct for Parser::addStruct(), e.g.
+///     static const auto OPTIONS = fields(field(&Options::port, "port", 'p', "Port"),
+///                                        flagField(&Options::verbose, "verbose", "Verbose"));
+///     parser.addStruct(options, OPTIONS);
+/// The parameters are registered in the table order and all of them are kept in a single
+/// allocation per bound struct instance. The field descriptors are shared by the table and the
+/// bound instances rather than copied, so a temporary table may be passed as well. The
+/// parameters refer to the names and help of the fields, which must outlive the parser, e.g.
+/// string literals. A library can export the table of its options struct as an option group
+/// for every binary to mount under a prefix:
+///     parser.addStruct(storageOptions, STORAGE_OPTIONS, "storage.");
+///
+template<class S, class... T>
+details::FieldTable<S, T...> fields(details::Field<S, T>... fields)
+{
+    return details::FieldTable<S, T...>(fields...);
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
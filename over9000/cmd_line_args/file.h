@@ -0,0 +1,181 @@
+// Command line argument parser: file valued parameters
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/async.h"
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Reads a whole file into bytes, returns false if it cannot be read
+inline bool readFile(const Char* begin, const Char* end, std::string& contents)
+{
+    std::basic_string<Char> path(begin, end);
+    if (path.empty() || path.find(Char()) != std::basic_string<Char>::npos)
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+    FILE* file = _wfopen(path.c_str(), L"rb");
+#else
+    FILE* file = std::fopen(path.c_str(), "rb");
+#endif // _WIN32
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    const size_t MIN_CHUNK = 4096;
+    size_t size = 0;
+    contents.clear();
+    for (;;)
+    {
+        contents.resize(size + std::max(MIN_CHUNK, size));
+        size_t count = std::fread(&contents[size], 1, contents.size() - size, file);
+        size += count;
+        if (size != contents.size())
+        {
+            break;
+        }
+    }
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    contents.resize(size);
+    return ok;
+}
+
+// Reads the bytes of a file into std::string or std::vector<uint8_t>
+struct FileBytesConverter
+{
+    bool operator()(const Char* begin, const Char* end, std::string& value) const
+    {
+        return readFile(begin, end, value);
+    }
+
+    bool operator()(const Char* begin, const Char* end, std::vector<uint8_t>& value) const
+    {
+        std::string contents;
+        if (!readFile(begin, end, contents))
+        {
+            return false;
+        }
+        value.assign(contents.begin(), contents.end());
+        return true;
+    }
+
+    std::string getValidValues() const { return "paths of readable files"; }
+
+    std::string describeError(const Char*, const Char*) const { return "cannot read the file"; }
+};
+
+// Converts the contents of a file with another converter, a trailing line break is ignored
+template<class Converter>
+struct FileConverter
+{
+    template<class T>
+    typename std::enable_if<CanConvert<Converter, T>::value, bool>::type operator()(
+        const Char* begin, const Char* end, T& value)
+    {
+        std::basic_string<Char> contents;
+        if (!readContents(begin, end, contents))
+        {
+            return false;
+        }
+        std::basic_stringstream<Char> stream;
+        return convert(converter, contents.data(), contents.data() + contents.size(), stream,
+                       value);
+    }
+
+    std::string getValidValues() const
+    {
+        auto validValues = converter.getValidValues();
+        return "paths of readable files" +
+               (validValues.empty() ? std::string() : " containing " + validValues);
+    }
+
+    std::string describeError(const Char* begin, const Char* end) const
+    {
+        std::basic_string<Char> contents;
+        if (!readContents(begin, end, contents))
+        {
+            return "cannot read the file";
+        }
+        return details::describeError(converter, contents.data(),
+                                      contents.data() + contents.size());
+    }
+
+    static bool readContents(const Char* begin, const Char* end,
+                             std::basic_string<Char>& contents)
+    {
+        std::string bytes;
+        if (!readFile(begin, end, bytes))
+        {
+            return false;
+        }
+
+        size_t size = bytes.size();
+        if (size != 0 && bytes[size - 1] == '\n')
+        {
+            --size;
+            if (size != 0 && bytes[size - 1] == '\r')
+            {
+                --size;
+            }
+        }
+
+        contents.resize(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            contents[i] = static_cast<Char>(static_cast<unsigned char>(bytes[i]));
+        }
+        return true;
+    }
+
+    Converter converter;
+};
+
+} // namespace details
+
+/// Returns a converter reading the file named by an argument into std::string or
+/// std::vector<uint8_t>, e.g. parser.addParam(config, "config", "Config file", fromFile());
+/// The files are read asynchronously like with async() from async.h: every read starts as
+/// soon as its argument is met and they run concurrently with each other and with the rest of
+/// parsing, so the parse waits for about the slowest read rather than their sum.
+/// The reads run on the executor of Parser::setExecutor(), e.g. a thread pool.
+///
+inline details::AsyncConverter<details::FileBytesConverter> fromFile()
+{
+    return async(details::FileBytesConverter());
+}
+
+/// Returns a converter reading the file named by an argument and converting its contents by
+/// the given converter, e.g. for a key file:
+///     parser.addParam(key, "key-file", "Key file", fromFile(hex()));
+/// A trailing line break of the contents is ignored. The files are read concurrently like with
+/// fromFile(), the converter may be called concurrently for several arguments.
+///
+template<class Converter>
+details::AsyncConverter<details::FileConverter<Converter>> fromFile(Converter converter)
+{
+    return async(details::FileConverter<Converter>{std::move(converter)});
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
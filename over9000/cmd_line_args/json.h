@@ -0,0 +1,1036 @@
+// Command line argument parser: JSON valued parameters
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+
+enum class JsonKind : uint8_t
+{
+    NONE, // not found
+    NULL_VALUE,
+    BOOLEAN,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT,
+};
+
+namespace details {
+
+// Value of a tape, a container is followed by its children and next is the index after them
+struct JsonEntry
+{
+    JsonKind kind;
+    uint32_t begin;
+    uint32_t size;
+    uint32_t next;
+};
+
+struct JsonError
+{
+    size_t offset = 0;
+    std::string path; // e.g. .limits.cpu or .rules[2]
+    std::string message;
+
+    std::string format() const
+    {
+        return "$" + path + ": " + message + " at offset " + std::to_string(offset);
+    }
+};
+
+inline uint32_t hexValue(Char c)
+{
+    uint32_t digit = static_cast<uint32_t>(c) - '0';
+    uint32_t letter = (static_cast<uint32_t>(c) | 0x20) - 'a';
+    return digit < 10 ? digit : (letter < 6 ? letter + 10 : 0x100);
+}
+
+// Validates JSON text and records its values on a tape referring to the text
+class JsonParser
+{
+public:
+    JsonParser(const Char* begin, const Char* end, std::vector<JsonEntry>& tape, JsonError& error)
+        : begin_(begin), end_(end), p_(begin), tape_(tape), error_(error)
+    {
+    }
+
+    bool parse()
+    {
+        tape_.clear();
+        if (end_ - begin_ > static_cast<ptrdiff_t>(UINT32_MAX))
+        {
+            return fail("too long text");
+        }
+
+        skipSpace();
+        if (!parseValue(0))
+        {
+            return false;
+        }
+        skipSpace();
+        return p_ == end_ || fail("unexpected character");
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    bool fail(const char* message)
+    {
+        error_.offset = static_cast<size_t>(p_ - begin_);
+        error_.message = message;
+        return false;
+    }
+
+    bool next(Char c) const { return p_ != end_ && *p_ == c; }
+
+    void skipSpace()
+    {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r'))
+        {
+            ++p_;
+        }
+    }
+
+    size_t add(JsonKind kind)
+    {
+        tape_.push_back({kind, static_cast<uint32_t>(p_ - begin_), 0, 0});
+        return tape_.size() - 1;
+    }
+
+    void finish(size_t index)
+    {
+        auto& entry = tape_[index];
+        entry.size = static_cast<uint32_t>(p_ - begin_) - entry.begin;
+        entry.next = static_cast<uint32_t>(tape_.size());
+    }
+
+    bool parseValue(int depth)
+    {
+        if (p_ == end_)
+        {
+            return fail("unexpected end");
+        }
+
+        switch (*p_)
+        {
+        case '{':
+            return parseObject(depth);
+        case '[':
+            return parseArray(depth);
+        case '"':
+            return parseString();
+        case 't':
+            return parseLiteral("true", JsonKind::BOOLEAN);
+        case 'f':
+            return parseLiteral("false", JsonKind::BOOLEAN);
+        case 'n':
+            return parseLiteral("null", JsonKind::NULL_VALUE);
+        default:
+            return parseNumber();
+        }
+    }
+
+    bool parseObject(int depth)
+    {
+        if (depth == MAX_DEPTH)
+        {
+            return fail("too deep nesting");
+        }
+
+        size_t index = add(JsonKind::OBJECT);
+        ++p_;
+        skipSpace();
+        if (next('}'))
+        {
+            ++p_;
+            finish(index);
+            return true;
+        }
+
+        for (;;)
+        {
+            if (!next('"'))
+            {
+                return fail("expected a name");
+            }
+            size_t name = tape_.size();
+            if (!parseString())
+            {
+                return false;
+            }
+
+            skipSpace();
+            if (!next(':'))
+            {
+                return fail("expected ':'");
+            }
+            ++p_;
+            skipSpace();
+
+            if (!parseValue(depth + 1))
+            {
+                error_.path.insert(0, "." + nameString(name));
+                return false;
+            }
+
+            skipSpace();
+            if (next(','))
+            {
+                ++p_;
+                skipSpace();
+                continue;
+            }
+            if (next('}'))
+            {
+                ++p_;
+                finish(index);
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool parseArray(int depth)
+    {
+        if (depth == MAX_DEPTH)
+        {
+            return fail("too deep nesting");
+        }
+
+        size_t index = add(JsonKind::ARRAY);
+        ++p_;
+        skipSpace();
+        if (next(']'))
+        {
+            ++p_;
+            finish(index);
+            return true;
+        }
+
+        for (size_t i = 0;; ++i)
+        {
+            if (!parseValue(depth + 1))
+            {
+                error_.path.insert(0, "[" + std::to_string(i) + "]");
+                return false;
+            }
+
+            skipSpace();
+            if (next(','))
+            {
+                ++p_;
+                skipSpace();
+                continue;
+            }
+            if (next(']'))
+            {
+                ++p_;
+                finish(index);
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parseString()
+    {
+        size_t index = add(JsonKind::STRING);
+        for (++p_; p_ != end_ && *p_ != '"'; ++p_)
+        {
+            if (*p_ == '\\')
+            {
+                ++p_;
+                if (p_ == end_)
+                {
+                    break;
+                }
+                if (*p_ == 'u')
+                {
+                    if (end_ - p_ < 5 || (hexValue(p_[1]) | hexValue(p_[2]) | hexValue(p_[3]) |
+                                          hexValue(p_[4])) > 0xf)
+                    {
+                        return fail("bad \\u escape");
+                    }
+                    p_ += 4;
+                }
+                else if (std::strchr("\"\\/bfnrt", static_cast<int>(*p_)) == nullptr ||
+                         *p_ == '\0')
+                {
+                    return fail("bad escape");
+                }
+            }
+            else if (static_cast<uint32_t>(*p_) < 0x20)
+            {
+                return fail("control character in a string");
+            }
+        }
+
+        if (p_ == end_)
+        {
+            return fail("unterminated string");
+        }
+        ++p_;
+        finish(index);
+        return true;
+    }
+
+    bool parseLiteral(const char* literal, JsonKind kind)
+    {
+        size_t index = add(kind);
+        for (; *literal != '\0'; ++literal, ++p_)
+        {
+            if (!next(static_cast<Char>(*literal)))
+            {
+                return fail("unexpected character");
+            }
+        }
+        finish(index);
+        return true;
+    }
+
+    bool parseNumber()
+    {
+        size_t index = add(JsonKind::NUMBER);
+        if (next('-'))
+        {
+            ++p_;
+        }
+
+        if (next('0'))
+        {
+            ++p_;
+        }
+        else if (!skipDigits())
+        {
+            return fail(p_ == begin_ + tape_[index].begin ? "unexpected character"
+                                                          : "expected a digit");
+        }
+
+        if (next('.'))
+        {
+            ++p_;
+            if (!skipDigits())
+            {
+                return fail("expected a digit");
+            }
+        }
+
+        if (next('e') || next('E'))
+        {
+            ++p_;
+            if (next('+') || next('-'))
+            {
+                ++p_;
+            }
+            if (!skipDigits())
+            {
+                return fail("expected a digit");
+            }
+        }
+
+        finish(index);
+        return true;
+    }
+
+    bool skipDigits()
+    {
+        const Char* start = p_;
+        while (p_ != end_ && static_cast<uint32_t>(*p_) - '0' <= 9)
+        {
+            ++p_;
+        }
+        return p_ != start;
+    }
+
+    // Returns the name of an object member for the error path
+    std::string nameString(size_t index) const
+    {
+        const auto& entry = tape_[index];
+        std::string name;
+        for (uint32_t i = 1; i + 1 < entry.size; ++i)
+        {
+            auto c = static_cast<uint32_t>(begin_[entry.begin + i]);
+            name += c <= 127 ? static_cast<char>(c) : '?';
+        }
+        return name;
+    }
+
+    const Char* begin_;
+    const Char* end_;
+    const Char* p_;
+    std::vector<JsonEntry>& tape_;
+    JsonError& error_;
+};
+
+// Appends a code point as UTF-8, or as UTF-16 for wide characters
+inline void appendCodePoint(std::string& string, uint32_t c)
+{
+    if (c < 0x80)
+    {
+        string += static_cast<char>(c);
+    }
+    else if (c < 0x800)
+    {
+        string += static_cast<char>(0xc0 | (c >> 6));
+        string += static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+        string += static_cast<char>(0xe0 | (c >> 12));
+        string += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+        string += static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else
+    {
+        string += static_cast<char>(0xf0 | (c >> 18));
+        string += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+        string += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+        string += static_cast<char>(0x80 | (c & 0x3f));
+    }
+}
+
+inline void appendCodePoint(std::wstring& string, uint32_t c)
+{
+    if (c < 0x10000 || sizeof(wchar_t) == 4)
+    {
+        string += static_cast<wchar_t>(c);
+        return;
+    }
+    c -= 0x10000;
+    string += static_cast<wchar_t>(0xd800 | (c >> 10));
+    string += static_cast<wchar_t>(0xdc00 | (c & 0x3ff));
+}
+
+// Appends the characters of a validated JSON string without its quotes, resolving escapes
+template<class String>
+void unescapeJson(const Char* begin, const Char* end, String& string)
+{
+    for (const Char* p = begin; p != end; ++p)
+    {
+        if (*p != '\\')
+        {
+            string += static_cast<typename String::value_type>(*p);
+            continue;
+        }
+
+        switch (*++p)
+        {
+        case 'b':
+            string += '\b';
+            break;
+        case 'f':
+            string += '\f';
+            break;
+        case 'n':
+            string += '\n';
+            break;
+        case 'r':
+            string += '\r';
+            break;
+        case 't':
+            string += '\t';
+            break;
+        case 'u':
+        {
+            uint32_t c = (hexValue(p[1]) << 12) | (hexValue(p[2]) << 8) | (hexValue(p[3]) << 4) |
+                         hexValue(p[4]);
+            p += 4;
+            // A surrogate pair
+            if (c >= 0xd800 && c < 0xdc00 && end - p >= 7 && p[1] == '\\' && p[2] == 'u')
+            {
+                uint32_t low = (hexValue(p[3]) << 12) | (hexValue(p[4]) << 8) |
+                               (hexValue(p[5]) << 4) | hexValue(p[6]);
+                if (low >= 0xdc00 && low < 0xe000)
+                {
+                    c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                    p += 6;
+                }
+            }
+            appendCodePoint(string, c);
+            break;
+        }
+        default: // " \ /
+            string += static_cast<typename String::value_type>(*p);
+        }
+    }
+}
+
+} // namespace details
+
+/// Value of a JSON text on a JsonTape, refers to the tape and the text.
+///
+class JsonValue
+{
+public:
+    JsonValue() = default;
+
+    JsonValue(const Char* text, const details::JsonEntry* tape, size_t index)
+        : text_(text), tape_(tape), index_(index)
+    {
+    }
+
+    /// Returns JsonKind::NONE for a value that was not found.
+    ///
+    JsonKind kind() const { return tape_ != nullptr ? entry().kind : JsonKind::NONE; }
+
+    /// Returns the JSON text of the value.
+    ///
+    const Char* data() const { return text_ + entry().begin; }
+    size_t textSize() const { return entry().size; }
+
+    /// Returns the offset of the value in the whole JSON text.
+    ///
+    size_t offset() const { return entry().begin; }
+
+    /// Returns the number of array elements or object members.
+    ///
+    size_t size() const
+    {
+        size_t count = 0;
+        for (size_t i = index_ + 1; i < entry().next; i = tape_[i].next)
+        {
+            ++count;
+        }
+        return kind() == JsonKind::OBJECT ? count / 2 : count;
+    }
+
+    /// Returns an array element or the value of an object member by its index.
+    ///
+    JsonValue operator[](size_t i) const
+    {
+        size_t index = index_ + 1;
+        for (size_t skip = kind() == JsonKind::OBJECT ? 2 * i + 1 : i; skip != 0; --skip)
+        {
+            index = tape_[index].next;
+        }
+        return {text_, tape_, index};
+    }
+
+    /// Returns the name of an object member by its index.
+    ///
+    JsonValue name(size_t i) const { return (*this)[i].previous(); }
+
+    /// Returns the value of an object member by its name or a NONE value.
+    ///
+    JsonValue find(const char* name) const
+    {
+        if (kind() != JsonKind::OBJECT)
+        {
+            return {};
+        }
+
+        for (size_t i = index_ + 1; i < entry().next; i = tape_[i + 1].next)
+        {
+            if (JsonValue(text_, tape_, i).equals(name))
+            {
+                return {text_, tape_, i + 1};
+            }
+        }
+        return {};
+    }
+
+    /// Returns true for a string value equal to the given characters.
+    ///
+    bool equals(const char* string) const
+    {
+        if (kind() != JsonKind::STRING)
+        {
+            return false;
+        }
+
+        const Char* begin = data() + 1;
+        const Char* end = data() + textSize() - 1;
+        if (std::find(begin, end, '\\') == end)
+        {
+            size_t size = std::strlen(string);
+            return static_cast<size_t>(end - begin) == size &&
+                   std::equal(begin, end, string, [](Char lhs, char rhs) {
+                       return lhs == static_cast<Char>(static_cast<unsigned char>(rhs));
+                   });
+        }
+
+        std::string value;
+        details::unescapeJson(begin, end, value);
+        return value == string;
+    }
+
+    /// Converts the value: true or false to bool, a number to an arithmetic type or a string to
+    /// std::string or std::basic_string<Char>. Returns false on a mismatch.
+    ///
+    template<class T>
+    bool get(T& value) const;
+
+private:
+    friend class JsonTape;
+
+    const details::JsonEntry& entry() const { return tape_[index_]; }
+
+    // The name before a member value
+    JsonValue previous() const
+    {
+        size_t index = index_ - 1;
+        while (tape_[index].next != index_)
+        {
+            --index;
+        }
+        return {text_, tape_, index};
+    }
+
+    const Char* text_ = nullptr;
+    const details::JsonEntry* tape_ = nullptr;
+    size_t index_ = 0;
+};
+
+/// Validated JSON argument recorded as a tape of its values over the argument characters,
+/// e.g. for --policy='{"limits":{"cpu":4}}'
+///     JsonTape policy;
+///     parser.addParam(policy, "policy", "Policy");
+///     policy.root().find("limits").find("cpu").get(cpu);
+/// The tape refers to the argument characters, the arguments must outlive it.
+///
+class JsonTape
+{
+public:
+    /// Parses a JSON text, throws Error on bad JSON.
+    ///
+    void parse(const Char* begin, const Char* end)
+    {
+        details::JsonError error;
+        if (!tryParse(begin, end, error))
+        {
+            throw Error() << "Bad JSON: " << error.format();
+        }
+    }
+
+    bool tryParse(const Char* begin, const Char* end, details::JsonError& error)
+    {
+        text_ = begin;
+        return details::JsonParser(begin, end, tape_, error).parse();
+    }
+
+    JsonValue root() const
+    {
+        return tape_.empty() ? JsonValue() : JsonValue(text_, tape_.data(), 0);
+    }
+
+private:
+    const Char* text_ = nullptr;
+    std::vector<details::JsonEntry> tape_;
+};
+
+namespace details {
+
+template<class T, class = void>
+struct JsonReader
+{
+};
+
+template<>
+struct JsonReader<bool>
+{
+    static bool read(const JsonValue& value, bool& result, JsonError& error)
+    {
+        if (value.kind() != JsonKind::BOOLEAN)
+        {
+            error.message = "expected true or false";
+            return false;
+        }
+        result = *value.data() == 't';
+        return true;
+    }
+};
+
+template<class T>
+struct JsonReader<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    static bool read(const JsonValue& value, T& result, JsonError& error)
+    {
+        error.message = "expected an integer in range";
+        if (value.kind() != JsonKind::NUMBER)
+        {
+            return false;
+        }
+
+        const Char* p = value.data();
+        const Char* end = p + value.textSize();
+        bool negative = *p == '-';
+        p += negative;
+
+        using Magnitude = unsigned long long;
+        Magnitude magnitude = 0;
+        for (; p != end; ++p)
+        {
+            auto digit = static_cast<Magnitude>(*p) - '0';
+            if (digit > 9 || magnitude > (std::numeric_limits<Magnitude>::max() - digit) / 10)
+            {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+
+        if (negative)
+        {
+            auto min = static_cast<Magnitude>(-(std::numeric_limits<T>::min() + 1)) + 1;
+            if (!std::is_signed<T>::value ? magnitude != 0 : magnitude > min)
+            {
+                return false;
+            }
+            result = static_cast<T>(0 - magnitude);
+        }
+        else
+        {
+            if (magnitude > static_cast<Magnitude>(std::numeric_limits<T>::max()))
+            {
+                return false;
+            }
+            result = static_cast<T>(magnitude);
+        }
+        return true;
+    }
+};
+
+template<class T>
+struct JsonReader<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static bool read(const JsonValue& value, T& result, JsonError& error)
+    {
+        if (value.kind() != JsonKind::NUMBER)
+        {
+            error.message = "expected a number";
+            return false;
+        }
+
+        if (!readFloatingPoint(value.data(), value.data() + value.textSize(), result))
+        {
+            error.message = "expected a number in range";
+            return false;
+        }
+        return true;
+    }
+};
+
+template<class C>
+struct JsonReader<std::basic_string<C>>
+{
+    static bool read(const JsonValue& value, std::basic_string<C>& result, JsonError& error)
+    {
+        if (value.kind() != JsonKind::STRING)
+        {
+            error.message = "expected a string";
+            return false;
+        }
+        result.clear();
+        unescapeJson(value.data() + 1, value.data() + value.textSize() - 1, result);
+        return true;
+    }
+};
+
+template<class T>
+struct JsonReader<std::vector<T>>
+{
+    static bool read(const JsonValue& value, std::vector<T>& result, JsonError& error)
+    {
+        if (value.kind() != JsonKind::ARRAY)
+        {
+            error.message = "expected an array";
+            return false;
+        }
+
+        size_t size = value.size();
+        result.resize(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            JsonValue element = value[i];
+            if (!JsonReader<T>::read(element, result[i], error))
+            {
+                error.offset = element.offset();
+                error.path.insert(0, "[" + std::to_string(i) + "]");
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template<class S>
+struct JsonMember
+{
+    using Read = std::function<bool(S& object, const JsonValue& value, JsonError& error)>;
+
+    const char* name;
+    bool required;
+    Read read;
+};
+
+} // namespace details
+
+template<class T>
+bool JsonValue::get(T& value) const
+{
+    details::JsonError error;
+    return details::JsonReader<T>::read(*this, value, error);
+}
+
+/// Describes the members of a JSON object mapped onto the fields of a struct, see jsonFields().
+///
+template<class S>
+class JsonTable
+{
+public:
+    static constexpr size_t MAX_MEMBERS = 64;
+
+    explicit JsonTable(std::vector<details::JsonMember<S>> members) : members_(std::move(members))
+    {
+        if (members_.size() > MAX_MEMBERS)
+        {
+            throw Error() << "Too many JSON members";
+        }
+    }
+
+    /// Reads an object value into a struct, the members not in the value keep their values.
+    ///
+    bool read(S& object, const JsonValue& value, details::JsonError& error) const
+    {
+        if (value.kind() != JsonKind::OBJECT)
+        {
+            error.message = "expected an object";
+            return false;
+        }
+
+        bool seen[MAX_MEMBERS] = {};
+        size_t size = value.size();
+        for (size_t i = 0; i < size; ++i)
+        {
+            JsonValue name = value.name(i);
+            size_t m = 0;
+            while (m < members_.size() && !name.equals(members_[m].name))
+            {
+                ++m;
+            }
+
+            if (m == members_.size())
+            {
+                std::string string;
+                details::JsonReader<std::string>::read(name, string, error);
+                error.offset = name.offset();
+                error.path = "." + string;
+                error.message = "unknown name";
+                return false;
+            }
+
+            JsonValue member = value[i];
+            if (!members_[m].read(object, member, error))
+            {
+                if (error.path.empty())
+                {
+                    error.offset = member.offset();
+                }
+                error.path.insert(0, std::string(".") + members_[m].name);
+                return false;
+            }
+            seen[m] = true;
+        }
+
+        for (size_t m = 0; m < members_.size(); ++m)
+        {
+            if (members_[m].required && !seen[m])
+            {
+                error.offset = value.offset();
+                error.path = std::string(".") + members_[m].name;
+                error.message = "missing";
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<details::JsonMember<S>> members_;
+};
+
+namespace details {
+
+template<class T, class U>
+bool readJson(const JsonTable<U>& table, T& value, const JsonValue& json, JsonError& error)
+{
+    return table.read(value, json, error);
+}
+
+template<class U>
+bool readJson(const JsonTable<U>& table, std::vector<U>& value, const JsonValue& json,
+              JsonError& error)
+{
+    if (json.kind() != JsonKind::ARRAY)
+    {
+        error.message = "expected an array";
+        return false;
+    }
+
+    size_t size = json.size();
+    value.resize(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        JsonValue element = json[i];
+        if (!table.read(value[i], element, error))
+        {
+            if (error.path.empty())
+            {
+                error.offset = element.offset();
+            }
+            error.path.insert(0, "[" + std::to_string(i) + "]");
+            return false;
+        }
+    }
+    return true;
+}
+
+// The tape of the argument being converted, reused by the conversions on a thread
+inline std::vector<JsonEntry>& jsonScratchTape()
+{
+    thread_local std::vector<JsonEntry> tape;
+    return tape;
+}
+
+template<class S>
+class JsonConverter
+{
+public:
+    explicit JsonConverter(JsonTable<S> table) : table_(std::move(table)) {}
+
+    bool operator()(const Char* begin, const Char* end, S& value) const
+    {
+        JsonError error;
+        return convert(begin, end, value, error);
+    }
+
+    std::string getValidValues() const { return {}; }
+
+    std::string describeError(const Char* begin, const Char* end) const
+    {
+        S value{};
+        JsonError error;
+        return convert(begin, end, value, error) ? std::string() : error.format();
+    }
+
+private:
+    bool convert(const Char* begin, const Char* end, S& value, JsonError& error) const
+    {
+        auto& tape = jsonScratchTape();
+        return JsonParser(begin, end, tape, error).parse() &&
+               table_.read(value, JsonValue(begin, tape.data(), 0), error);
+    }
+
+    JsonTable<S> table_;
+};
+
+template<>
+struct Converter<JsonTape>
+{
+    bool operator()(const Char* begin, const Char* end, JsonTape& value) const
+    {
+        JsonError error;
+        return value.tryParse(begin, end, error);
+    }
+
+    std::string getValidValues() const { return {}; }
+
+    std::string describeError(const Char* begin, const Char* end) const
+    {
+        JsonTape tape;
+        JsonError error;
+        return tape.tryParse(begin, end, error) ? std::string() : error.format();
+    }
+};
+
+// Writes the JSON text as is
+template<>
+struct ValueWriter<JsonTape>
+{
+    static void write(std::string& buffer, const JsonTape& value, bool)
+    {
+        JsonValue root = value.root();
+        if (root.kind() == JsonKind::NONE)
+        {
+            buffer += "null";
+            return;
+        }
+
+        for (size_t i = 0; i < root.textSize(); ++i)
+        {
+            auto c = static_cast<uint32_t>(root.data()[i]);
+            buffer += c <= 127 ? static_cast<char>(c) : '?';
+        }
+    }
+};
+
+} // namespace details
+
+/// Describes a JSON object member mapped onto a struct field, see jsonFields(). The field
+/// is bool, arithmetic, a string or a std::vector of them.
+///
+template<class S, class T>
+details::JsonMember<S> jsonField(T S::*member, const char* name,
+                                 ParamType type = ParamType::REQUIRED)
+{
+    return {name, type == ParamType::REQUIRED,
+            [member](S& object, const JsonValue& value, details::JsonError& error) {
+                return details::JsonReader<T>::read(value, object.*member, error);
+            }};
+}
+
+/// Describes a JSON object member mapped onto a struct field of type U or std::vector<U> by
+/// a nested table of U, see jsonFields().
+///
+template<class S, class T, class U>
+details::JsonMember<S> jsonField(T S::*member, const char* name, const JsonTable<U>& table,
+                                 ParamType type = ParamType::REQUIRED)
+{
+    return {name, type == ParamType::REQUIRED,
+            [member, table](S& object, const JsonValue& value, details::JsonError& error) {
+                return details::readJson(table, object.*member, value, error);
+            }};
+}
+
+/// Returns a table of the members of a JSON object mapped onto a struct, e.g.
+///     static const auto LIMITS = jsonFields(jsonField(&Limits::cpu, "cpu"),
+///                                           jsonField(&Limits::memory, "memory", OPTIONAL));
+///     static const auto POLICY = jsonFields(jsonField(&Policy::limits, "limits", LIMITS));
+///     parser.addParam(policy, "policy", "Policy", json(POLICY));
+/// A JSON object must not have other members.
+///
+template<class S, class... M>
+JsonTable<S> jsonFields(details::JsonMember<S> member, M... members)
+{
+    return JsonTable<S>({std::move(member), std::move(members)...});
+}
+
+/// Returns a converter of JSON arguments into a struct described by a table, see jsonFields().
+/// The argument is checked and mapped in place without copying its strings other than into
+/// the string fields. A bad argument is reported with the JSON path of the failing value,
+/// e.g. "$.limits.cpu: expected an integer in range at offset 19".
+///
+template<class S>
+details::JsonConverter<S> json(JsonTable<S> table)
+{
+    return details::JsonConverter<S>(std::move(table));
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
@@ -0,0 +1,361 @@
+// Command line argument parser: parse latency histograms
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Log-linear latency buckets in nanoseconds like in HDR histograms: values below 8 have their
+// own buckets and every power of 2 above is split into 8 buckets, so a bucket is within 12.5%
+// of its values. Values from 2^40 ns, about 18 minutes, share the last bucket.
+struct LatencyBuckets
+{
+    static constexpr size_t SUB_BITS = 3;
+    static constexpr size_t SUB_COUNT = size_t(1) << SUB_BITS;
+    static constexpr size_t MAX_EXPONENT = 40;
+    static constexpr size_t COUNT = (MAX_EXPONENT - SUB_BITS + 1) * SUB_COUNT;
+
+    static size_t bucket(uint64_t value)
+    {
+        if (value < SUB_COUNT)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        size_t exponent = 0;
+        while ((value >> (exponent + 1)) != 0)
+        {
+            ++exponent;
+        }
+
+        size_t sub = static_cast<size_t>(value >> (exponent - SUB_BITS)) & (SUB_COUNT - 1);
+        return std::min((exponent - SUB_BITS + 1) * SUB_COUNT + sub, COUNT - 1);
+    }
+
+    // Returns the highest value of a bucket
+    static uint64_t value(size_t bucket)
+    {
+        if (bucket < SUB_COUNT)
+        {
+            return bucket;
+        }
+
+        size_t exponent = bucket / SUB_COUNT + SUB_BITS - 1;
+        uint64_t width = uint64_t(1) << (exponent - SUB_BITS);
+        return (SUB_COUNT + bucket % SUB_COUNT) * width + width - 1;
+    }
+};
+
+// Number of arguments after the executable name: 0-3, 4-15, 16-63 and 64 or more
+inline size_t sizeClass(int argc)
+{
+    size_t args = argc > 1 ? static_cast<size_t>(argc - 1) : 0;
+    return args < 4 ? 0 : (args < 16 ? 1 : (args < 64 ? 2 : 3));
+}
+
+inline size_t threadShard(size_t shardCount)
+{
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+    return shard % shardCount;
+}
+
+} // namespace details
+
+/// Merged counts of a LatencyHistogram, see LatencyHistogram::snapshot().
+///
+class LatencySnapshot
+{
+public:
+    static constexpr size_t OUTCOME_COUNT = static_cast<size_t>(ParseOutcome::OTHER_ERROR) + 1;
+    static constexpr size_t SIZE_CLASS_COUNT = 4;
+    static constexpr size_t SERIES_COUNT = OUTCOME_COUNT * SIZE_CLASS_COUNT;
+
+    LatencySnapshot() : counts_(SERIES_COUNT * details::LatencyBuckets::COUNT, 0) {}
+
+    /// Returns the number of parses with an outcome, of all sizes or of a size class:
+    /// 0 for 0-3 arguments after the executable name, 1 for 4-15, 2 for 16-63 and 3 for more.
+    ///
+    uint64_t count(ParseOutcome outcome) const
+    {
+        uint64_t count = 0;
+        for (size_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+        {
+            count += this->count(outcome, sizeClass);
+        }
+        return count;
+    }
+
+    uint64_t count(ParseOutcome outcome, size_t sizeClass) const
+    {
+        const uint64_t* counts = series(outcome, sizeClass);
+        uint64_t count = 0;
+        for (size_t i = 0; i < details::LatencyBuckets::COUNT; ++i)
+        {
+            count += counts[i];
+        }
+        return count;
+    }
+
+    /// Returns the latency at a percentile, e.g. 99.9, of the parses with an outcome, of all
+    /// sizes or of a size class, or 0 if there are none. The latency is the highest one of its
+    /// bucket, at most 12.5% above the recorded one.
+    ///
+    std::chrono::nanoseconds percentile(ParseOutcome outcome, double percent) const
+    {
+        std::vector<uint64_t> counts(details::LatencyBuckets::COUNT, 0);
+        for (size_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+        {
+            const uint64_t* series = this->series(outcome, sizeClass);
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                counts[i] += series[i];
+            }
+        }
+        return percentile(counts.data(), percent);
+    }
+
+    std::chrono::nanoseconds percentile(ParseOutcome outcome, size_t sizeClass,
+                                        double percent) const
+    {
+        return percentile(series(outcome, sizeClass), percent);
+    }
+
+    /// Adds the counts of another snapshot, e.g. of another process.
+    ///
+    void merge(const LatencySnapshot& other)
+    {
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+    }
+
+    /// Appends the count and the p50, p90, p99, p99.9 and max latencies in nanoseconds of
+    /// every outcome and size class with parses, e.g. for a monitoring endpoint:
+    /// - TEXT: "bad-argument 4-15: count 3, p50 1535, p90 1791, p99 1791, p99.9 1791, max 1791"
+    ///   lines
+    /// - JSON: {"bad-argument": {"4-15": {"count": 3, "p50": 1535, ...}}} object
+    ///
+    void dump(std::string& buffer, DumpFormat format = DumpFormat::TEXT) const
+    {
+        static const char* const OUTCOMES[] = {
+            "success",          "unexpected-argument", "repeated-argument",
+            "bad-argument",     "missing-argument",    "other-error",
+        };
+        static const char* const SIZE_CLASSES[] = {"0-3", "4-15", "16-63", "64+"};
+        static const char* const PERCENTILES[] = {"p50", "p90", "p99", "p99.9", "max"};
+        static const double PERCENTS[] = {50, 90, 99, 99.9, 100};
+
+        bool json = format == DumpFormat::JSON;
+        const char* outcomeDelimiter = "";
+        if (json)
+        {
+            buffer += '{';
+        }
+
+        for (size_t outcome = 0; outcome < OUTCOME_COUNT; ++outcome)
+        {
+            const char* sizeDelimiter = "";
+            for (size_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+            {
+                auto parseOutcome = static_cast<ParseOutcome>(outcome);
+                uint64_t count = this->count(parseOutcome, sizeClass);
+                if (count == 0)
+                {
+                    continue;
+                }
+
+                if (json)
+                {
+                    if (*sizeDelimiter == '\0')
+                    {
+                        buffer += outcomeDelimiter;
+                        outcomeDelimiter = ",";
+                        buffer += std::string("\"") + OUTCOMES[outcome] + "\":{";
+                    }
+                    buffer += sizeDelimiter;
+                    buffer += std::string("\"") + SIZE_CLASSES[sizeClass] + "\":{\"count\":";
+                }
+                else
+                {
+                    buffer += std::string(OUTCOMES[outcome]) + " " + SIZE_CLASSES[sizeClass] +
+                              ": count ";
+                }
+                sizeDelimiter = ",";
+                buffer += std::to_string(count);
+
+                for (size_t i = 0; i < 5; ++i)
+                {
+                    auto latency = percentile(parseOutcome, sizeClass, PERCENTS[i]).count();
+                    buffer += json ? std::string(",\"") + PERCENTILES[i] + "\":"
+                                   : std::string(", ") + PERCENTILES[i] + " ";
+                    buffer += std::to_string(latency);
+                }
+                buffer += json ? "}" : "\n";
+            }
+
+            if (json && *sizeDelimiter != '\0')
+            {
+                buffer += '}';
+            }
+        }
+
+        if (json)
+        {
+            buffer += '}';
+        }
+    }
+
+private:
+    friend class LatencyHistogram;
+
+    const uint64_t* series(ParseOutcome outcome, size_t sizeClass) const
+    {
+        return counts_.data() + (static_cast<size_t>(outcome) * SIZE_CLASS_COUNT + sizeClass) *
+                                    details::LatencyBuckets::COUNT;
+    }
+
+    static std::chrono::nanoseconds percentile(const uint64_t* counts, double percent)
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < details::LatencyBuckets::COUNT; ++i)
+        {
+            total += counts[i];
+        }
+
+        if (total == 0)
+        {
+            return std::chrono::nanoseconds(0);
+        }
+
+        // The rank of the value at the percentile, from 1
+        auto rank = static_cast<uint64_t>(percent / 100 * static_cast<double>(total) + 0.5);
+        rank = std::min(std::max<uint64_t>(rank, 1), total);
+
+        uint64_t seen = 0;
+        size_t bucket = 0;
+        for (; bucket < details::LatencyBuckets::COUNT - 1; ++bucket)
+        {
+            seen += counts[bucket];
+            if (seen >= rank)
+            {
+                break;
+            }
+        }
+        return std::chrono::nanoseconds(
+            static_cast<std::chrono::nanoseconds::rep>(details::LatencyBuckets::value(bucket)));
+    }
+
+    std::vector<uint64_t> counts_;
+};
+
+/// Parse latency histogram by outcome and number of arguments, e.g. for a service parsing
+/// command lines of requests:
+///     LatencyHistogram histogram;
+///     parser.setLatencyObserver(histogram);
+///     ...
+///     histogram.snapshot().dump(buffer, DumpFormat::JSON);
+/// Recording takes no lock: the counts are kept in shards, each used by a part of the threads,
+/// and the shard of a thread is allocated when it first records. Copies of a histogram share
+/// the counts, so one can observe the parsers of several threads.
+///
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : state_(std::make_shared<State>()) {}
+
+    void operator()(int argc, ParseOutcome outcome, std::chrono::nanoseconds duration) const
+    {
+        record(argc, outcome, duration);
+    }
+
+    void record(int argc, ParseOutcome outcome, std::chrono::nanoseconds duration) const
+    {
+        auto& shardPointer = state_->shards[details::threadShard(SHARD_COUNT)];
+        Shard* shard = shardPointer.load(std::memory_order_acquire);
+        if (shard == nullptr)
+        {
+            auto created = std::make_unique<Shard>();
+            if (shardPointer.compare_exchange_strong(shard, created.get(),
+                                                     std::memory_order_acq_rel))
+            {
+                shard = created.release();
+            }
+        }
+
+        auto nanoseconds = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(
+            duration.count(), 0));
+        size_t series = static_cast<size_t>(outcome) * LatencySnapshot::SIZE_CLASS_COUNT +
+                        details::sizeClass(argc);
+        shard->counts[series * details::LatencyBuckets::COUNT +
+                      details::LatencyBuckets::bucket(nanoseconds)]
+            .fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Returns the counts merged over the shards, the parses recorded meanwhile may be left
+    /// out.
+    ///
+    LatencySnapshot snapshot() const
+    {
+        LatencySnapshot snapshot;
+        for (const auto& shardPointer : state_->shards)
+        {
+            const Shard* shard = shardPointer.load(std::memory_order_acquire);
+            if (shard == nullptr)
+            {
+                continue;
+            }
+
+            for (size_t i = 0; i < snapshot.counts_.size(); ++i)
+            {
+                snapshot.counts_[i] += shard->counts[i].load(std::memory_order_relaxed);
+            }
+        }
+        return snapshot;
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 8;
+
+    struct Shard
+    {
+        std::array<std::atomic<uint64_t>,
+                   LatencySnapshot::SERIES_COUNT * details::LatencyBuckets::COUNT>
+            counts{};
+    };
+
+    struct State
+    {
+        ~State()
+        {
+            for (auto& shard : shards)
+            {
+                delete shard.load();
+            }
+        }
+
+        std::array<std::atomic<Shard*>, SHARD_COUNT> shards{};
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace cmd_line_args
+} // namespace over9000
@@ -6,12 +6,25 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
 #include <exception>
+#include <functional>
 #include <iomanip>
+#include <limits>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace over9000 {
@@ -100,21 +113,298 @@ enum class ParamType
 constexpr ParamType REQUIRED = ParamType::REQUIRED;
 constexpr ParamType OPTIONAL = ParamType::OPTIONAL;
 
+/// Runs asynchronous conversions, see async.h.
+///
+using Executor = std::function<void(std::function<void()>)>;
+
+/// Observes every Parser::parse() call with its arguments and the error message or nullptr on
+/// success, e.g. a CorpusWriter from corpus.h.
+///
+using Capture = std::function<void(int argc, const Char* const argv[], const char* error)>;
+
+/// Limits on the parsed command line, e.g. for command lines from untrusted sources.
+/// 0 means unlimited.
+///
+struct Limits
+{
+    size_t maxArgLength = 0;   ///< Max length of a single argument
+    size_t maxTotalLength = 0; ///< Max total length of all arguments including terminators
+    size_t maxErrorLength = 0; ///< Max length of an argument or valid values in an error message
+};
+
+/// Format of Parser::dump().
+///
+enum class DumpFormat
+{
+    TEXT, ///< name = value lines
+    JSON, ///< {"name": value} object
+};
+
 namespace details {
 
+// An asynchronous conversion started by Param::parseAsync()
+class Pending
+{
+public:
+    virtual ~Pending() {}
+
+    // Waits for the conversion and stores the value, returns false on a bad value
+    virtual bool join() = 0;
+};
+
+// An asynchronously converted value
+template<class T>
+class AsyncValue
+{
+public:
+    virtual ~AsyncValue() {}
+
+    // Waits for the conversion and moves the value out, returns false on a bad value
+    virtual bool get(T& value) = 0;
+};
+
+template<class T, class Store>
+class PendingValue : public Pending
+{
+public:
+    PendingValue(std::unique_ptr<AsyncValue<T>> value, Store store)
+        : value_(std::move(value)), store_(std::move(store))
+    {
+    }
+
+    bool join() override
+    {
+        T value;
+        return value_->get(value) && store_(std::move(value));
+    }
+
+private:
+    std::unique_ptr<AsyncValue<T>> value_;
+    Store store_;
+};
+
+// A value rejected before its conversion, e.g. of a full list
+class RejectedPending : public Pending
+{
+public:
+    bool join() override { return false; }
+};
+
+// Store returns false if it rejects the value
+template<class T, class Store>
+std::unique_ptr<Pending> makePending(std::unique_ptr<AsyncValue<T>> value, Store store)
+{
+    if (value == nullptr)
+    {
+        return nullptr;
+    }
+    return std::make_unique<PendingValue<T, Store>>(std::move(value), std::move(store));
+}
+
+// Saved values of parameters, e.g. the defaults of Parser::captureDefaults(). Trivially copyable
+// values are kept in one byte buffer and restored with memcpy, other values are kept as copies.
+class ValueSnapshot
+{
+public:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    // Returns the slot of the saved value
+    template<class T>
+    size_t save(const T& value)
+    {
+        return save(value, std::integral_constant<int, SnapshotKind<T>::value>());
+    }
+
+    template<class T>
+    void restore(size_t slot, T& value) const
+    {
+        if (slot != NONE)
+        {
+            restore(slot, value, std::integral_constant<int, SnapshotKind<T>::value>());
+        }
+    }
+
+    // Removes all values keeping the buffer for reuse
+    void clear()
+    {
+        bytes_.clear();
+        values_.clear();
+    }
+
+private:
+    enum
+    {
+        NOT_COPYABLE,
+        TRIVIAL,
+        COPY,
+    };
+
+    template<class T>
+    using SnapshotKind = std::integral_constant<
+        int, std::is_trivially_copyable<T>::value ? TRIVIAL
+             : std::is_copy_constructible<T>::value && std::is_copy_assignable<T>::value
+                 ? COPY
+                 : NOT_COPYABLE>;
+
+    class Value
+    {
+    public:
+        virtual ~Value() {}
+    };
+
+    template<class T>
+    class ValueImpl : public Value
+    {
+    public:
+        explicit ValueImpl(const T& value) : value_(value) {}
+
+        const T& get() const { return value_; }
+
+    private:
+        T value_;
+    };
+
+    template<class T>
+    size_t save(const T& value, std::integral_constant<int, TRIVIAL>)
+    {
+        size_t slot = bytes_.size();
+        bytes_.resize(slot + sizeof(T));
+        std::memcpy(&bytes_[slot], &value, sizeof(T));
+        return slot;
+    }
+
+    template<class T>
+    size_t save(const T& value, std::integral_constant<int, COPY>)
+    {
+        values_.push_back(std::make_unique<ValueImpl<T>>(value));
+        return values_.size() - 1;
+    }
+
+    template<class T>
+    size_t save(const T&, std::integral_constant<int, NOT_COPYABLE>)
+    {
+        return NONE;
+    }
+
+    template<class T>
+    void restore(size_t slot, T& value, std::integral_constant<int, TRIVIAL>) const
+    {
+        std::memcpy(&value, &bytes_[slot], sizeof(T));
+    }
+
+    template<class T>
+    void restore(size_t slot, T& value, std::integral_constant<int, COPY>) const
+    {
+        value = static_cast<const ValueImpl<T>&>(*values_[slot]).get();
+    }
+
+    template<class T>
+    void restore(size_t, T&, std::integral_constant<int, NOT_COPYABLE>) const
+    {
+    }
+
+    std::vector<unsigned char> bytes_;
+    std::vector<std::unique_ptr<Value>> values_;
+};
+
+// Truncates a string for an error message, 0 means unlimited
+template<class C>
+std::basic_string<C> truncate(std::basic_string<C> string, size_t maxLength)
+{
+    if (maxLength != 0 && string.size() > maxLength)
+    {
+        string.resize(maxLength);
+        string.append(3, '.');
+    }
+    return string;
+}
+
+// Truncates a string copying only the kept characters
+template<class C>
+std::basic_string<C> truncate(const C* begin, const C* end, size_t maxLength)
+{
+    if (maxLength != 0 && static_cast<size_t>(end - begin) > maxLength)
+    {
+        return std::basic_string<C>(begin, begin + maxLength).append(3, '.');
+    }
+    return std::basic_string<C>(begin, end);
+}
+
+// Name or help text of a parameter, either owned or referring to a null terminated string that
+// outlives the parameter, e.g. a literal of a field table, so that binding one does not allocate
+class ParamText
+{
+public:
+    ParamText(std::string string)
+        : string_(std::move(string)), data_(string_.c_str()), size_(string_.size()), owned_(true)
+    {
+    }
+
+    ParamText(const ParamText& other)
+        : string_(other.string_)
+        , data_(other.owned_ ? string_.c_str() : other.data_)
+        , size_(other.size_)
+        , owned_(other.owned_)
+    {
+    }
+
+    ParamText(ParamText&& other)
+        : string_(std::move(other.string_))
+        , data_(other.owned_ ? string_.c_str() : other.data_)
+        , size_(other.size_)
+        , owned_(other.owned_)
+    {
+    }
+
+    ParamText& operator=(const ParamText&) = delete;
+
+    static ParamText view(const char* string) { return ParamText(string, std::strlen(string)); }
+
+    const char* data() const { return data_; }
+    const char* c_str() const { return data_; }
+    size_t size() const { return size_; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    std::string str() const { return std::string(data_, size_); }
+
+    bool operator==(const ParamText& rhs) const
+    {
+        return size_ == rhs.size_ && std::memcmp(data_, rhs.data_, size_) == 0;
+    }
+
+    friend std::ostream& operator<<(std::ostream& lhs, const ParamText& rhs)
+    {
+        return lhs.write(rhs.data_, static_cast<std::streamsize>(rhs.size_));
+    }
+
+private:
+    ParamText(const char* data, size_t size) : data_(data), size_(size), owned_(false) {}
+
+    std::string string_;
+    const char* data_;
+    size_t size_;
+    bool owned_;
+};
+
 class Param
 {
 public:
     Param(std::string longName, char shortName, std::string help, ParamType type, bool flag)
+        : Param(ParamText(std::move(longName)), shortName, ParamText(std::move(help)), type, flag)
+    {
+    }
+
+    Param(ParamText longName, char shortName, ParamText help, ParamType type, bool flag)
         : longName_(std::move(longName))
         , shortName_(shortName)
         , help_(std::move(help))
         , optional_(type == ParamType::OPTIONAL)
         , flag_(flag)
     {
-        if (shortName != '\0' && shortName <= ' ')
+        if (shortName != '\0' &&
+            (shortName <= ' ' || static_cast<unsigned char>(shortName) > 127))
         {
-            throw Error() << "Bad short name for parameter: --" << longName_;
+            throw Error() << "Bad short name for parameter: --" << longName_.str();
         }
     }
 
@@ -138,21 +428,42 @@ protected:
     friend class ::over9000::cmd_line_args::Parser;
 
     virtual bool isList() const = 0;
-    virtual void parse(std::basic_istream<Char>& stream) = 0;
+    virtual bool parse(const Char* begin, const Char* end,
+                       std::basic_stringstream<Char>& stream) = 0;
+    virtual bool isAsync() const = 0;
+    virtual std::unique_ptr<Pending> parseAsync(const Char* begin, const Char* end,
+                                                const Executor& executor) = 0;
     virtual std::string getValidValues() const = 0;
-
-    std::string longName_;
+    // Returns the valid values truncated for an error message, building only about maxLength
+    // characters if the converter supports it
+    virtual std::string getTruncatedValidValues(size_t maxLength) const
+    {
+        return truncate(getValidValues(), maxLength);
+    }
+    virtual std::string describeError(const Char* begin, const Char* end) const = 0;
+    // Whether a list parameter cannot take more values, e.g. a StaticVector
+    virtual bool isListFull() const { return false; }
+    virtual void dump(std::string& buffer, bool json) const = 0;
+    // Saves the value and returns its slot in the snapshot
+    virtual size_t save(ValueSnapshot& snapshot) const = 0;
+    virtual void restore(const ValueSnapshot& snapshot, size_t slot) = 0;
+    // Completes the value once the arguments are parsed, e.g. builds a set
+    virtual void finish() {}
+
+    ParamText longName_;
     char shortName_ = '\0';
-    std::string help_;
+    ParamText help_;
     size_t index_ = 0; // 0 for named params, 1-based index for positional params
     bool optional_ = false;
     bool flag_ = false;
     bool parsed_ = false;
+    size_t defaultSlot_ = ValueSnapshot::NONE;
+    size_t undoSlot_ = ValueSnapshot::NONE; // The value before the current parse if saved
 };
 
 #ifdef _WIN32
 
-std::string toASCII(const std::wstring& string, const char* what)
+inline std::string toASCII(const std::wstring& string, const char* what)
 {
     std::string ascii;
     ascii.reserve(string.size());
@@ -168,25 +479,209 @@ std::string toASCII(const std::wstring& string, const char* what)
     return ascii;
 }
 
-std::wstring fromASCII(const std::string& string)
+inline std::wstring fromASCII(const std::string& string)
 {
     return {string.begin(), string.end()};
 }
 
 #else
 
-std::string toASCII(std::string string, const char* what)
+inline std::string toASCII(std::string string, const char* what)
 {
     return std::move(string);
 }
 
-std::string fromASCII(std::string string)
+inline std::string fromASCII(std::string string)
 {
     return std::move(string);
 }
 
 #endif
 
+// Name lookup key referring to the argument characters
+struct NameRef
+{
+    const char* data;
+    size_t size;
+};
+
+// Open addressing index of parameters by long name, the names are kept by the parameters
+class NameIndex
+{
+public:
+    // Makes room for a total number of names so that adding them does not rehash
+    void reserve(size_t size)
+    {
+        size_t capacity = std::max<size_t>(slots_.size(), 16);
+        while (capacity < 2 * size)
+        {
+            capacity *= 2;
+        }
+
+        if (capacity != slots_.size())
+        {
+            rehash(capacity);
+        }
+    }
+
+    Param* find(NameRef name) const
+    {
+        return slots_.empty() ? nullptr : slots_[findSlot(name)].param;
+    }
+
+    // The name must not be there yet
+    void insert(NameRef name, Param* param)
+    {
+        if (2 * (size_ + 1) > slots_.size())
+        {
+            rehash(slots_.empty() ? 16 : slots_.size() * 2);
+        }
+        slots_[findSlot(name)] = {name, param};
+        ++size_;
+    }
+
+private:
+    struct Slot
+    {
+        NameRef name;
+        Param* param;
+    };
+
+    static size_t hash(NameRef name)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < name.size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(name.data[i])) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+
+    // Returns the slot of the name or an empty slot for it
+    size_t findSlot(NameRef name) const
+    {
+        size_t mask = slots_.size() - 1;
+        size_t i = hash(name) & mask;
+        for (; slots_[i].param != nullptr; i = (i + 1) & mask)
+        {
+            const NameRef& slotName = slots_[i].name;
+            if (slotName.size == name.size &&
+                std::memcmp(slotName.data, name.data, name.size) == 0)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> slots(capacity, Slot{{nullptr, 0}, nullptr});
+        slots_.swap(slots);
+        for (const auto& slot : slots)
+        {
+            if (slot.param != nullptr)
+            {
+                slots_[findSlot(slot.name)] = slot;
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+};
+
+enum class TokenKind : uint8_t
+{
+    VALUE,           // value or positional argument
+    SHORT,           // -s
+    LONG,            // --long-opt
+    LONG_WITH_VALUE, // --long-opt=value
+};
+
+struct Token
+{
+    const Char* arg;
+    uint32_t size;
+    uint32_t equalPos; // for LONG_WITH_VALUE
+    uint32_t index;    // argv index
+    TokenKind kind;
+};
+
+inline size_t length(const char* string)
+{
+    return std::strlen(string);
+}
+
+inline size_t length(const wchar_t* string)
+{
+    return std::wcslen(string);
+}
+
+inline const char* find(const char* begin, const char* end, char c)
+{
+    return static_cast<const char*>(std::memchr(begin, c, static_cast<size_t>(end - begin)));
+}
+
+inline const wchar_t* find(const wchar_t* begin, const wchar_t* end, wchar_t c)
+{
+    return std::wmemchr(begin, c, static_cast<size_t>(end - begin));
+}
+
+// Classifies all arguments up front so that the parse loop only dispatches on the token kind.
+// Lengths and '=' positions are found with the (vectorized) C library string functions.
+inline void classify(int argc, const Char* const argv[], const Limits& limits,
+                     std::vector<Token>& tokens)
+{
+    tokens.resize(argc > 1 ? static_cast<size_t>(argc - 1) : 0);
+
+    size_t maxArgLength = limits.maxArgLength != 0 ? limits.maxArgLength : UINT32_MAX;
+    size_t maxTotalLength = limits.maxTotalLength != 0 ? limits.maxTotalLength : SIZE_MAX;
+    size_t totalLength = 0;
+
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        const Char* arg = argv[i + 1];
+        if (arg == nullptr)
+        {
+            throw Error() << "Bad argument #" << (i + 2);
+        }
+
+        size_t size = length(arg);
+        if (size > maxArgLength)
+        {
+            throw Error() << "Too long argument #" << (i + 2);
+        }
+
+        totalLength += size + 1;
+        if (totalLength > maxTotalLength)
+        {
+            throw Error() << "Too long command line at argument #" << (i + 2);
+        }
+
+        Token& token = tokens[i];
+        token.arg = arg;
+        token.size = static_cast<uint32_t>(size);
+        token.equalPos = 0;
+        token.index = static_cast<uint32_t>(i + 1);
+
+        bool dash = size >= 2 && arg[0] == '-';
+        bool dashDash = dash && arg[1] == '-' && size > 2;
+        token.kind = dashDash ? TokenKind::LONG
+                              : (dash && size == 2 ? TokenKind::SHORT : TokenKind::VALUE);
+
+        if (dashDash)
+        {
+            const Char* equal = find(arg + 2, arg + size, '=');
+            if (equal != nullptr)
+            {
+                token.kind = TokenKind::LONG_WITH_VALUE;
+                token.equalPos = static_cast<uint32_t>(equal - arg);
+            }
+        }
+    }
+}
+
 template<class T>
 struct Converter
 {
@@ -242,41 +737,574 @@ struct EnumConverter
         }
     }
 
-    std::string getValidValues() const
+    std::string getValidValues() const { return getValidValues(0); }
+
+    // Lists the values until the list is longer than maxLength, 0 means unlimited
+    std::string getValidValues(size_t maxLength) const
     {
-        std::ostringstream stream;
+        std::string result;
         const char* delimiter = "";
         for (const auto& v : values)
         {
-            stream << delimiter << v.first;
+            if (maxLength != 0 && result.size() > maxLength)
+            {
+                break;
+            }
+            result += delimiter;
+            result += v.first;
             delimiter = ", ";
         }
-        return stream.str();
+        return truncate(std::move(result), maxLength);
+    }
+
+    // Returns the name of a value or nullptr
+    const std::string* findName(const T& value) const
+    {
+        for (const auto& v : values)
+        {
+            if (v.second == value)
+            {
+                return &v.first;
+            }
+        }
+        return nullptr;
     }
 
     std::map<std::string, T> values;
 };
 
 template<class T>
+struct IsString : std::false_type
+{
+};
+
+template<class C, class Traits, class Allocator>
+struct IsString<std::basic_string<C, Traits, Allocator>> : std::true_type
+{
+};
+
+// A list parameter target is a container of values with clear() and push_back(), e.g.
+// std::vector, std::deque, SmallVector or a user container, while strings are single values
+template<class T, class = void>
+struct IsListContainer : std::false_type
+{
+};
+
+template<class T>
+struct IsListContainer<
+    T, decltype(std::declval<T&>().clear(),
+                std::declval<T&>().push_back(std::declval<typename T::value_type>()), void())>
+    : std::integral_constant<bool, !IsString<T>::value>
+{
+};
+
+template<class T, class = void>
 struct TypeTraits
 {
     using ValueType = T;
     using EnumValuesType = std::map<std::string, T>;
+    static constexpr bool IS_LIST = false;
 };
 
 template<class T>
-struct TypeTraits<std::vector<T>>
+struct TypeTraits<T, typename std::enable_if<IsListContainer<T>::value>::type>
 {
-    using ValueType = T;
-    using EnumValuesType = std::map<std::string, T>;
+    using ValueType = typename T::value_type;
+    using EnumValuesType = std::map<std::string, ValueType>;
+    static constexpr bool IS_LIST = true;
 };
 
-template<class T, class Converter>
-class ParamImpl : public Param
+// A converter either reads a value from a stream:
+//   void operator()(std::basic_istream<Char>& stream, T& value);
+// or converts the argument characters directly, returning false on a bad value:
+//   bool operator()(const Char* begin, const Char* end, T& value);
+// The latter is preferred when both are available since it avoids copying the argument.
+
+template<class Converter, class T, class = void>
+struct IsStreamConverter : std::false_type
 {
-public:
-    ParamImpl(T& value, std::string longName, char shortName, std::string help, ParamType type,
-              bool flag, Converter converter)
+};
+
+template<class Converter, class T>
+struct IsStreamConverter<Converter, T,
+                         decltype(std::declval<Converter&>()(
+                                      std::declval<std::basic_istream<Char>&>(),
+                                      std::declval<T&>()),
+                                  void())> : std::true_type
+{
+};
+
+template<class Converter, class T, class = void>
+struct IsRangeConverter : std::false_type
+{
+};
+
+template<class Converter, class T>
+struct IsRangeConverter<Converter, T,
+                        decltype(std::declval<Converter&>()(std::declval<const Char*>(),
+                                                            std::declval<const Char*>(),
+                                                            std::declval<T&>()),
+                                 void())> : std::true_type
+{
+};
+
+template<class Converter, class T>
+struct CanConvert
+    : std::integral_constant<bool, IsStreamConverter<Converter, T>::value ||
+                                       IsRangeConverter<Converter, T>::value>
+{
+};
+
+// Enabled if Converter converts either T itself or, for a list T, its elements
+template<class Converter, class T>
+using EnableIfConverter = typename std::enable_if<
+    CanConvert<Converter, T>::value ||
+    (TypeTraits<T>::IS_LIST &&
+     CanConvert<Converter, typename TypeTraits<T>::ValueType>::value)>::type;
+
+template<class Converter, class T>
+typename std::enable_if<IsRangeConverter<Converter, T>::value, bool>::type convert(
+    Converter& converter, const Char* begin, const Char* end, std::basic_stringstream<Char>&,
+    T& value)
+{
+    return converter(begin, end, value);
+}
+
+template<class Converter, class T>
+typename std::enable_if<!IsRangeConverter<Converter, T>::value, bool>::type convert(
+    Converter& converter, const Char* begin, const Char* end,
+    std::basic_stringstream<Char>& stream, T& value)
+{
+    stream.str(std::basic_string<Char>(begin, end));
+    stream.clear();
+    converter(stream, value);
+    return !stream.fail() && stream.eof();
+}
+
+// An asynchronous converter provides
+//   std::unique_ptr<AsyncValue<T>> launch<T>(const Char* begin, const Char* end,
+//                                            const Executor& executor);
+
+template<class Converter, class T, class = void>
+struct IsAsyncConverter : std::false_type
+{
+};
+
+template<class Converter, class T>
+struct IsAsyncConverter<Converter, T,
+                        decltype(std::declval<Converter&>().template launch<T>(
+                                     std::declval<const Char*>(), std::declval<const Char*>(),
+                                     std::declval<const Executor&>()),
+                                 void())> : std::true_type
+{
+};
+
+template<class T, class Converter>
+typename std::enable_if<IsAsyncConverter<Converter, T>::value,
+                        std::unique_ptr<AsyncValue<T>>>::type
+launch(Converter& converter, const Char* begin, const Char* end, const Executor& executor)
+{
+    return converter.template launch<T>(begin, end, executor);
+}
+
+template<class T, class Converter>
+typename std::enable_if<!IsAsyncConverter<Converter, T>::value,
+                        std::unique_ptr<AsyncValue<T>>>::type
+launch(Converter&, const Char*, const Char*, const Executor&)
+{
+    return nullptr;
+}
+
+// A converter may also describe what is wrong with a bad value, e.g. where it stops matching:
+//   std::string describeError(const Char* begin, const Char* end) const;
+
+template<class Converter, class = void>
+struct HasDescribeError : std::false_type
+{
+};
+
+template<class Converter>
+struct HasDescribeError<Converter, decltype(std::declval<const Converter&>().describeError(
+                                                std::declval<const Char*>(),
+                                                std::declval<const Char*>()),
+                                            void())> : std::true_type
+{
+};
+
+template<class Converter>
+typename std::enable_if<HasDescribeError<Converter>::value, std::string>::type describeError(
+    const Converter& converter, const Char* begin, const Char* end)
+{
+    return converter.describeError(begin, end);
+}
+
+template<class Converter>
+typename std::enable_if<!HasDescribeError<Converter>::value, std::string>::type describeError(
+    const Converter&, const Char*, const Char*)
+{
+    return {};
+}
+
+// A converter may also list its valid values truncated to about a max length for error
+// messages, e.g. when there are many of them:
+//   std::string getValidValues(size_t maxLength) const;
+
+template<class Converter, class = void>
+struct HasTruncatedValidValues : std::false_type
+{
+};
+
+template<class Converter>
+struct HasTruncatedValidValues<
+    Converter, decltype(std::declval<const Converter&>().getValidValues(size_t()), void())>
+    : std::true_type
+{
+};
+
+template<class Converter>
+typename std::enable_if<HasTruncatedValidValues<Converter>::value, std::string>::type
+getTruncatedValidValues(const Converter& converter, size_t maxLength)
+{
+    return converter.getValidValues(maxLength);
+}
+
+template<class Converter>
+typename std::enable_if<!HasTruncatedValidValues<Converter>::value, std::string>::type
+getTruncatedValidValues(const Converter& converter, size_t maxLength)
+{
+    return truncate(converter.getValidValues(), maxLength);
+}
+
+// Value formatting for Parser::dump() without streams apart from the fallback for the types
+// that only provide operator<<
+
+inline void appendString(std::string& buffer, const char* begin, const char* end, bool json)
+{
+    if (!json)
+    {
+        buffer.append(begin, end);
+        return;
+    }
+
+    static const char HEX[] = "0123456789abcdef";
+    buffer += '"';
+    for (const char* c = begin; c != end; ++c)
+    {
+        auto u = static_cast<unsigned char>(*c);
+        if (u == '"' || u == '\\')
+        {
+            buffer += '\\';
+            buffer += *c;
+        }
+        else if (u < 0x20)
+        {
+            const char escape[] = {'\\', 'u', '0', '0', HEX[u >> 4], HEX[u & 0xf]};
+            buffer.append(escape, sizeof(escape));
+        }
+        else
+        {
+            buffer += *c;
+        }
+    }
+    buffer += '"';
+}
+
+inline void appendUnsigned(std::string& buffer, unsigned long long value)
+{
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* begin = end;
+    do
+    {
+        *--begin = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    buffer.append(begin, end);
+}
+
+// Reads a floating point number in the "C" locale without streams and heap allocation, failing
+// unless the whole text is a number within the range of T. The text is copied to a stack buffer
+// with the decimal point of the C locale for strtod(), so numbers of 64 characters or more fail.
+template<class T, class C>
+bool readFloatingPoint(const C* begin, const C* end, T& value)
+{
+    using Result = typename std::conditional<std::is_same<T, long double>::value, long double,
+                                             double>::type;
+
+    char number[64];
+    const char* decimalPoint = std::localeconv()->decimal_point;
+    size_t pointSize = std::strlen(decimalPoint);
+    size_t size = 0;
+    for (auto* c = begin; c != end; ++c)
+    {
+        bool point = *c == '.';
+        if (size + (point ? pointSize : 1) >= sizeof(number) ||
+            !((*c >= '0' && *c <= '9') || point || *c == '+' || *c == '-' || *c == 'e' ||
+              *c == 'E'))
+        {
+            return false;
+        }
+
+        if (point)
+        {
+            std::memcpy(number + size, decimalPoint, pointSize);
+            size += pointSize;
+        }
+        else
+        {
+            number[size++] = static_cast<char>(*c);
+        }
+    }
+    number[size] = '\0';
+
+    char* stop = nullptr;
+    Result result = std::is_same<Result, long double>::value ? std::strtold(number, &stop)
+                                                             : std::strtod(number, &stop);
+    if (size == 0 || stop != number + size || !std::isfinite(result) ||
+        std::fabs(result) > std::numeric_limits<T>::max())
+    {
+        return false;
+    }
+    value = static_cast<T>(result);
+    return true;
+}
+
+// Formats a double with snprintf() and replaces the decimal point of the C locale with '.',
+// since JSON requires it
+inline size_t formatDouble(char (&digits)[40], const char* format, double value)
+{
+    auto size = static_cast<size_t>(std::snprintf(digits, sizeof(digits), format, value));
+    const char* decimalPoint = std::localeconv()->decimal_point;
+    size_t pointSize = std::strlen(decimalPoint);
+    char* point = pointSize != 0 ? std::strstr(digits, decimalPoint) : nullptr;
+    if (point != nullptr && std::strcmp(decimalPoint, ".") != 0)
+    {
+        *point = '.';
+        std::memmove(point + 1, point + pointSize,
+                     static_cast<size_t>(digits + size + 1 - (point + pointSize)));
+        size -= pointSize - 1;
+    }
+    return size;
+}
+
+inline void appendDouble(std::string& buffer, double value, bool json)
+{
+    if (!std::isfinite(value))
+    {
+        buffer += json ? "null" : (std::isnan(value) ? "nan" : (value < 0 ? "-inf" : "inf"));
+        return;
+    }
+
+    // The shortest of 15 and 17 significant digits that reads back exactly
+    char digits[40];
+    size_t size = formatDouble(digits, "%.15g", value);
+    double parsed = 0;
+    if (!readFloatingPoint(digits, digits + size, parsed) || parsed != value)
+    {
+        size = formatDouble(digits, "%.17g", value);
+    }
+    buffer.append(digits, size);
+}
+
+template<class T, class = void>
+struct IsStreamWritable : std::false_type
+{
+};
+
+template<class T>
+struct IsStreamWritable<T, decltype(std::declval<std::ostream&>() << std::declval<const T&>(),
+                                    void())> : std::true_type
+{
+};
+
+template<class T, class = void>
+struct ValueWriter
+{
+    static void write(std::string& buffer, const T& value, bool json)
+    {
+        write(buffer, value, json, IsStreamWritable<T>());
+    }
+
+    static void write(std::string& buffer, const T& value, bool json, std::true_type)
+    {
+        std::ostringstream stream;
+        stream << value;
+        auto string = stream.str();
+        appendString(buffer, string.data(), string.data() + string.size(), json);
+    }
+
+    static void write(std::string& buffer, const T&, bool json, std::false_type)
+    {
+        buffer += json ? "null" : "?";
+    }
+};
+
+template<>
+struct ValueWriter<bool>
+{
+    static void write(std::string& buffer, bool value, bool) { buffer += value ? "true" : "false"; }
+};
+
+template<class T>
+struct ValueWriter<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    static void write(std::string& buffer, T value, bool)
+    {
+        auto u = static_cast<unsigned long long>(value);
+        if (value < T())
+        {
+            buffer += '-';
+            u = 0 - u;
+        }
+        appendUnsigned(buffer, u);
+    }
+};
+
+template<class T>
+struct ValueWriter<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+    static void write(std::string& buffer, T value, bool json)
+    {
+        using Underlying = typename std::underlying_type<T>::type;
+        ValueWriter<Underlying>::write(buffer, static_cast<Underlying>(value), json);
+    }
+};
+
+template<class T>
+struct ValueWriter<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static void write(std::string& buffer, T value, bool json)
+    {
+        appendDouble(buffer, static_cast<double>(value), json);
+    }
+};
+
+template<>
+struct ValueWriter<std::string>
+{
+    static void write(std::string& buffer, const std::string& value, bool json)
+    {
+        appendString(buffer, value.data(), value.data() + value.size(), json);
+    }
+};
+
+template<>
+struct ValueWriter<std::wstring>
+{
+    static void write(std::string& buffer, const std::wstring& value, bool json)
+    {
+        std::string ascii(value.size(), '?');
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            if (value[i] >= 0 && value[i] <= 127)
+            {
+                ascii[i] = static_cast<char>(value[i]);
+            }
+        }
+        ValueWriter<std::string>::write(buffer, ascii, json);
+    }
+};
+
+template<class Converter, class T, class = void>
+struct HasFindName : std::false_type
+{
+};
+
+template<class Converter, class T>
+struct HasFindName<Converter, T,
+                   decltype(std::declval<const Converter&>().findName(std::declval<const T&>()),
+                            void())> : std::true_type
+{
+};
+
+// Writes a value by the name from the converter if it has one, e.g. an EnumConverter
+template<class Converter, class T>
+typename std::enable_if<HasFindName<Converter, T>::value>::type writeValue(
+    std::string& buffer, const Converter& converter, const T& value, bool json)
+{
+    const std::string* name = converter.findName(value);
+    if (name != nullptr)
+    {
+        ValueWriter<std::string>::write(buffer, *name, json);
+    }
+    else
+    {
+        ValueWriter<T>::write(buffer, value, json);
+    }
+}
+
+template<class Converter, class T>
+typename std::enable_if<!HasFindName<Converter, T>::value>::type writeValue(
+    std::string& buffer, const Converter&, const T& value, bool json)
+{
+    ValueWriter<T>::write(buffer, value, json);
+}
+
+template<class T, class = void>
+struct HasBuild : std::false_type
+{
+};
+
+template<class T>
+struct HasBuild<T, decltype(std::declval<T&>().build(), void())> : std::true_type
+{
+};
+
+template<class T, class = void>
+struct HasFull : std::false_type
+{
+};
+
+template<class T>
+struct HasFull<T, decltype(std::declval<const T&>().full(), void())> : std::true_type
+{
+};
+
+// Whether a list value of a fixed capacity is full, e.g. a StaticVector from small_vector.h
+template<class List>
+typename std::enable_if<HasFull<List>::value, bool>::type isFull(const List& list)
+{
+    return list.full();
+}
+
+template<class List>
+typename std::enable_if<!HasFull<List>::value, bool>::type isFull(const List&)
+{
+    return false;
+}
+
+// Builds a list value filled by push_back() if it needs that, e.g. a HashSet from set.h
+template<class List>
+typename std::enable_if<HasBuild<List>::value>::type buildList(List& list)
+{
+    list.build();
+}
+
+template<class List>
+typename std::enable_if<!HasBuild<List>::value>::type buildList(List&)
+{
+}
+
+template<class Converter, class List>
+void writeList(std::string& buffer, const Converter& converter, const List& list, bool json)
+{
+    buffer += '[';
+    const char* delimiter = "";
+    for (const auto& value : list)
+    {
+        buffer += delimiter;
+        delimiter = json ? "," : ", ";
+        writeValue(buffer, converter, value, json);
+    }
+    buffer += ']';
+}
+
+template<class T, class Converter, bool List = TypeTraits<T>::IS_LIST>
+class ParamImpl : public Param
+{
+public:
+    ParamImpl(T& value, std::string longName, char shortName, std::string help, ParamType type,
+              bool flag, Converter converter)
         : Param(std::move(longName), shortName, std::move(help), type, flag)
         , converter_(std::move(converter))
         , value_(&value)
@@ -285,615 +1313,1609 @@ public:
 
     bool isList() const override { return false; }
 
-    void parse(std::basic_istream<Char>& stream) override
+    bool parse(const Char* begin, const Char* end, std::basic_stringstream<Char>& stream) override
+    {
+        parsed_ = true;
+        return convert(converter_, begin, end, stream, *value_);
+    }
+
+    bool isAsync() const override { return IsAsyncConverter<Converter, T>::value; }
+
+    std::unique_ptr<Pending> parseAsync(const Char* begin, const Char* end,
+                                        const Executor& executor) override
     {
-        converter_(stream, *value_);
         parsed_ = true;
+        T* value = value_;
+        return makePending(launch<T>(converter_, begin, end, executor),
+                           [value](T&& v) {
+                               *value = std::move(v);
+                               return true;
+                           });
+    }
+
+    std::string getValidValues() const override { return converter_.getValidValues(); }
+
+    std::string getTruncatedValidValues(size_t maxLength) const override
+    {
+        return details::getTruncatedValidValues(converter_, maxLength);
+    }
+
+    std::string describeError(const Char* begin, const Char* end) const override
+    {
+        return details::describeError(converter_, begin, end);
+    }
+
+    void dump(std::string& buffer, bool json) const override
+    {
+        writeValue(buffer, converter_, *value_, json);
+    }
+
+    size_t save(ValueSnapshot& snapshot) const override { return snapshot.save(*value_); }
+
+    void restore(const ValueSnapshot& snapshot, size_t slot) override
+    {
+        snapshot.restore(slot, *value_);
     }
 
-    std::string getValidValues() const override { return converter_.getValidValues(); }
+private:
+    Converter converter_;
+    T* value_ = nullptr;
+};
+
+template<class T, class Converter>
+class ParamImpl<T, Converter, true> : public Param
+{
+public:
+    static_assert(TypeTraits<T>::IS_LIST, "List parameter requires a list value type");
+
+    using ValueType = typename TypeTraits<T>::ValueType;
+
+    ParamImpl(T& value, std::string longName, char shortName, std::string help, ParamType type,
+              bool flag, Converter converter)
+        : Param(std::move(longName), shortName, std::move(help), type, flag)
+        , converter_(std::move(converter))
+        , value_(&value)
+    {
+    }
+
+    bool isList() const override { return true; }
+
+    bool parse(const Char* begin, const Char* end, std::basic_stringstream<Char>& stream) override
+    {
+        // Handle repeated Parser::parse() calls
+        if (!parsed_)
+        {
+            value_->clear();
+        }
+
+        ValueType value;
+        if (isFull(*value_) || !convert(converter_, begin, end, stream, value))
+        {
+            return false;
+        }
+        value_->push_back(std::move(value));
+        parsed_ = true;
+        return true;
+    }
+
+    bool isAsync() const override { return IsAsyncConverter<Converter, ValueType>::value; }
+
+    std::unique_ptr<Pending> parseAsync(const Char* begin, const Char* end,
+                                        const Executor& executor) override
+    {
+        if (!parsed_)
+        {
+            value_->clear();
+        }
+
+        parsed_ = true;
+        if (isFull(*value_))
+        {
+            return std::make_unique<RejectedPending>();
+        }
+
+        // The values are stored in the argument order, so the list may fill up meanwhile
+        T* value = value_;
+        return makePending(launch<ValueType>(converter_, begin, end, executor),
+                           [value](ValueType&& v) {
+                               if (isFull(*value))
+                               {
+                                   return false;
+                               }
+                               value->push_back(std::move(v));
+                               return true;
+                           });
+    }
+
+    std::string getValidValues() const override { return converter_.getValidValues(); }
+
+    std::string getTruncatedValidValues(size_t maxLength) const override
+    {
+        return details::getTruncatedValidValues(converter_, maxLength);
+    }
+
+    std::string describeError(const Char* begin, const Char* end) const override
+    {
+        return details::describeError(converter_, begin, end);
+    }
+
+    bool isListFull() const override { return isFull(*value_); }
+
+    void dump(std::string& buffer, bool json) const override
+    {
+        writeList(buffer, converter_, *value_, json);
+    }
+
+    size_t save(ValueSnapshot& snapshot) const override { return snapshot.save(*value_); }
+
+    void restore(const ValueSnapshot& snapshot, size_t slot) override
+    {
+        snapshot.restore(slot, *value_);
+    }
+
+    void finish() override { buildList(*value_); }
+
+private:
+    Converter converter_;
+    T* value_ = nullptr;
+};
+
+// Parameters owned and registered together, e.g. the fields of an options struct
+class ParamGroup
+{
+public:
+    virtual ~ParamGroup() {}
+
+    virtual size_t size() const = 0;
+    virtual Param& param(size_t i) = 0;
+    virtual bool isPositional(size_t i) const = 0;
+};
+
+// Parameter of the dotted names matching a pattern, where '*' matches one name segment and a
+// trailing '**' one or more of them, e.g. "db.replicas.*.host" or "db.**"
+class PatternParam : public Param
+{
+public:
+    PatternParam(std::string pattern, std::string help, ParamType type)
+        : Param(std::move(pattern), '\0', std::move(help), type, false)
+    {
+        auto name = longName_.str();
+        size_t pos = 0;
+        while (pos <= name.size())
+        {
+            size_t dotPos = std::min(name.find('.', pos), name.size());
+            segments_.push_back(name.substr(pos, dotPos - pos));
+            pos = dotPos + 1;
+        }
+
+        for (size_t i = 0; i < segments_.size(); ++i)
+        {
+            if (segments_[i].empty() || (segments_[i] == "**" && i + 1 != segments_.size()))
+            {
+                throw Error() << "Bad name pattern: --" << name;
+            }
+        }
+    }
+
+    // Matches a name and keeps it as the key of the next value
+    bool match(const Char* begin, const Char* end)
+    {
+        size_t size = static_cast<size_t>(end - begin);
+        size_t pos = 0;
+        for (size_t i = 0; i < segments_.size(); ++i)
+        {
+            if (pos > size)
+            {
+                return false;
+            }
+
+            const Char* dot = find(begin + pos, end, '.');
+            size_t dotPos = dot != nullptr ? static_cast<size_t>(dot - begin) : size;
+            if (dotPos == pos)
+            {
+                return false;
+            }
+
+            const auto& segment = segments_[i];
+            if (segment == "**")
+            {
+                for (size_t j = pos + 1; j < size; ++j)
+                {
+                    if (begin[j] == '.' && begin[j - 1] == '.')
+                    {
+                        return false;
+                    }
+                }
+                if (begin[size - 1] == '.')
+                {
+                    return false;
+                }
+                dotPos = size;
+            }
+            else if (segment != "*" &&
+                     (segment.size() != dotPos - pos ||
+                      !std::equal(segment.begin(), segment.end(), begin + pos)))
+            {
+                return false;
+            }
+            pos = dotPos + 1;
+        }
+
+        if (pos != size + 1)
+        {
+            return false;
+        }
+
+        key_.resize(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (static_cast<typename std::make_unsigned<Char>::type>(begin[i]) > 127)
+            {
+                return false;
+            }
+            key_[i] = static_cast<char>(begin[i]);
+        }
+        return true;
+    }
+
+protected:
+    bool isList() const override { return true; }
+    bool isAsync() const override { return false; }
+
+    std::unique_ptr<Pending> parseAsync(const Char*, const Char*, const Executor&) override
+    {
+        return nullptr;
+    }
+
+    std::string getValidValues() const override { return {}; }
+    std::string describeError(const Char*, const Char*) const override { return {}; }
+
+    // The values are in the tree
+    void dump(std::string& buffer, bool json) const override { buffer += json ? "null" : "..."; }
+
+    // The tree keeps its values, see Parser::addTree()
+    size_t save(ValueSnapshot&) const override { return ValueSnapshot::NONE; }
+    void restore(const ValueSnapshot&, size_t) override {}
+
+    std::vector<std::string> segments_;
+    std::string key_;
+};
+
+// Stores the values of a pattern parameter in a tree providing
+//   void set(const char* key, size_t keySize, const Char* value, size_t valueSize);
+template<class Tree>
+class TreeParam : public PatternParam
+{
+public:
+    TreeParam(Tree& tree, std::string pattern, std::string help, ParamType type)
+        : PatternParam(std::move(pattern), std::move(help), type), tree_(&tree)
+    {
+    }
+
+protected:
+    bool parse(const Char* begin, const Char* end, std::basic_stringstream<Char>&) override
+    {
+        tree_->set(key_.data(), key_.size(), begin, static_cast<size_t>(end - begin));
+        parsed_ = true;
+        return true;
+    }
+
+private:
+    Tree* tree_;
+};
+
+// Returns the usage of a named parameter, e.g. " [-s <name> | --name <name> ...]"
+inline std::string namedUsage(const std::string& longName, char shortName, bool optional,
+                              bool flag, bool list)
+{
+    std::ostringstream output;
+    output << " ";
+
+    if (optional)
+    {
+        output << "[";
+    }
+    else if (shortName != '\0')
+    {
+        output << "(";
+    }
+
+    if (shortName != '\0')
+    {
+        output << "-" << shortName << " <" << longName << "> | ";
+    }
+
+    output << "--" << longName;
+
+    if (!flag)
+    {
+        output << " <" << longName << ">";
+    }
+
+    if (list)
+    {
+        output << " ...";
+    }
+
+    if (optional)
+    {
+        output << "]";
+    }
+    else if (shortName != '\0')
+    {
+        output << ")";
+    }
+
+    return output.str();
+}
+
+// Returns the usage of a positional parameter, e.g. " [<name> ...]"
+inline std::string positionalUsage(const std::string& longName, bool optional, bool list)
+{
+    std::ostringstream output;
+    output << " ";
+
+    if (optional)
+    {
+        output << "[";
+    }
+
+    output << "<" << longName << ">";
+
+    if (list)
+    {
+        output << " ...";
+    }
+
+    if (optional)
+    {
+        output << "]";
+    }
+
+    return output.str();
+}
+
+// Prints the usage line wrapping parameter usages at 80 columns
+inline void printUsage(std::basic_ostream<Char>& stream, const std::basic_string<Char>& exeName,
+                       const std::vector<std::string>& usages)
+{
+    const size_t MAX_WIDTH = 80;
+    std::ostringstream output;
+
+    stream << "Usage: " << exeName;
+
+    size_t usageIndent = 7 + exeName.size(); // "Usage: exeName"
+
+    size_t width = usageIndent;
+
+    for (const auto& usage : usages)
+    {
+        if (width + usage.size() > MAX_WIDTH)
+        {
+            output << "\n" << std::setfill(' ') << std::setw(usageIndent) << "";
+            width = usageIndent;
+        }
+        output << usage;
+        width += usage.size();
+    }
+
+    stream << fromASCII(output.str()) << "\n";
+}
+
+} // namespace details
+
+/// Kind of a problem collected by Parser::parseAll().
+///
+enum class DiagnosticKind
+{
+    UNEXPECTED_ARGUMENT, ///< Argument of no parameter
+    REPEATED_ARGUMENT,   ///< Repeated argument of a non-list parameter
+    BAD_ARGUMENT,        ///< Value the parameter cannot convert
+    MISSING_ARGUMENT,    ///< Required parameter not given
+};
+
+/// Problem found by Parser::parseAll(). It refers to the arguments and the parameters of the
+/// parser rather than holding a message, Parser::format() formats one on request.
+///
+class Diagnostic
+{
+public:
+    DiagnosticKind kind;
+    int arg;           ///< argv index of the argument or 0 for a missing one
+    const char* name;  ///< Long name of the parameter or nullptr for an unexpected argument
+    const Char* value; ///< The bad value or the unexpected or repeated argument
+    size_t size;       ///< Length of the value
+
+private:
+    friend class Parser;
+
+    const details::Param* param_;
+    bool positional_;
+    bool full_; // Bad since the list was full when reported
+};
+
+/// Outcome of a parse observed by a LatencyObserver.
+///
+enum class ParseOutcome
+{
+    SUCCESS,
+    UNEXPECTED_ARGUMENT,
+    REPEATED_ARGUMENT,
+    BAD_ARGUMENT,
+    MISSING_ARGUMENT,
+    OTHER_ERROR, ///< e.g. exceeded Limits
+};
+
+/// Observes the duration of every Parser::parse() and Parser::parseAll() call with the number
+/// of arguments and the outcome, e.g. a LatencyHistogram from latency.h. The duration leaves
+/// out the Capture hook.
+///
+using LatencyObserver =
+    std::function<void(int argc, ParseOutcome outcome, std::chrono::nanoseconds duration)>;
+
+/// Command line arguments parser.
+///
+class Parser
+{
+public:
+    explicit Parser(std::string description) : description_(std::move(description)) {}
+
+    /// Registers a named parameter.
+    /// A corresponding command line argument may be passed as follows (s is a shortName):
+    /// - --longName value
+    /// - --longName=value
+    /// - -s value
+    ///
+    template<class T>
+    void addParam(T& value, std::string longName, char shortName, std::string help,
+                  ParamType type = ParamType::REQUIRED)
+    {
+        addParam(makeParam(value, std::move(longName), shortName, std::move(help), type, false));
+    }
+
+    /// Registers a named parameter.
+    /// A corresponding command line argument may be passed as follows:
+    /// - --longName value
+    /// - --longName=value
+    ///
+    template<class T>
+    void addParam(T& value, std::string longName, std::string help,
+                  ParamType type = ParamType::REQUIRED)
+    {
+        addParam(value, std::move(longName), '\0', std::move(help), type);
+    }
+
+    /// Registers a named parameter with enumerated allowed values.
+    /// A corresponding command line argument may be passed as follows (s is a shortName):
+    /// - --longName value
+    /// - --longName=value
+    /// - -s value
+    ///
+    template<class T>
+    void addParam(T& value, std::string longName, char shortName, std::string help,
+                  typename details::TypeTraits<T>::EnumValuesType enumValues,
+                  ParamType type = ParamType::REQUIRED)
+    {
+        addParam(makeEnumParam(value, std::move(longName), shortName, std::move(help), type, false,
+                               std::move(enumValues)));
+    }
+
+    /// Registers a named parameter with enumerated allowed values.
+    /// A corresponding command line argument may be passed as follows:
+    /// - --longName value
+    /// - --longName=value
+    ///
+    template<class T>
+    void addParam(T& value, std::string longName, std::string help,
+                  typename details::TypeTraits<T>::EnumValuesType enumValues,
+                  ParamType type = ParamType::REQUIRED)
+    {
+        addParam(value, std::move(longName), '\0', std::move(help), std::move(enumValues), type);
+    }
+
+    /// Registers a named parameter converted by a custom converter, e.g. one from bytes.h.
+    /// A list value type is parsed as a list unless the converter converts it as a whole.
+    /// A corresponding command line argument may be passed as follows (s is a shortName):
+    /// - --longName value
+    /// - --longName=value
+    /// - -s value
+    ///
+    template<class T, class Converter, class = details::EnableIfConverter<Converter, T>>
+    void addParam(T& value, std::string longName, char shortName, std::string help,
+                  Converter converter, ParamType type = ParamType::REQUIRED)
+    {
+        addParam(makeParam(value, std::move(longName), shortName, std::move(help), type,
+                           std::move(converter)));
+    }
+
+    /// Registers a named parameter converted by a custom converter, e.g. one from bytes.h.
+    /// A corresponding command line argument may be passed as follows:
+    /// - --longName value
+    /// - --longName=value
+    ///
+    template<class T, class Converter, class = details::EnableIfConverter<Converter, T>>
+    void addParam(T& value, std::string longName, std::string help, Converter converter,
+                  ParamType type = ParamType::REQUIRED)
+    {
+        addParam(value, std::move(longName), '\0', std::move(help), std::move(converter), type);
+    }
+
+    /// Registers a named flag parameter.
+    /// A corresponding command line argument may be passed as follows (s is a shortName):
+    /// - --longName
+    /// - -s
+    ///
+    template<class T>
+    void addFlag(T& value, std::string longName, char shortName, std::string help)
+    {
+        static_assert(std::is_integral<T>::value, "Value must be of integral type");
+        addParam(makeParam(value, std::move(longName), shortName, std::move(help), OPTIONAL, true));
+    }
+
+    /// Registers a named flag parameter.
+    /// A corresponding command line argument may be passed as follows:
+    /// - --longName
+    ///
+    template<class T>
+    void addFlag(T& value, std::string longName, std::string help)
+    {
+        addFlag(value, std::move(longName), '\0', std::move(help));
+    }
+
+    /// Registers a positional parameter.
+    ///
+    template<class T>
+    void addPositional(T& value, std::string longName, std::string help,
+                       ParamType type = ParamType::REQUIRED)
+    {
+        addPositional(makeParam(value, std::move(longName), '\0', std::move(help), type, false));
+    }
+
+    /// Registers a positional parameter with enumerated allowed values.
+    ///
+    template<class T>
+    void addPositional(T& value, std::string longName, std::string help,
+                       typename details::TypeTraits<T>::EnumValuesType enumValues,
+                       ParamType type = ParamType::REQUIRED)
+    {
+        addPositional(makeEnumParam(value, std::move(longName), '\0', std::move(help), type, false,
+                                    std::move(enumValues)));
+    }
+
+    /// Registers a positional parameter converted by a custom converter.
+    ///
+    template<class T, class Converter, class = details::EnableIfConverter<Converter, T>>
+    void addPositional(T& value, std::string longName, std::string help, Converter converter,
+                       ParamType type = ParamType::REQUIRED)
+    {
+        addPositional(makeParam(value, std::move(longName), '\0', std::move(help), type,
+                                std::move(converter)));
+    }
+
+    /// Registers the fields of an options struct described by a table, see fields.h.
+    /// The parsed values are written into the given struct instance.
+    ///
+    template<class S, class Table>
+    void addStruct(S& object, const Table& table)
+    {
+        addGroup(table.bind(object));
+    }
+
+    /// Registers the fields of an options struct under a long name prefix, e.g. the options of
+    /// a library mounted as --storage.endpoint with the prefix "storage.". The short names of
+    /// the fields are not registered since libraries cannot share them. The names are indexed
+    /// in a single pass over the fields.
+    ///
+    template<class S, class Table>
+    void addStruct(S& object, const Table& table, const std::string& prefix)
+    {
+        addGroup(table.bind(object, prefix));
+    }
+
+    /// Registers the options of an early parse, see early.h. The full parse accepts them as
+    /// optional parameters and checks that their values are the same as in the early parse.
+    ///
+    template<class Options>
+    void addEarly(const Options& options)
+    {
+        addGroup(options.bind());
+    }
+
+    /// Registers hierarchical parameters stored in a tree, e.g. an OptionTree from tree.h.
+    /// Every --name value or --name=value argument with a dotted name matching the pattern sets
+    /// the name to the value in the tree. '*' in the pattern matches one name segment and a
+    /// trailing '**' one or more of them, e.g. "db.replicas.*.host" or "db.**". A repeated name
+    /// overrides the value. The tree is not cleared by parse(), values set before are defaults.
+    /// A parameter long name matching the pattern of another one is an error.
+    ///
+    template<class Tree>
+    void addTree(Tree& tree, std::string pattern, std::string help,
+                 ParamType type = ParamType::REQUIRED)
+    {
+        addPatternParam(std::make_unique<details::TreeParam<Tree>>(tree, std::move(pattern),
+                                                                   std::move(help), type));
+    }
+
+    /// Sets the executor running asynchronous conversions, see async.h.
+    /// By default asynchronous conversions run on std::async threads, at most as many at once
+    /// as there are hardware threads. An executor may drop queued tasks, e.g. on shutdown.
+    ///
+    void setExecutor(Executor executor) { executor_ = std::move(executor); }
+
+    /// Sets a hook called after every parse(), e.g. to record real command lines for
+    /// benchmarks, see corpus.h.
+    ///
+    void setCapture(Capture capture) { capture_ = std::move(capture); }
+
+    /// Sets a hook timing every parse(), e.g. to monitor the parse latency of a service.
+    /// The clock is not read without the hook.
+    ///
+    void setLatencyObserver(LatencyObserver observer) { latencyObserver_ = std::move(observer); }
+
+    /// Sets limits on the parsed command lines.
+    ///
+    void setLimits(const Limits& limits) { limits_ = limits; }
+
+    /// Makes parsing transactional: if parse(), parseKnown() or parseRemaining() throws, the
+    /// values written by it are rolled back to the values before the call. The value of each
+    /// parameter is saved before its first write in the call, so the cost is proportional to
+    /// the given parameters rather than to all registered ones. Trees of addTree() and values
+    /// that cannot be copied are not rolled back.
+    ///
+    void setTransactional(bool transactional) { transactional_ = transactional; }
+
+    /// Captures the current values of the registered parameters and of the parameters registered
+    /// later as their defaults. Every following parse() first restores the parameters given in
+    /// the previous one, so a parameter that is not given has its default rather than the value
+    /// from the previous parse(). Restoring costs O(given parameters) regardless of the number of
+    /// registered ones, trivially copyable values are restored with memcpy. Values that cannot be
+    /// copied and trees of addTree() keep their values.
+    ///
+    void captureDefaults()
+    {
+        capturing_ = true;
+        for (auto* param : namedParams_)
+        {
+            param->defaultSlot_ = param->save(defaults_);
+        }
+
+        for (auto* param : positionalParams_)
+        {
+            param->defaultSlot_ = param->save(defaults_);
+        }
+    }
+
+    /// Parses the command line arguments.
+    /// Asynchronous conversions are joined before returning, a bad argument is reported in the
+    /// argument order regardless of how its value was converted.
+    ///
+    /// Parsing is linear in the total length L of the arguments apart from the name lookups:
+    /// each named argument costs an expected O(1) name comparisons in a hash index of the
+    /// registered parameters, each bounded by the argument name length. Arguments are not
+    /// copied except into the stream of stream based converters. An error message is O(L + V)
+    /// for V characters of valid values. Limits::maxErrorLength bounds the quoted argument and,
+    /// for enum parameters and converters providing getValidValues(size_t maxLength), the
+    /// valid values built. Other converters build all valid values, only the message is bounded.
+    ///
+    void parse(int argc, const Char* const argv[])
+    {
+        auto startTime = startTiming();
+        try
+        {
+            transact([&] {
+                start(argc, argv);
+                parseTokens(tokens_, false);
+            });
+        }
+        catch (const std::exception& e)
+        {
+            observeLatency(argc, errorOutcome_, startTime);
+            if (capture_)
+            {
+                capture_(argc, argv, e.what());
+            }
+            throw;
+        }
+
+        observeLatency(argc, ParseOutcome::SUCCESS, startTime);
+        if (capture_)
+        {
+            capture_(argc, argv, nullptr);
+        }
+    }
+
+    /// Parses the command line arguments like parse() but rather than throwing on the first
+    /// problem goes on past it and returns all of them: unexpected, repeated and bad arguments
+    /// in the argument order followed by missing ones. The value following a repeated --name
+    /// is skipped as its value. The other arguments are parsed as usual unless the parser is
+    /// transactional, then any problem rolls all of them back. Other errors, e.g. exceeded
+    /// Limits, are thrown like by parse(). The diagnostics refer to the arguments, and parsing
+    /// stays linear in their length as no message is formatted until format() is called.
+    ///
+    std::vector<Diagnostic> parseAll(int argc, const Char* const argv[])
+    {
+        auto startTime = startTiming();
+        std::vector<Diagnostic> diagnostics;
+        diagnostics_ = &diagnostics;
+        try
+        {
+            start(argc, argv);
+            parseTokens(tokens_, false);
+        }
+        catch (const std::exception& e)
+        {
+            diagnostics_ = nullptr;
+            rollback();
+            observeLatency(argc, errorOutcome_, startTime);
+            if (capture_)
+            {
+                capture_(argc, argv, e.what());
+            }
+            throw;
+        }
+        diagnostics_ = nullptr;
+
+        // Asynchronously converted arguments are joined after the others
+        std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                         [](const Diagnostic& lhs, const Diagnostic& rhs) {
+                             return static_cast<unsigned>(lhs.arg - 1) <
+                                    static_cast<unsigned>(rhs.arg - 1);
+                         });
+
+        if (diagnostics.empty())
+        {
+            commit();
+        }
+        else
+        {
+            rollback();
+        }
+
+        auto outcome = diagnostics.empty() ? ParseOutcome::SUCCESS : toOutcome(diagnostics[0].kind);
+        observeLatency(argc, outcome, startTime);
+        if (capture_)
+        {
+            capture_(argc, argv, diagnostics.empty() ? nullptr : format(diagnostics[0]).c_str());
+        }
+        return diagnostics;
+    }
+
+    /// Returns the message of a diagnostic of parseAll(), the one parse() would throw for it.
+    ///
+    std::string format(const Diagnostic& diagnostic) const
+    {
+        return makeError(diagnostic).what();
+    }
+
+    /// Parses the command line arguments like parse() but leaves the arguments of unknown
+    /// parameters for parseRemaining(), e.g. for the parameters of plugins loaded after the core
+    /// parameters are parsed. An unknown --name or -s argument is left together with the value
+    /// following it, and so is every positional argument after the first left one so that the
+    /// positional arguments keep their order. The arguments must outlive parseRemaining().
+    ///
+    void parseKnown(int argc, const Char* const argv[])
+    {
+        transact([&] {
+            start(argc, argv);
+            parseTokens(tokens_, true);
+        });
+    }
+
+    /// Parses the arguments left by parseKnown() with the parameters registered since then.
+    /// The arguments parsed before are not parsed again, so the cost is proportional to the
+    /// left arguments and registering the new parameters is proportional to their number.
+    /// Unless it is the last call the still unknown arguments are left again for the next one.
+    ///
+    void parseRemaining(bool last = true)
+    {
+        tokens_.swap(remaining_);
+        remaining_.clear();
+        transact([&] { parseTokens(tokens_, !last); });
+    }
+
+    /// Appends the current values of all parameters to a buffer, e.g. for a startup log.
+    /// Values are formatted without streams, enums by their names from the enumerated values.
+    /// With provenance each value is marked as given on the command line or left by default.
+    ///
+    void dump(std::string& buffer, DumpFormat format = DumpFormat::TEXT,
+              bool provenance = false) const
+    {
+        bool json = format == DumpFormat::JSON;
+        buffer.reserve(buffer.size() + 32 * (namedParams_.size() + positionalParams_.size()));
+        buffer += json ? "{" : "";
+
+        const char* delimiter = "";
+        auto dumpParam = [&](const details::Param& param) {
+            buffer += delimiter;
+            delimiter = json ? "," : "";
+            const char* source = param.parsed_ ? "command line" : "default";
+            if (json)
+            {
+                details::appendString(buffer, param.longName_.data(),
+                                      param.longName_.data() + param.longName_.size(), true);
+                buffer += provenance ? ":{\"value\":" : ":";
+                param.dump(buffer, true);
+                if (provenance)
+                {
+                    buffer += ",\"source\":\"";
+                    buffer += source;
+                    buffer += "\"}";
+                }
+            }
+            else
+            {
+                buffer.append(param.longName_.data(), param.longName_.size());
+                buffer += " = ";
+                param.dump(buffer, false);
+                if (provenance)
+                {
+                    buffer += " (";
+                    buffer += source;
+                    buffer += ")";
+                }
+                buffer += "\n";
+            }
+        };
+
+        for (const auto& param : namedParams_)
+        {
+            dumpParam(*param);
+        }
+
+        for (const auto& param : positionalParams_)
+        {
+            dumpParam(*param);
+        }
+
+        buffer += json ? "}" : "";
+    }
+
+    /// Prints full help on all registered parameters.
+    ///
+    void printHelp(std::basic_ostream<Char>& stream)
+    {
+        printDescription(stream);
+        printUsage(stream);
+        printParams(stream);
+    }
+
+    /// Prints the program description.
+    ///
+    void printDescription(std::basic_ostream<Char>& stream)
+    {
+        stream << details::fromASCII(description_) << "\n\n";
+    }
+
+    /// Prints command line usage.
+    ///
+    void printUsage(std::basic_ostream<Char>& stream)
+    {
+        std::vector<std::string> usages;
+
+        for (const auto& param : namedParams_)
+        {
+            usages.push_back(details::namedUsage(param->longName_.str(), param->shortName_,
+                                                 param->optional_, param->flag_, param->isList()));
+        }
+
+        for (const auto& param : positionalParams_)
+        {
+            usages.push_back(
+                details::positionalUsage(param->longName_.str(), param->optional_,
+                                         param->isList()));
+        }
+
+        details::printUsage(stream, exeName_, usages);
+    }
+
+    /// Prints command line parameters.
+    ///
+    void printParams(std::basic_ostream<Char>& stream)
+    {
+        size_t maxHelpIndent = 0;
+
+        for (const auto& param : namedParams_)
+        {
+            size_t helpIdent = 0;
+            if (param->shortName_ != '\0')
+            {
+                helpIdent += 4; // "-s, "
+            }
+
+            helpIdent += 2 + param->longName_.size(); // "--name"
+
+            if (!param->flag_)
+            {
+                helpIdent += 3 + param->longName_.size(); // " <name>"
+            }
+
+            maxHelpIndent = std::max(maxHelpIndent, helpIdent);
+        }
+
+        for (const auto& param : positionalParams_)
+        {
+            size_t helpIdent = 2 + param->longName_.size(); // "<name>"
+            maxHelpIndent = std::max(maxHelpIndent, helpIdent);
+        }
+
+        size_t INDENT = 4;
+        maxHelpIndent += INDENT + 1;
+
+        std::ostringstream output;
+        std::ostringstream paramOutput;
+
+        output << "Options:\n";
+
+        auto outputHelp = [&](details::Param& param) {
+            auto paramString = paramOutput.str();
+            paramOutput.str({});
+
+            output << paramString << std::setfill(' ')
+                   << std::setw(maxHelpIndent - paramString.size()) << "" << param.help_;
+
+            auto validValues = param.getValidValues();
+            if (!validValues.empty())
+            {
+                output << ". Valid values: " << validValues;
+            }
 
-private:
-    Converter converter_;
-    T* value_ = nullptr;
-};
+            output << "\n";
+        };
 
-template<class T, class Converter>
-class ParamImpl<std::vector<T>, Converter> : public Param
-{
-public:
-    ParamImpl(std::vector<T>& value, std::string longName, char shortName, std::string help,
-              ParamType type, bool flag, Converter converter)
-        : Param(std::move(longName), shortName, std::move(help), type, flag)
-        , converter_(std::move(converter))
-        , value_(&value)
-    {
-    }
+        for (const auto& param : namedParams_)
+        {
+            paramOutput << std::setfill(' ') << std::setw(INDENT) << "";
+            if (param->shortName_ != '\0')
+            {
+                paramOutput << "-" << param->shortName_ << ", ";
+            }
+            paramOutput << "--" << param->longName_;
+            if (!param->flag_)
+            {
+                paramOutput << " <" << param->longName_ << ">";
+            }
 
-    bool isList() const override { return true; }
+            outputHelp(*param);
+        }
 
-    void parse(std::basic_istream<Char>& stream) override
-    {
-        // Handle repeated Parser::parse() calls
-        if (!parsed_)
+        for (const auto& param : positionalParams_)
         {
-            value_->clear();
+            paramOutput << std::setfill(' ') << std::setw(INDENT) << ""
+                        << "<" << param->longName_ << ">";
+
+            outputHelp(*param);
         }
 
-        T value;
-        converter_(stream, value);
-        value_->push_back(value);
-        parsed_ = true;
+        stream << details::fromASCII(output.str());
     }
 
-    std::string getValidValues() const override { return converter_.getValidValues(); }
-
 private:
-    Converter converter_;
-    std::vector<T>* value_ = nullptr;
-};
-
-} // namespace details
-
-/// Command line arguments parser.
-///
-class Parser
-{
-public:
-    explicit Parser(std::string description) : description_(std::move(description)) {}
-
-    /// Registers a named parameter.
-    /// A corresponding command line argument may be passed as follows (s is a shortName):
-    /// - --longName value
-    /// - --longName=value
-    /// - -s value
-    ///
-    template<class T>
-    void addParam(T& value, std::string longName, char shortName, std::string help,
-                  ParamType type = ParamType::REQUIRED)
-    {
-        addParam(makeParam(value, std::move(longName), shortName, std::move(help), type, false));
-    }
+    friend class over9000::cmd_line_args::details::Param;
 
-    /// Registers a named parameter.
-    /// A corresponding command line argument may be passed as follows:
-    /// - --longName value
-    /// - --longName=value
-    ///
     template<class T>
-    void addParam(T& value, std::string longName, std::string help,
-                  ParamType type = ParamType::REQUIRED)
+    static std::unique_ptr<details::Param> makeParam(T& value, std::string longName, char shortName,
+                                                     std::string help, ParamType type, bool flag)
     {
-        addParam(value, std::move(longName), '\0', std::move(help), type);
+        using ValueType = typename details::TypeTraits<T>::ValueType;
+        static_assert(!std::is_enum<ValueType>(), "Missing enum values");
+        return std::make_unique<details::ParamImpl<T, details::Converter<ValueType>>>(
+            value, std::move(longName), shortName, std::move(help), type, flag,
+            details::Converter<ValueType>());
     }
 
-    /// Registers a named parameter with enumerated allowed values.
-    /// A corresponding command line argument may be passed as follows (s is a shortName):
-    /// - --longName value
-    /// - --longName=value
-    /// - -s value
-    ///
     template<class T>
-    void addParam(T& value, std::string longName, char shortName, std::string help,
-                  typename details::TypeTraits<T>::EnumValuesType enumValues,
-                  ParamType type = ParamType::REQUIRED)
+    static std::unique_ptr<details::Param> makeEnumParam(
+        T& value, std::string longName, char shortName, std::string help, ParamType type, bool flag,
+        typename details::TypeTraits<T>::EnumValuesType enumValues)
     {
-        addParam(makeEnumParam(value, std::move(longName), shortName, std::move(help), type, false,
-                               std::move(enumValues)));
+        using ValueType = typename details::TypeTraits<T>::ValueType;
+        return std::make_unique<details::ParamImpl<T, details::EnumConverter<ValueType>>>(
+            value, std::move(longName), shortName, std::move(help), type, false,
+            details::EnumConverter<ValueType>{std::move(enumValues)});
     }
 
-    /// Registers a named parameter with enumerated allowed values.
-    /// A corresponding command line argument may be passed as follows:
-    /// - --longName value
-    /// - --longName=value
-    ///
-    template<class T>
-    void addParam(T& value, std::string longName, std::string help,
-                  typename details::TypeTraits<T>::EnumValuesType enumValues,
-                  ParamType type = ParamType::REQUIRED)
+    template<class T, class Converter>
+    static std::unique_ptr<details::Param> makeParam(T& value, std::string longName, char shortName,
+                                                     std::string help, ParamType type,
+                                                     Converter converter)
     {
-        addParam(value, std::move(longName), '\0', std::move(help), std::move(enumValues), type);
+        constexpr bool list = !details::CanConvert<Converter, T>::value;
+        return std::make_unique<details::ParamImpl<T, Converter, list>>(
+            value, std::move(longName), shortName, std::move(help), type, false,
+            std::move(converter));
     }
 
-    /// Registers a named flag parameter.
-    /// A corresponding command line argument may be passed as follows (s is a shortName):
-    /// - --longName
-    /// - -s
-    ///
-    template<class T>
-    void addFlag(T& value, std::string longName, char shortName, std::string help)
+    void addGroup(std::unique_ptr<details::ParamGroup> paramGroup)
     {
-        static_assert(std::is_integral<T>::value, "Value must be of integral type");
-        addParam(makeParam(value, std::move(longName), shortName, std::move(help), OPTIONAL, true));
-    }
+        groups_.push_back(std::move(paramGroup));
+        auto& group = *groups_.back();
 
-    /// Registers a named flag parameter.
-    /// A corresponding command line argument may be passed as follows:
-    /// - --longName
-    ///
-    template<class T>
-    void addFlag(T& value, std::string longName, std::string help)
-    {
-        addFlag(value, std::move(longName), '\0', std::move(help));
+        // A single pass over the parameters without growing the index
+        paramsByLongName_.reserve(namedParams_.size() + group.size());
+        namedParams_.reserve(namedParams_.size() + group.size());
+        for (size_t i = 0; i < group.size(); ++i)
+        {
+            if (group.isPositional(i))
+            {
+                registerPositional(group.param(i));
+            }
+            else
+            {
+                registerParam(group.param(i));
+            }
+        }
     }
 
-    /// Registers a positional parameter.
-    ///
-    template<class T>
-    void addPositional(T& value, std::string longName, std::string help,
-                       ParamType type = ParamType::REQUIRED)
+    void addParam(std::unique_ptr<details::Param> param)
     {
-        addPositional(makeParam(value, std::move(longName), '\0', std::move(help), type, false));
+        registerParam(*param);
+        params_.push_back(std::move(param));
     }
 
-    /// Registers a positional parameter with enumerated allowed values.
-    ///
-    template<class T>
-    void addPositional(T& value, std::string longName, std::string help,
-                       typename details::TypeTraits<T>::EnumValuesType enumValues,
-                       ParamType type = ParamType::REQUIRED)
+    void registerParam(details::Param& param)
     {
-        addPositional(makeEnumParam(value, std::move(longName), '\0', std::move(help), type, false,
-                                    std::move(enumValues)));
-    }
+        if (param.longName_.size() < 2)
+        {
+            throw Error() << "Too short long name parameter: " << param;
+        }
 
-    /// Parses the command line arguments.
-    ///
-    void parse(int argc, const Char* const argv[])
-    {
-        // Calculate the executable base name
+        details::NameRef name{param.longName_.data(), param.longName_.size()};
+        if (paramsByLongName_.find(name) != nullptr)
+        {
+            throw Error() << "Repeated parameter long name: " << param;
+        }
 
-        exeName_ = argv[0];
+        if (param.shortName_ != '\0')
+        {
+            auto& shortNameParam = paramsByShortName_[static_cast<size_t>(param.shortName_)];
+            if (shortNameParam != nullptr)
+            {
+                throw Error() << "Repeated parameter short name: " << param;
+            }
 
-#ifdef _WIN32
-        auto slashPos = exeName_.find_last_of(L"\\/");
-#else
-        auto slashPos = exeName_.find_last_of("/");
-#endif //_WIN32
+            shortNameParam = &param;
+        }
 
-        if (slashPos != std::basic_string<Char>::npos)
+        for (auto* patternParam : patternParams_)
         {
-            exeName_.erase(0, slashPos + 1);
+            checkPatternCollision(*patternParam, param);
         }
 
-        // Reset paremeter states
+        paramsByLongName_.insert(name, &param);
+        namedParams_.push_back(&param);
 
-        for (const auto& param : namedParams_)
+        if (capturing_)
         {
-            param->parsed_ = false;
+            param.defaultSlot_ = param.save(defaults_);
         }
+    }
 
-        for (const auto& param : positionalParams_)
+    void addPatternParam(std::unique_ptr<details::PatternParam> param)
+    {
+        for (auto* patternParam : patternParams_)
         {
-            param->parsed_ = false;
+            if (patternParam->longName_ == param->longName_)
+            {
+                throw Error() << "Repeated parameter long name: " << *param;
+            }
         }
 
-        std::basic_stringstream<Char> stream;
-        size_t currentPositionalPos = 0;
-        details::Param* currentNamedParam = nullptr;
-        for (auto* argIter = argv + 1; argIter != argv + argc; ++argIter)
+        for (auto* namedParam : namedParams_)
         {
-            if (argIter == nullptr)
+            details::NameRef name{namedParam->longName_.data(), namedParam->longName_.size()};
+            if (paramsByLongName_.find(name) == namedParam)
             {
-                throw Error() << "Bad argument #" << (argIter - argv + 1);
+                checkPatternCollision(*param, *namedParam);
             }
+        }
 
-            std::basic_string<Char> arg(*argIter);
+        patternParams_.push_back(param.get());
+        namedParams_.push_back(param.get());
+        params_.push_back(std::move(param));
+    }
 
-            if (currentNamedParam != nullptr)
-            {
-                parseArg(*currentNamedParam, arg, stream);
-                currentNamedParam = nullptr;
-                continue;
-            }
+    // Rejects a long name matching a pattern since it would shadow the pattern
+    static void checkPatternCollision(details::PatternParam& pattern, const details::Param& param)
+    {
+        auto name = details::fromASCII(param.longName_.str());
+        if (pattern.match(name.data(), name.data() + name.size()))
+        {
+            throw Error() << "Parameter long name matching a name pattern: " << param << ", "
+                          << pattern;
+        }
+    }
 
-            if (arg.size() == 2 && arg[0] == '-')
-            {
-                // -s[ value]
-                auto iter = paramsByShortName_.find(static_cast<char>(arg[1]));
-                if (iter != paramsByShortName_.end())
-                {
-                    if (!iter->second->parsed_ || iter->second->isList())
-                    {
-                        if (iter->second->flag_)
-                        {
-#ifdef _WIN32
-                            parseArg(*iter->second, L"1", stream);
-#else
-                            parseArg(*iter->second, "1", stream);
-#endif
-                            continue;
-                        }
+    void addPositional(std::unique_ptr<details::Param> param)
+    {
+        registerPositional(*param);
+        params_.push_back(std::move(param));
+    }
 
-                        currentNamedParam = iter->second;
-                        continue;
-                    }
-                }
-            }
+    void registerPositional(details::Param& param)
+    {
+        param.index_ = positionalParams_.size(); // 1-based index
 
-            if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-')
-            {
-                // --long-opt[=value| value|]
-                size_t equalPos = arg.find('=');
-                if (equalPos == std::string::npos)
-                {
-                    // --long-opt[ value]
-                    auto argName = details::toASCII(arg, "argument name");
-                    argName.erase(0, 2);
-                    auto iter = paramsByLongName_.find(argName);
-                    if (iter != paramsByLongName_.end())
-                    {
-                        if (!iter->second->parsed_ || iter->second->isList())
-                        {
-                            if (iter->second->flag_)
-                            {
-#ifdef _WIN32
-                                parseArg(*iter->second, L"1", stream);
-#else
-                                parseArg(*iter->second, "1", stream);
-#endif
-                                continue;
-                            }
+        if (!positionalParams_.empty() && positionalParams_.back()->optional_)
+        {
+            throw Error() << "Optional positional parameter " << *positionalParams_.back()
+                          << " followed by another positional parameter " << param;
+        }
 
-                            currentNamedParam = iter->second;
-                            continue;
-                        }
-                    }
-                }
-                else
-                {
-                    // --long-opt=value
-                    auto argName = details::toASCII(arg, "argument name");
-                    argName.erase(equalPos);
-                    argName.erase(0, 2);
-                    auto iter = paramsByLongName_.find(argName);
-                    if (iter != paramsByLongName_.end())
-                    {
-                        if (!iter->second->parsed_ || iter->second->isList())
-                        {
-                            arg.erase(0, equalPos + 1);
-                            parseArg(*iter->second, arg, stream);
-                            continue;
-                        }
-                    }
-                }
-            }
+        if (!positionalParams_.empty() && positionalParams_.back()->isList())
+        {
+            throw Error() << "Positional list parameter " << *positionalParams_.back()
+                          << " followed by another positional parameter " << param;
+        }
 
-            if (currentPositionalPos >= positionalParams_.size())
-            {
-                throw Error() << "Unexpected argument: " << arg;
-            }
+        positionalParams_.push_back(&param);
 
-            parseArg(*positionalParams_[currentPositionalPos], arg, stream);
-            if (!positionalParams_[currentPositionalPos]->isList())
-            {
-                ++currentPositionalPos;
-            }
+        if (capturing_)
+        {
+            param.defaultSlot_ = param.save(defaults_);
         }
+    }
 
-        for (const auto& param : namedParams_)
+    void start(int argc, const Char* const argv[])
+    {
+        errorOutcome_ = ParseOutcome::OTHER_ERROR;
+
+        // Calculate the executable base name
+
+        exeName_ = argv[0];
+
+#ifdef _WIN32
+        auto slashPos = exeName_.find_last_of(L"\\/");
+#else
+        auto slashPos = exeName_.find_last_of("/");
+#endif //_WIN32
+
+        if (slashPos != std::basic_string<Char>::npos)
         {
-            if (!param->parsed_ && !param->optional_)
-            {
-                throw Error() << "Missing argument: " << *param;
-            }
+            exeName_.erase(0, slashPos + 1);
         }
 
-        for (const auto& param : positionalParams_)
+        // Reset the states of the parameters given in the previous parse
+
+        for (auto* param : touched_)
         {
-            if (!param->parsed_ && !param->optional_)
+            saveUndo(*param);
+            if (capturing_)
             {
-                throw Error() << "Missing positional argument " << *param;
+                param->restore(defaults_, param->defaultSlot_);
             }
+            param->parsed_ = false;
         }
+        touched_.clear();
+
+        positionalPos_ = 0;
+        remaining_.clear();
+        details::classify(argc, argv, limits_, tokens_);
     }
 
-    /// Prints full help on all registered parameters.
-    ///
-    void printHelp(std::basic_ostream<Char>& stream)
+    std::chrono::steady_clock::time_point startTiming() const
     {
-        printDescription(stream);
-        printUsage(stream);
-        printParams(stream);
+        return latencyObserver_ ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point();
     }
 
-    /// Prints the program description.
-    ///
-    void printDescription(std::basic_ostream<Char>& stream)
+    void observeLatency(int argc, ParseOutcome outcome,
+                        std::chrono::steady_clock::time_point startTime) const
     {
-        stream << details::fromASCII(description_) << "\n\n";
+        if (latencyObserver_)
+        {
+            latencyObserver_(argc, outcome, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                std::chrono::steady_clock::now() - startTime));
+        }
     }
 
-    /// Prints command line usage.
-    ///
-    void printUsage(std::basic_ostream<Char>& stream)
+    static ParseOutcome toOutcome(DiagnosticKind kind)
     {
-        const size_t MAX_WIDTH = 80;
-        std::ostringstream output;
-        std::ostringstream paramOutput;
-
-        stream << "Usage: " << exeName_;
-
-        size_t usageIndent = 7 + exeName_.size(); // "Usage: exeName"
+        switch (kind)
+        {
+        case DiagnosticKind::UNEXPECTED_ARGUMENT:
+            return ParseOutcome::UNEXPECTED_ARGUMENT;
+        case DiagnosticKind::REPEATED_ARGUMENT:
+            return ParseOutcome::REPEATED_ARGUMENT;
+        case DiagnosticKind::BAD_ARGUMENT:
+            return ParseOutcome::BAD_ARGUMENT;
+        case DiagnosticKind::MISSING_ARGUMENT:
+            return ParseOutcome::MISSING_ARGUMENT;
+        }
+        return ParseOutcome::OTHER_ERROR;
+    }
 
-        size_t width = usageIndent;
+    // Runs a parse rolling back its writes if it throws when transactional
+    template<class Parse>
+    void transact(Parse parse)
+    {
+        try
+        {
+            parse();
+        }
+        catch (...)
+        {
+            rollback();
+            throw;
+        }
+        commit();
+    }
 
-        auto identUsage = [&] {
-            output << std::setfill(' ') << std::setw(usageIndent) << "";
-            width = usageIndent;
-        };
+    // Saves the value of a parameter before its first write in the current parse
+    void saveUndo(details::Param& param)
+    {
+        if (transactional_ && param.undoSlot_ == details::ValueSnapshot::NONE)
+        {
+            param.undoSlot_ = param.save(undo_);
+            undoParams_.push_back({&param, param.parsed_});
+        }
+    }
 
-        auto outputUsage = [&] {
-            auto paramString = paramOutput.str();
+    void commit()
+    {
+        for (const auto& entry : undoParams_)
+        {
+            entry.param->undoSlot_ = details::ValueSnapshot::NONE;
+        }
+        undoParams_.clear();
+        undo_.clear();
+    }
 
-            if (!paramString.empty())
+    void rollback()
+    {
+        for (auto iter = undoParams_.rbegin(); iter != undoParams_.rend(); ++iter)
+        {
+            auto& param = *iter->param;
+            param.restore(undo_, param.undoSlot_);
+            param.parsed_ = iter->parsed;
+            if (param.parsed_)
             {
-                paramOutput.str({});
-                if (width + paramString.size() > MAX_WIDTH)
-                {
-                    output << "\n";
-                    identUsage();
-                }
-                output << paramString;
-                width += paramString.size();
+                touched_.push_back(&param);
             }
-        };
+        }
+        commit();
+    }
 
-        for (const auto& param : namedParams_)
+    void parseTokens(const std::vector<details::Token>& tokens, bool leaveUnknown)
+    {
+        std::basic_stringstream<Char> stream;
+        pending_.clear();
+        try
+        {
+            parseArgs(tokens, leaveUnknown, stream);
+        }
+        catch (...)
         {
-            paramOutput << " ";
+            // An asynchronously converted argument preceding the failed one is reported first
+            joinPending();
+            finishParams();
+            throw;
+        }
+        joinPending();
+        finishParams();
 
-            if (param->optional_)
-            {
-                paramOutput << "[";
-            }
-            else if (param->shortName_ != '\0')
+        for (const auto& param : namedParams_)
+        {
+            if (!param->parsed_ && !param->optional_)
             {
-                paramOutput << "(";
+                report(DiagnosticKind::MISSING_ARGUMENT, 0, param, nullptr, nullptr);
             }
+        }
 
-            if (param->shortName_ != '\0')
+        // The left arguments may still contain positional ones
+        if (!remaining_.empty())
+        {
+            return;
+        }
+
+        for (const auto& param : positionalParams_)
+        {
+            if (!param->parsed_ && !param->optional_)
             {
-                paramOutput << "-" << param->shortName_ << " <" << param->longName_ << "> | ";
+                report(DiagnosticKind::MISSING_ARGUMENT, 0, param, nullptr, nullptr, true);
             }
+        }
+    }
 
-            paramOutput << "--" << param->longName_;
+    void parseArgs(const std::vector<details::Token>& tokens, bool leaveUnknown,
+                   std::basic_stringstream<Char>& stream)
+    {
+        static const Char flagValue[] = {'1'};
 
-            if (!param->flag_)
-            {
-                paramOutput << " <" << param->longName_ << ">";
-            }
+        details::Param* currentNamedParam = nullptr;
+        bool skipValue = false; // of a repeated argument collected by parseAll()
+        for (const auto& token : tokens)
+        {
+            const Char* arg = token.arg;
+            const Char* argEnd = token.arg + token.size;
 
-            if (param->isList())
+            if (currentNamedParam != nullptr)
             {
-                paramOutput << " ...";
+                parseArg(*currentNamedParam, arg, argEnd, token.index, stream);
+                currentNamedParam = nullptr;
+                continue;
             }
 
-            if (param->optional_)
+            if (skipValue)
             {
-                paramOutput << "]";
+                skipValue = false;
+                continue;
             }
-            else if (param->shortName_ != '\0')
+
+            details::Param* param = nullptr;
+            switch (token.kind)
             {
-                paramOutput << ")";
-            }
+            case details::TokenKind::SHORT: // -s[ value]
+                param = findShortName(arg[1]);
+                break;
 
-            outputUsage();
-        }
+            case details::TokenKind::LONG: // --long-opt[ value]
+                param = findLongName(arg + 2, argEnd);
+                if (param == nullptr && !patternParams_.empty())
+                {
+                    param = findPatternParam(arg + 2, argEnd);
+                }
+                break;
 
-        for (const auto& param : positionalParams_)
-        {
-            paramOutput << " ";
+            case details::TokenKind::LONG_WITH_VALUE: // --long-opt=value
+                param = findLongName(arg + 2, arg + token.equalPos);
+                if (param == nullptr && !patternParams_.empty())
+                {
+                    param = findPatternParam(arg + 2, arg + token.equalPos);
+                }
+                break;
 
-            if (param->optional_)
-            {
-                paramOutput << "[";
+            case details::TokenKind::VALUE:
+                break;
             }
 
-            paramOutput << "<" << param->longName_ << ">";
+            if (param != nullptr && (!param->parsed_ || param->isList()))
+            {
+                if (token.kind == details::TokenKind::LONG_WITH_VALUE)
+                {
+                    parseArg(*param, arg + token.equalPos + 1, argEnd, token.index, stream);
+                }
+                else if (param->flag_)
+                {
+                    parseArg(*param, flagValue, flagValue + 1, token.index, stream);
+                }
+                else
+                {
+                    currentNamedParam = param;
+                }
+                continue;
+            }
 
-            if (param->isList())
+            // Once an argument is left the following values are left too, including the value
+            // of the left argument
+            if (leaveUnknown &&
+                ((param == nullptr && token.kind != details::TokenKind::VALUE) ||
+                 !remaining_.empty() || positionalPos_ >= positionalParams_.size()))
             {
-                paramOutput << " ...";
+                remaining_.push_back(token);
+                continue;
             }
 
-            if (param->optional_)
+            if (positionalPos_ >= positionalParams_.size())
             {
-                paramOutput << "]";
+                if (param != nullptr)
+                {
+                    report(DiagnosticKind::REPEATED_ARGUMENT, token.index, param, arg, argEnd);
+                    skipValue = token.kind != details::TokenKind::LONG_WITH_VALUE &&
+                                !param->flag_;
+                }
+                else
+                {
+                    report(DiagnosticKind::UNEXPECTED_ARGUMENT, token.index, nullptr, arg,
+                           argEnd);
+                }
+                continue;
             }
 
-            outputUsage();
+            parseArg(*positionalParams_[positionalPos_], arg, argEnd, token.index, stream);
+            if (!positionalParams_[positionalPos_]->isList())
+            {
+                ++positionalPos_;
+            }
         }
-
-        outputUsage();
-
-        stream << details::fromASCII(output.str()) << "\n";
     }
 
-    /// Prints command line parameters.
-    ///
-    void printParams(std::basic_ostream<Char>& stream)
+    details::Param* findShortName(Char name) const
     {
-        size_t maxHelpIndent = 0;
+        auto index = static_cast<typename std::make_unsigned<Char>::type>(name);
+        return index < paramsByShortName_.size() ? paramsByShortName_[index] : nullptr;
+    }
 
-        for (const auto& param : namedParams_)
+    details::Param* findLongName(const Char* begin, const Char* end)
+    {
+#ifdef _WIN32
+        nameBuffer_.clear();
+        for (auto* c = begin; c != end; ++c)
         {
-            size_t helpIdent = 0;
-            if (param->shortName_ != '\0')
+            if (*c > 127)
             {
-                helpIdent += 4; // "-s, "
+                return nullptr;
             }
+            nameBuffer_ += static_cast<char>(*c);
+        }
+        details::NameRef name{nameBuffer_.data(), nameBuffer_.size()};
+#else
+        details::NameRef name{begin, static_cast<size_t>(end - begin)};
+#endif // _WIN32
 
-            helpIdent += 2 + param->longName_.size(); // "--name"
+        return paramsByLongName_.find(name);
+    }
 
-            if (!param->flag_)
+    details::Param* findPatternParam(const Char* begin, const Char* end)
+    {
+        for (auto* param : patternParams_)
+        {
+            if (param->match(begin, end))
             {
-                helpIdent += 3 + param->longName_.size(); // " <name>"
+                return param;
             }
-
-            maxHelpIndent = std::max(maxHelpIndent, helpIdent);
         }
+        return nullptr;
+    }
 
-        for (const auto& param : positionalParams_)
+    void parseArg(details::Param& param, const Char* begin, const Char* end, uint32_t index,
+                  std::basic_stringstream<Char>& stream)
+    {
+        if (!param.parsed_)
         {
-            size_t helpIdent = 2 + param->longName_.size(); // "<name>"
-            maxHelpIndent = std::max(maxHelpIndent, helpIdent);
+            touched_.push_back(&param);
         }
+        saveUndo(param);
 
-        size_t INDENT = 4;
-        maxHelpIndent += INDENT + 1;
-
-        std::ostringstream output;
-        std::ostringstream paramOutput;
-
-        output << "Options:\n";
-
-        auto outputHelp = [&](details::Param& param) {
-            auto paramString = paramOutput.str();
-            paramOutput.str({});
-
-            output << paramString << std::setfill(' ')
-                   << std::setw(maxHelpIndent - paramString.size()) << "" << param.help_;
-
-            auto validValues = param.getValidValues();
-            if (!validValues.empty())
-            {
-                output << ". Valid values: " << validValues;
-            }
-
-            output << "\n";
-        };
-
-        for (const auto& param : namedParams_)
+        if (param.isAsync())
         {
-            paramOutput << std::setfill(' ') << std::setw(INDENT) << "";
-            if (param->shortName_ != '\0')
-            {
-                paramOutput << "-" << param->shortName_ << ", ";
-            }
-            paramOutput << "--" << param->longName_;
-            if (!param->flag_)
-            {
-                paramOutput << " <" << param->longName_ << ">";
-            }
-
-            outputHelp(*param);
+            auto pending = param.parseAsync(begin, end, executor_);
+            pending_.push_back({&param, begin, end, index, std::move(pending)});
+            return;
         }
 
-        for (const auto& param : positionalParams_)
+        if (!param.parse(begin, end, stream))
         {
-            paramOutput << std::setfill(' ') << std::setw(INDENT) << ""
-                        << "<" << param->longName_ << ">";
-
-            outputHelp(*param);
+            report(DiagnosticKind::BAD_ARGUMENT, index, &param, begin, end);
         }
-
-        stream << details::fromASCII(output.str());
     }
 
-private:
-    friend class over9000::cmd_line_args::details::Param;
-
-    template<class T>
-    static std::unique_ptr<details::Param> makeParam(T& value, std::string longName, char shortName,
-                                                     std::string help, ParamType type, bool flag)
+    void finishParams()
     {
-        using ValueType = typename details::TypeTraits<T>::ValueType;
-        static_assert(!std::is_enum<ValueType>(), "Missing enum values");
-        return std::make_unique<details::ParamImpl<T, details::Converter<ValueType>>>(
-            value, std::move(longName), shortName, std::move(help), type, flag,
-            details::Converter<ValueType>());
+        for (auto* param : touched_)
+        {
+            param->finish();
+        }
     }
 
-    template<class T>
-    static std::unique_ptr<details::Param> makeEnumParam(
-        T& value, std::string longName, char shortName, std::string help, ParamType type, bool flag,
-        typename details::TypeTraits<T>::EnumValuesType enumValues)
+    // Joins asynchronous conversions in the argument order, reports every bad argument
+    void joinPending()
     {
-        using ValueType = typename details::TypeTraits<T>::ValueType;
-        return std::make_unique<details::ParamImpl<T, details::EnumConverter<ValueType>>>(
-            value, std::move(longName), shortName, std::move(help), type, false,
-            details::EnumConverter<ValueType>{std::move(enumValues)});
+        auto pending = std::move(pending_);
+        pending_.clear();
+
+        for (auto& arg : pending)
+        {
+            if (!arg.pending->join())
+            {
+                report(DiagnosticKind::BAD_ARGUMENT, arg.index, arg.param, arg.begin, arg.end);
+            }
+        }
     }
 
-    void addParam(std::unique_ptr<details::Param> param)
+    // Collects a problem for parseAll() or throws it
+    void report(DiagnosticKind kind, uint32_t index, const details::Param* param,
+                const Char* begin, const Char* end, bool positional = false)
     {
-        if (param->longName_.size() < 2)
+        Diagnostic diagnostic;
+        diagnostic.kind = kind;
+        diagnostic.arg = static_cast<int>(index);
+        diagnostic.name = param != nullptr ? param->longName_.c_str() : nullptr;
+        diagnostic.value = begin;
+        diagnostic.size = static_cast<size_t>(end - begin);
+        diagnostic.param_ = param;
+        diagnostic.positional_ = positional;
+        diagnostic.full_ = kind == DiagnosticKind::BAD_ARGUMENT && param->isListFull();
+
+        if (diagnostics_ == nullptr)
         {
-            throw Error() << "Too short long name parameter: " << *param;
+            errorOutcome_ = toOutcome(kind);
+            throw makeError(diagnostic);
         }
+        diagnostics_->push_back(diagnostic);
+    }
 
+    Error makeError(const Diagnostic& diagnostic) const
+    {
+        const Char* begin = diagnostic.value;
+        const Char* end = begin + diagnostic.size;
+        if (diagnostic.kind == DiagnosticKind::UNEXPECTED_ARGUMENT)
         {
-            auto iter = paramsByLongName_.find(param->longName_);
-            if (iter != paramsByLongName_.end())
-            {
-                throw Error() << "Repeated parameter long name: " << *param;
-            }
+            return Error() << "Unexpected argument: "
+                           << details::truncate(begin, end, limits_.maxErrorLength);
         }
 
-        if (param->shortName_ != '\0')
+        const auto& param = *diagnostic.param_;
+        switch (diagnostic.kind)
         {
-            auto iter = paramsByShortName_.find(param->shortName_);
-            if (iter != paramsByShortName_.end())
+        case DiagnosticKind::REPEATED_ARGUMENT:
+            return Error() << "Repeated argument: " << param;
+
+        case DiagnosticKind::MISSING_ARGUMENT:
+            if (diagnostic.positional_)
             {
-                throw Error() << "Repeated parameter short name: " << *param;
+                return Error() << "Missing positional argument " << param;
             }
+            return Error() << "Missing argument: " << param;
 
-            paramsByShortName_.emplace(param->shortName_, param.get());
+        default:
+            break;
         }
 
-        paramsByLongName_.emplace(param->longName_, param.get());
-        namedParams_.push_back(std::move(param));
-    }
-
-    void addPositional(std::unique_ptr<details::Param> param)
-    {
-        param->index_ = positionalParams_.size(); // 1-based index
-
-        if (!positionalParams_.empty() && positionalParams_.back()->optional_)
+        auto arg = details::truncate(begin, end, limits_.maxErrorLength);
+        auto validValues = param.getTruncatedValidValues(limits_.maxErrorLength);
+        if (!validValues.empty())
         {
-            throw Error() << "Optional positional parameter " << *positionalParams_.back()
-                          << " followed by another positional parameter " << *param;
+            validValues.insert(0, ". Valid values: ");
         }
 
-        if (!positionalParams_.empty() && positionalParams_.back()->isList())
+        auto error = diagnostic.full_ ? std::string("too many values")
+                                      : param.describeError(begin, end);
+        if (!error.empty())
         {
-            throw Error() << "Positional list parameter " << *positionalParams_.back()
-                          << " followed by another positional parameter " << *param;
+            validValues.insert(0, " (" + error + ")");
         }
 
-        positionalParams_.push_back(std::move(param));
-    }
-
-    void parseArg(details::Param& param, const std::basic_string<Char>& arg,
-                  std::basic_stringstream<Char>& stream)
-    {
-        stream.str(arg);
-        stream.clear();
-        param.parse(stream);
-        if (stream.fail() || !stream.eof())
+        if (param.index_ != 0)
         {
-            auto validValues = param.getValidValues();
-            if (!validValues.empty())
-            {
-                validValues.insert(0, ". Valid values: ");
-            }
-
-            if (param.index_ != 0)
-            {
-                throw Error() << "Bad positional argument " << param << ": " << arg << validValues;
-            }
-
-            throw Error() << "Bad argument " << param << ": " << arg << validValues;
+            return Error() << "Bad positional argument " << param << ": " << arg << validValues;
         }
+
+        return Error() << "Bad argument " << param << ": " << arg << validValues;
     }
 
     std::string description_;
-    std::map<char, details::Param*> paramsByShortName_;
-    std::map<std::string, details::Param*> paramsByLongName_;
-    std::vector<std::unique_ptr<details::Param>> namedParams_;
-    std::vector<std::unique_ptr<details::Param>> positionalParams_;
+    std::array<details::Param*, 128> paramsByShortName_{};
+    details::NameIndex paramsByLongName_;
+    std::vector<std::unique_ptr<details::Param>> params_;
+    std::vector<std::unique_ptr<details::ParamGroup>> groups_;
+    std::vector<details::Param*> namedParams_;
+    std::vector<details::Param*> positionalParams_;
+    std::vector<details::PatternParam*> patternParams_;
     std::basic_string<Char> exeName_;
+    Executor executor_;
+    Capture capture_;
+    LatencyObserver latencyObserver_;
+    ParseOutcome errorOutcome_ = ParseOutcome::OTHER_ERROR; // of the throwing parse
+    Limits limits_;
+    std::vector<details::Token> tokens_;
+    std::vector<details::Token> remaining_;
+    size_t positionalPos_ = 0;
+    std::vector<details::Param*> touched_; // Params given since start()
+    details::ValueSnapshot defaults_;
+    bool capturing_ = false;
+
+    struct UndoParam
+    {
+        details::Param* param;
+        bool parsed;
+    };
+    details::ValueSnapshot undo_;
+    std::vector<UndoParam> undoParams_;
+    bool transactional_ = false;
+#ifdef _WIN32
+    std::string nameBuffer_;
+#endif // _WIN32
+
+    struct PendingArg
+    {
+        details::Param* param;
+        const Char* begin;
+        const Char* end;
+        uint32_t index;
+        std::unique_ptr<details::Pending> pending;
+    };
+    std::vector<PendingArg> pending_;
+    std::vector<Diagnostic>* diagnostics_ = nullptr; // Collected by parseAll()
 };
 
 } // namespace cmd_line_args
@@ -0,0 +1,675 @@
+// Command line argument parser: pattern validated strings
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// The pattern alphabet: the 256 byte values and one symbol for all wide characters above them
+constexpr size_t PATTERN_SYMBOLS = 257;
+
+using SymbolSet = std::bitset<PATTERN_SYMBOLS>;
+
+inline size_t patternSymbol(Char c)
+{
+    auto u = static_cast<typename std::make_unsigned<Char>::type>(c);
+    return std::min<size_t>(u, 256);
+}
+
+// Thompson NFA of a pattern built by recursive descent. A repeated atom is compiled again for
+// each of its copies.
+class PatternNfa
+{
+public:
+    struct State
+    {
+        int set;        // symbol set of the transition to next, -1 for epsilon transitions
+        int next;
+        int epsilon[2]; // -1 if not used
+    };
+
+    explicit PatternNfa(const std::string& pattern) : pattern_(pattern)
+    {
+        Fragment fragment = parseAlternation();
+        if (pos_ != pattern_.size())
+        {
+            fail();
+        }
+        start_ = fragment.start;
+        accept_ = fragment.end;
+    }
+
+    const std::vector<State>& states() const { return states_; }
+    const std::vector<SymbolSet>& sets() const { return sets_; }
+    int start() const { return start_; }
+    int accept() const { return accept_; }
+
+private:
+    static constexpr size_t MAX_STATES = 10000;
+    static constexpr size_t MAX_REPEAT = 1000;
+
+    // States from start to end, the end state has no transitions yet
+    struct Fragment
+    {
+        int start;
+        int end;
+    };
+
+    [[noreturn]] void fail() const { throw Error() << "Bad pattern: " << pattern_; }
+
+    bool next(char c) const { return pos_ < pattern_.size() && pattern_[pos_] == c; }
+
+    int addState()
+    {
+        if (states_.size() >= MAX_STATES)
+        {
+            throw Error() << "Too complex pattern: " << pattern_;
+        }
+        states_.push_back({-1, -1, {-1, -1}});
+        return static_cast<int>(states_.size() - 1);
+    }
+
+    void link(int from, int to)
+    {
+        auto& epsilon = states_[static_cast<size_t>(from)].epsilon;
+        (epsilon[0] < 0 ? epsilon[0] : epsilon[1]) = to;
+    }
+
+    Fragment empty()
+    {
+        int state = addState();
+        return {state, state};
+    }
+
+    Fragment symbols(const SymbolSet& set)
+    {
+        int start = addState();
+        int end = addState();
+        sets_.push_back(set);
+        states_[static_cast<size_t>(start)].set = static_cast<int>(sets_.size() - 1);
+        states_[static_cast<size_t>(start)].next = end;
+        return {start, end};
+    }
+
+    Fragment concatenate(Fragment lhs, Fragment rhs)
+    {
+        link(lhs.end, rhs.start);
+        return {lhs.start, rhs.end};
+    }
+
+    Fragment alternate(Fragment lhs, Fragment rhs)
+    {
+        int start = addState();
+        int end = addState();
+        link(start, lhs.start);
+        link(start, rhs.start);
+        link(lhs.end, end);
+        link(rhs.end, end);
+        return {start, end};
+    }
+
+    Fragment optional(Fragment fragment)
+    {
+        int start = addState();
+        int end = addState();
+        link(start, fragment.start);
+        link(start, end);
+        link(fragment.end, end);
+        return {start, end};
+    }
+
+    Fragment star(Fragment fragment)
+    {
+        Fragment result = optional(fragment);
+        link(fragment.end, fragment.start);
+        return result;
+    }
+
+    Fragment plus(Fragment fragment)
+    {
+        int end = addState();
+        link(fragment.end, fragment.start);
+        link(fragment.end, end);
+        return {fragment.start, end};
+    }
+
+    Fragment parseAlternation()
+    {
+        Fragment fragment = parseConcatenation();
+        while (next('|'))
+        {
+            ++pos_;
+            Fragment alternative = parseConcatenation();
+            fragment = alternate(fragment, alternative);
+        }
+        return fragment;
+    }
+
+    Fragment parseConcatenation()
+    {
+        Fragment fragment = empty();
+        while (pos_ < pattern_.size() && !next('|') && !next(')'))
+        {
+            Fragment repetition = parseRepetition();
+            fragment = concatenate(fragment, repetition);
+        }
+        return fragment;
+    }
+
+    Fragment parseRepetition()
+    {
+        size_t atomPos = pos_;
+        Fragment atom = parseAtom();
+
+        if (next('*'))
+        {
+            ++pos_;
+            atom = star(atom);
+        }
+        else if (next('+'))
+        {
+            ++pos_;
+            atom = plus(atom);
+        }
+        else if (next('?'))
+        {
+            ++pos_;
+            atom = optional(atom);
+        }
+        else if (next('{'))
+        {
+            atom = parseBounds(atom, atomPos);
+        }
+
+        if (next('*') || next('+') || next('?') || next('{'))
+        {
+            fail();
+        }
+        return atom;
+    }
+
+    // {n}, {n,} or {n,m} after an atom
+    Fragment parseBounds(Fragment atom, size_t atomPos)
+    {
+        ++pos_;
+        size_t min = parseNumber();
+        size_t max = min;
+        if (next(','))
+        {
+            ++pos_;
+            max = next('}') ? SIZE_MAX : parseNumber();
+        }
+        if (!next('}') || min > max || (max != SIZE_MAX && max > MAX_REPEAT))
+        {
+            fail();
+        }
+        size_t endPos = ++pos_;
+
+        // The first copy is the parsed atom, the others are parsed again
+        bool used = false;
+        auto copy = [&] {
+            if (!used)
+            {
+                used = true;
+                return atom;
+            }
+            pos_ = atomPos;
+            return parseAtom();
+        };
+
+        Fragment result = empty();
+        for (size_t i = 0; i < min; ++i)
+        {
+            result = concatenate(result, copy());
+        }
+        if (max == SIZE_MAX)
+        {
+            result = concatenate(result, star(copy()));
+        }
+        for (size_t i = min; i < max && max != SIZE_MAX; ++i)
+        {
+            result = concatenate(result, optional(copy()));
+        }
+        pos_ = endPos;
+        return result;
+    }
+
+    size_t parseNumber()
+    {
+        size_t number = 0;
+        size_t begin = pos_;
+        for (; pos_ < pattern_.size() && pattern_[pos_] >= '0' && pattern_[pos_] <= '9'; ++pos_)
+        {
+            number = number * 10 + static_cast<size_t>(pattern_[pos_] - '0');
+            if (number > MAX_REPEAT)
+            {
+                fail();
+            }
+        }
+        if (pos_ == begin)
+        {
+            fail();
+        }
+        return number;
+    }
+
+    Fragment parseAtom()
+    {
+        char c = pattern_[pos_++];
+        SymbolSet set;
+        switch (c)
+        {
+        case '(':
+        {
+            Fragment fragment = parseAlternation();
+            if (!next(')'))
+            {
+                fail();
+            }
+            ++pos_;
+            return fragment;
+        }
+
+        case '[':
+            return symbols(parseClass());
+
+        case '.':
+            set.set();
+            return symbols(set);
+
+        case '\\':
+            return symbols(parseEscape());
+
+        case ')':
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case '}':
+        case ']':
+            fail();
+
+        default:
+            set.set(static_cast<unsigned char>(c));
+            return symbols(set);
+        }
+    }
+
+    // Escaped character after '\', either a class or a literal punctuation character
+    SymbolSet parseEscape()
+    {
+        if (pos_ == pattern_.size())
+        {
+            fail();
+        }
+
+        char c = pattern_[pos_++];
+        SymbolSet set;
+        switch (c)
+        {
+        case 'd':
+            addRange(set, '0', '9');
+            break;
+
+        case 'w':
+            addRange(set, 'a', 'z');
+            addRange(set, 'A', 'Z');
+            addRange(set, '0', '9');
+            set.set('_');
+            break;
+
+        case 's':
+            for (char space : {' ', '\t', '\n', '\r', '\f', '\v'})
+            {
+                set.set(static_cast<unsigned char>(space));
+            }
+            break;
+
+        default:
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+            {
+                fail();
+            }
+            set.set(static_cast<unsigned char>(c));
+        }
+        return set;
+    }
+
+    // Character class after '[', e.g. [a-z0-9_-] or [^/]
+    SymbolSet parseClass()
+    {
+        bool negate = next('^');
+        if (negate)
+        {
+            ++pos_;
+        }
+
+        SymbolSet set;
+        bool first = true;
+        while (first || !next(']'))
+        {
+            if (pos_ == pattern_.size())
+            {
+                fail();
+            }
+            first = false;
+
+            char c = pattern_[pos_++];
+            if (c == '\\')
+            {
+                SymbolSet escaped = parseEscape();
+                if (escaped.count() != 1)
+                {
+                    set |= escaped;
+                    continue;
+                }
+                c = pattern_[pos_ - 1];
+            }
+
+            char last = c;
+            if (next('-') && pos_ + 1 < pattern_.size() && pattern_[pos_ + 1] != ']')
+            {
+                ++pos_;
+                last = pattern_[pos_++];
+                if (last == '\\')
+                {
+                    SymbolSet escaped = parseEscape();
+                    if (escaped.count() != 1)
+                    {
+                        fail();
+                    }
+                    last = pattern_[pos_ - 1];
+                }
+            }
+
+            if (static_cast<unsigned char>(c) > static_cast<unsigned char>(last))
+            {
+                fail();
+            }
+            addRange(set, c, last);
+        }
+        ++pos_;
+
+        return negate ? ~set : set;
+    }
+
+    static void addRange(SymbolSet& set, char first, char last)
+    {
+        for (size_t c = static_cast<unsigned char>(first); c <= static_cast<unsigned char>(last);
+             ++c)
+        {
+            set.set(c);
+        }
+    }
+
+    const std::string& pattern_;
+    size_t pos_ = 0;
+    std::vector<State> states_;
+    std::vector<SymbolSet> sets_;
+    int start_ = -1;
+    int accept_ = -1;
+};
+
+// DFA of a pattern over the classes of the symbols that no pattern character class tells
+// apart, matching costs one table lookup per argument character
+class PatternDfa
+{
+public:
+    static constexpr size_t MATCH = static_cast<size_t>(-1);
+
+    explicit PatternDfa(std::string pattern) : pattern_(std::move(pattern))
+    {
+        PatternNfa nfa(pattern_);
+        makeClasses(nfa);
+        determinize(nfa);
+    }
+
+    const std::string& pattern() const { return pattern_; }
+
+    /// Returns MATCH if the whole value matches, otherwise the offset of the first character
+    /// that cannot continue a match or the value size if the value is only a match prefix.
+    ///
+    size_t mismatch(const Char* begin, const Char* end) const
+    {
+        // The dead state is never left, so the loop does not check for it
+        const uint32_t* transitions = transitions_.data();
+        const uint16_t* classes = classes_.data();
+        uint32_t state = START * classCount_;
+        for (const Char* c = begin; c != end; ++c)
+        {
+            state = transitions[state + classes[patternSymbol(*c)]];
+        }
+
+        if (accepting_[state / classCount_])
+        {
+            return MATCH;
+        }
+        if (state != DEAD)
+        {
+            return static_cast<size_t>(end - begin);
+        }
+
+        // Find where a bad value stops matching
+        state = START * classCount_;
+        for (const Char* c = begin;; ++c)
+        {
+            state = transitions[state + classes[patternSymbol(*c)]];
+            if (state == DEAD)
+            {
+                return static_cast<size_t>(c - begin);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t DEAD = 0;
+    static constexpr uint32_t START = 1;
+    static constexpr size_t MAX_STATES = 4096;
+
+    // Splits the symbols into the classes of the same membership in all symbol sets
+    void makeClasses(const PatternNfa& nfa)
+    {
+        classes_.fill(0);
+        classCount_ = 1;
+        std::vector<int> ids;
+        for (const auto& set : nfa.sets())
+        {
+            ids.assign(2 * classCount_, -1);
+            size_t count = 0;
+            for (size_t symbol = 0; symbol < PATTERN_SYMBOLS; ++symbol)
+            {
+                int& id = ids[2 * classes_[symbol] + (set[symbol] ? 1 : 0)];
+                if (id < 0)
+                {
+                    id = static_cast<int>(count++);
+                }
+                classes_[symbol] = static_cast<uint16_t>(id);
+            }
+            classCount_ = static_cast<uint32_t>(count);
+        }
+
+        representatives_.resize(classCount_);
+        for (size_t symbol = PATTERN_SYMBOLS; symbol-- > 0;)
+        {
+            representatives_[classes_[symbol]] = symbol;
+        }
+    }
+
+    // Subset construction, DFA state 0 is the dead state and 1 the start
+    void determinize(const PatternNfa& nfa)
+    {
+        const auto& states = nfa.states();
+        std::vector<size_t> marks(states.size(), 0);
+        size_t mark = 0;
+
+        auto closure = [&](std::vector<int>& set) {
+            ++mark;
+            std::vector<int> stack(set);
+            set.clear();
+            while (!stack.empty())
+            {
+                int state = stack.back();
+                stack.pop_back();
+                if (marks[static_cast<size_t>(state)] == mark)
+                {
+                    continue;
+                }
+                marks[static_cast<size_t>(state)] = mark;
+                set.push_back(state);
+                for (int epsilon : states[static_cast<size_t>(state)].epsilon)
+                {
+                    if (epsilon >= 0)
+                    {
+                        stack.push_back(epsilon);
+                    }
+                }
+            }
+            std::sort(set.begin(), set.end());
+        };
+
+        std::map<std::vector<int>, size_t> ids;
+        std::vector<std::vector<int>> subsets;
+        auto add = [&](std::vector<int>& subset) {
+            auto iter = ids.find(subset);
+            if (iter != ids.end())
+            {
+                return iter->second;
+            }
+            if (subsets.size() >= MAX_STATES)
+            {
+                throw Error() << "Too complex pattern: " << pattern_;
+            }
+
+            size_t id = subsets.size();
+            ids.emplace(subset, id);
+            accepting_.push_back(std::binary_search(subset.begin(), subset.end(), nfa.accept()));
+            subsets.push_back(std::move(subset));
+            transitions_.resize(subsets.size() * classCount_, uint32_t(DEAD));
+            return id;
+        };
+
+        std::vector<int> subset;
+        add(subset); // DEAD
+        subset.push_back(nfa.start());
+        closure(subset);
+        add(subset); // START
+
+        for (size_t id = START; id < subsets.size(); ++id)
+        {
+            for (size_t c = 0; c < classCount_; ++c)
+            {
+                subset.clear();
+                for (int state : subsets[id])
+                {
+                    const auto& s = states[static_cast<size_t>(state)];
+                    if (s.set >= 0 && nfa.sets()[static_cast<size_t>(s.set)][representatives_[c]])
+                    {
+                        subset.push_back(s.next);
+                    }
+                }
+                if (subset.empty())
+                {
+                    continue;
+                }
+                closure(subset);
+                transitions_[id * classCount_ + c] =
+                    static_cast<uint32_t>(add(subset) * classCount_);
+            }
+        }
+    }
+
+    std::string pattern_;
+    std::array<uint16_t, PATTERN_SYMBOLS> classes_;
+    std::vector<size_t> representatives_;
+    uint32_t classCount_ = 1;
+    std::vector<uint32_t> transitions_; // offsets of the next states in the table
+    std::vector<bool> accepting_;
+};
+
+class PatternConverter
+{
+public:
+    explicit PatternConverter(std::string pattern)
+        : dfa_(std::make_shared<const PatternDfa>(std::move(pattern)))
+    {
+    }
+
+    bool operator()(const Char* begin, const Char* end, std::basic_string<Char>& value) const
+    {
+        if (dfa_->mismatch(begin, end) != PatternDfa::MATCH)
+        {
+            return false;
+        }
+        value.assign(begin, end);
+        return true;
+    }
+
+#ifdef _WIN32
+    bool operator()(const Char* begin, const Char* end, std::string& value) const
+    {
+        if (dfa_->mismatch(begin, end) != PatternDfa::MATCH)
+        {
+            return false;
+        }
+
+        value.resize(static_cast<size_t>(end - begin));
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            if (begin[i] > 127)
+            {
+                return false;
+            }
+            value[i] = static_cast<char>(begin[i]);
+        }
+        return true;
+    }
+#endif // _WIN32
+
+    std::string getValidValues() const { return "strings matching " + dfa_->pattern(); }
+
+    std::string describeError(const Char* begin, const Char* end) const
+    {
+        size_t offset = dfa_->mismatch(begin, end);
+        return offset != PatternDfa::MATCH ? "mismatch at offset " + std::to_string(offset)
+                                           : std::string();
+    }
+
+private:
+    // Shared by the copies of the converter
+    std::shared_ptr<const PatternDfa> dfa_;
+};
+
+} // namespace details
+
+/// Returns a converter of strings matching a pattern, e.g.
+///     parser.addParam(bucket, "bucket", "Bucket", matching("[a-z0-9][a-z0-9.-]{2,62}"));
+/// The whole argument must match. A pattern consists of characters, '.' for any character,
+/// classes like [a-z_] or [^/], escapes \d, \w, \s or \ before a special character, groups,
+/// '|' alternatives and the repetitions *, +, ?, {n}, {n,} and {n,m}. The pattern is compiled
+/// into a DFA once, so checking an argument costs a table lookup per character, and a bad
+/// argument is reported with the offset where it stops matching. Patterns are matched bytewise.
+///
+inline details::PatternConverter matching(std::string pattern)
+{
+    return details::PatternConverter(std::move(pattern));
+}
+
+} // namespace cmd_line_args
+} // namespace over9000
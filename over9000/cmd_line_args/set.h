@@ -0,0 +1,429 @@
+// Command line argument parser: set list targets
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+inline size_t mixHash(size_t hash)
+{
+    uint64_t x = hash;
+    x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdull;
+    x = (x ^ (x >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    return static_cast<size_t>(x ^ (x >> 33));
+}
+
+// Sorts unsigned keys by bytes from the least significant one, skipping the bytes that are
+// equal in all keys, e.g. the high bytes of small identifiers
+template<class Key>
+void radixSort(std::vector<Key>& keys)
+{
+    const size_t MIN_SIZE = 64;
+    if (keys.size() < MIN_SIZE)
+    {
+        std::sort(keys.begin(), keys.end());
+        return;
+    }
+
+    std::vector<Key> buffer(keys.size());
+    for (size_t shift = 0; shift < sizeof(Key) * CHAR_BIT; shift += 8)
+    {
+        std::array<size_t, 256> counts{};
+        for (Key key : keys)
+        {
+            ++counts[(key >> shift) & 0xff];
+        }
+
+        if (counts[(keys[0] >> shift) & 0xff] == keys.size())
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (auto& count : counts)
+        {
+            size_t next = offset + count;
+            count = offset;
+            offset = next;
+        }
+
+        for (Key key : keys)
+        {
+            buffer[counts[(key >> shift) & 0xff]++] = key;
+        }
+        keys.swap(buffer);
+    }
+}
+
+} // namespace details
+
+/// Set of the values of a list parameter with constant time membership queries, e.g. of
+/// allowed users:
+///     HashSet<std::string> users;
+///     parser.addParam(users, "allow-user", "Allowed users", OPTIONAL);
+///     if (users.contains(user)) ...
+/// The values are appended as they are parsed and the set is built in bulk once the parse
+/// ends: an open addressing table is allocated for all of them at once and repeated values
+/// are dropped, keeping the first occurrences in their order. Values appended otherwise are
+/// found after build().
+///
+template<class T, class Hash = std::hash<T>>
+class HashSet
+{
+public:
+    using value_type = T;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    void push_back(const T& value) { values_.push_back(value); }
+    void push_back(T&& value) { values_.push_back(std::move(value)); }
+
+    /// Builds the table for the appended values, a no-op if there are none.
+    ///
+    void build()
+    {
+        if (built_ == values_.size())
+        {
+            return;
+        }
+
+        size_t capacity = 16;
+        while (capacity < 2 * values_.size())
+        {
+            capacity *= 2;
+        }
+        slots_.assign(capacity, 0);
+
+        size_t size = 0;
+        for (size_t i = 0; i < values_.size(); ++i)
+        {
+            uint32_t& slot = slots_[findSlot(values_[i], size)];
+            if (slot != 0)
+            {
+                continue;
+            }
+
+            if (size != i)
+            {
+                values_[size] = std::move(values_[i]);
+            }
+            slot = static_cast<uint32_t>(++size);
+        }
+        values_.erase(values_.begin() + static_cast<std::ptrdiff_t>(size), values_.end());
+        built_ = size;
+    }
+
+    bool contains(const T& value) const
+    {
+        return !slots_.empty() && slots_[findSlot(value, built_)] != 0;
+    }
+
+    const_iterator begin() const { return values_.begin(); }
+    const_iterator end() const { return values_.end(); }
+
+    /// Returns the number of values, each counted once after build().
+    ///
+    size_t size() const { return values_.size(); }
+    bool empty() const { return values_.empty(); }
+
+    void reserve(size_t size) { values_.reserve(size); }
+
+    /// Removes all values keeping the memory for reuse.
+    ///
+    void clear()
+    {
+        values_.clear();
+        std::fill(slots_.begin(), slots_.end(), 0);
+        built_ = 0;
+    }
+
+private:
+    // Returns the slot of an equal value among the first size ones or an empty slot for it
+    size_t findSlot(const T& value, size_t size) const
+    {
+        size_t mask = slots_.size() - 1;
+        size_t i = details::mixHash(Hash()(value)) & mask;
+        for (; slots_[i] != 0; i = (i + 1) & mask)
+        {
+            size_t index = slots_[i] - 1;
+            if (index < size && values_[index] == value)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+
+    std::vector<T> values_;
+    std::vector<uint32_t> slots_; // value index + 1, 0 for empty slots
+    size_t built_ = 0;            // Values in the table
+};
+
+/// Sorted set of the integer values of a list parameter with logarithmic membership queries,
+/// e.g. of excluded shards:
+///     IntegerSet<uint32_t> shards;
+///     parser.addParam(shards, "exclude-shard", "Excluded shards", OPTIONAL);
+///     if (shards.contains(shard)) ...
+/// The values are appended as they are parsed, and once the parse ends they are radix sorted
+/// and repeated values are dropped. With compression the sorted values are kept as blocks of
+/// bit-packed deltas, e.g. a dense range of IDs takes a few bits per value. Values appended
+/// otherwise are found after build().
+///
+template<class T>
+class IntegerSet
+{
+    static_assert(std::is_integral<T>::value, "IntegerSet requires an integral value type");
+
+    using Key = typename std::make_unsigned<T>::type;
+
+public:
+    using value_type = T;
+
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = T;
+
+        Iterator(const IntegerSet* set, size_t index) : set_(set), index_(index)
+        {
+            if (index_ < set_->size_)
+            {
+                key_ = set_->keyAt(index_, 0);
+            }
+        }
+
+        T operator*() const { return fromKey(key_); }
+
+        Iterator& operator++()
+        {
+            if (++index_ < set_->size_)
+            {
+                key_ = set_->keyAt(index_, key_);
+            }
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        friend bool operator==(Iterator lhs, Iterator rhs) { return lhs.index_ == rhs.index_; }
+        friend bool operator!=(Iterator lhs, Iterator rhs) { return lhs.index_ != rhs.index_; }
+
+    private:
+        const IntegerSet* set_;
+        size_t index_;
+        Key key_ = 0;
+    };
+
+    using const_iterator = Iterator;
+
+    explicit IntegerSet(bool compressed = false) : compressed_(compressed) {}
+
+    void push_back(T value) { appended_.push_back(toKey(value)); }
+
+    /// Sorts the appended values into the set, a no-op if there are none.
+    ///
+    void build()
+    {
+        if (appended_.empty())
+        {
+            return;
+        }
+
+        std::vector<Key> keys;
+        keys.reserve(size_ + appended_.size());
+        for (size_t i = 0; i < size_; ++i)
+        {
+            keys.push_back(keyAt(i, keys.empty() ? 0 : keys.back()));
+        }
+        keys.insert(keys.end(), appended_.begin(), appended_.end());
+        appended_.clear();
+
+        details::radixSort(keys);
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        size_ = keys.size();
+
+        if (!compressed_)
+        {
+            keys_.swap(keys);
+            return;
+        }
+
+        keys_.clear();
+        pack(keys);
+    }
+
+    bool contains(T value) const
+    {
+        Key key = toKey(value);
+        if (!compressed_)
+        {
+            return std::binary_search(keys_.begin(), keys_.end(), key);
+        }
+
+        auto block = std::upper_bound(blocks_.begin(), blocks_.end(), key,
+                                      [](Key lhs, const Block& rhs) { return lhs < rhs.first; });
+        if (block == blocks_.begin())
+        {
+            return false;
+        }
+        --block;
+
+        size_t index = static_cast<size_t>(block - blocks_.begin()) * BLOCK_SIZE;
+        size_t end = std::min(index + BLOCK_SIZE, size_);
+        Key current = block->first;
+        while (current < key && ++index < end)
+        {
+            current = keyAt(index, current);
+        }
+        return current == key;
+    }
+
+    Iterator begin() const { return {this, 0}; }
+    Iterator end() const { return {this, size_}; }
+
+    /// Returns the number of values after build().
+    ///
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0 && appended_.empty(); }
+
+    /// Returns the number of bytes kept for the built values.
+    ///
+    size_t byteCount() const
+    {
+        return keys_.size() * sizeof(Key) + blocks_.size() * sizeof(Block) +
+               bits_.size() * sizeof(uint64_t);
+    }
+
+    /// Removes all values keeping the memory for reuse.
+    ///
+    void clear()
+    {
+        appended_.clear();
+        keys_.clear();
+        blocks_.clear();
+        bits_.clear();
+        size_ = 0;
+    }
+
+private:
+    // Keys are ordered like the values
+    static constexpr Key SIGN_BIT =
+        std::is_signed<T>::value ? static_cast<Key>(Key(1) << (sizeof(Key) * CHAR_BIT - 1)) : 0;
+
+    static Key toKey(T value) { return static_cast<Key>(static_cast<Key>(value) ^ SIGN_BIT); }
+    static T fromKey(Key key) { return static_cast<T>(static_cast<Key>(key ^ SIGN_BIT)); }
+
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    struct Block
+    {
+        Key first;
+        uint32_t offset; // of the deltas in bits_, in bits
+        uint32_t width;  // of a delta in bits
+    };
+
+    // Returns the key at an index given the key before it
+    Key keyAt(size_t index, Key previous) const
+    {
+        if (!compressed_)
+        {
+            return keys_[index];
+        }
+
+        const Block& block = blocks_[index / BLOCK_SIZE];
+        size_t position = index % BLOCK_SIZE;
+        if (position == 0)
+        {
+            return block.first;
+        }
+
+        if (block.width == 0)
+        {
+            return previous;
+        }
+
+        size_t bit = block.offset + (position - 1) * block.width;
+        size_t word = bit / 64;
+        size_t shift = bit % 64;
+        uint64_t delta = bits_[word] >> shift;
+        if (shift + block.width > 64)
+        {
+            delta |= bits_[word + 1] << (64 - shift);
+        }
+        if (block.width < 64)
+        {
+            delta &= (uint64_t(1) << block.width) - 1;
+        }
+        return static_cast<Key>(previous + delta);
+    }
+
+    void pack(const std::vector<Key>& keys)
+    {
+        blocks_.clear();
+        bits_.clear();
+        size_t bit = 0;
+        for (size_t begin = 0; begin < keys.size(); begin += BLOCK_SIZE)
+        {
+            size_t end = std::min(begin + BLOCK_SIZE, keys.size());
+            uint64_t maxDelta = 0;
+            for (size_t i = begin + 1; i < end; ++i)
+            {
+                maxDelta = std::max<uint64_t>(maxDelta, keys[i] - keys[i - 1]);
+            }
+
+            uint32_t width = 0;
+            while (width < 64 && (maxDelta >> width) != 0)
+            {
+                ++width;
+            }
+
+            blocks_.push_back({keys[begin], static_cast<uint32_t>(bit), width});
+            bits_.resize((bit + (end - begin - 1) * width + 63) / 64, 0);
+            for (size_t i = begin + 1; i < end && width != 0; ++i, bit += width)
+            {
+                uint64_t delta = keys[i] - keys[i - 1];
+                size_t shift = bit % 64;
+                bits_[bit / 64] |= delta << shift;
+                if (shift + width > 64)
+                {
+                    bits_[bit / 64 + 1] |= delta >> (64 - shift);
+                }
+            }
+        }
+    }
+
+    bool compressed_;
+    std::vector<Key> appended_; // Not built yet
+    std::vector<Key> keys_;     // Sorted unless compressed
+    std::vector<Block> blocks_;
+    std::vector<uint64_t> bits_;
+    size_t size_ = 0;
+};
+
+} // namespace cmd_line_args
+} // namespace over9000
@@ -0,0 +1,282 @@
+// Command line argument parser: small vector list targets
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace over9000 {
+namespace cmd_line_args {
+
+/// Vector keeping up to N values inline, a list parameter target for lists that usually have a
+/// few values, e.g.
+///     SmallVector<std::string, 4> hosts;
+///     parser.addParam(hosts, "host", "Hosts", OPTIONAL);
+/// takes no heap allocation unless more than 4 hosts are given. Past N the values are moved to
+/// the heap like by std::vector, so the moves of T should not throw.
+///
+template<class T, size_t N>
+class SmallVector
+{
+public:
+    static_assert(N > 0, "SmallVector requires an inline capacity");
+
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() = default;
+
+    SmallVector(const SmallVector& other)
+    {
+        reserve(other.size_);
+        for (const auto& value : other)
+        {
+            push_back(value);
+        }
+    }
+
+    SmallVector(SmallVector&& other) noexcept { moveFrom(other); }
+
+    ~SmallVector()
+    {
+        clear();
+        release();
+    }
+
+    SmallVector& operator=(const SmallVector& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            reserve(other.size_);
+            for (const auto& value : other)
+            {
+                push_back(value);
+            }
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template<class... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (size_ == capacity_)
+        {
+            // The new value is constructed first since the arguments may refer to the old ones
+            size_t capacity = 2 * capacity_;
+            T* data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+            try
+            {
+                new (data + size_) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                ::operator delete(data);
+                throw;
+            }
+            moveTo(data);
+            release();
+            data_ = data;
+            capacity_ = capacity;
+        }
+        else
+        {
+            new (data_ + size_) T(std::forward<Args>(args)...);
+        }
+        return data_[size_++];
+    }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity <= capacity_)
+        {
+            return;
+        }
+
+        T* data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+        moveTo(data);
+        release();
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+
+    /// Returns whether the values are kept inline.
+    ///
+    bool isInline() const { return data_ == inlineData(); }
+
+    /// Removes all values keeping the memory for reuse.
+    ///
+    void clear()
+    {
+        for (size_t i = 0; i < size_; ++i)
+        {
+            data_[i].~T();
+        }
+        size_ = 0;
+    }
+
+    friend bool operator==(const SmallVector& lhs, const SmallVector& rhs)
+    {
+        return lhs.size_ == rhs.size_ && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const SmallVector& lhs, const SmallVector& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    T* inlineData() { return reinterpret_cast<T*>(&inline_); }
+    const T* inlineData() const { return reinterpret_cast<const T*>(&inline_); }
+
+    // Moves the values to uninitialized memory
+    void moveTo(T* data)
+    {
+        for (size_t i = 0; i < size_; ++i)
+        {
+            new (data + i) T(std::move(data_[i]));
+            data_[i].~T();
+        }
+    }
+
+    // Frees the heap memory of the values if any
+    void release()
+    {
+        if (!isInline())
+        {
+            ::operator delete(data_);
+            data_ = inlineData();
+            capacity_ = N;
+        }
+    }
+
+    void moveFrom(SmallVector& other)
+    {
+        if (other.isInline())
+        {
+            other.moveTo(data_);
+            size_ = other.size_;
+            other.size_ = 0;
+            return;
+        }
+
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        other.data_ = other.inlineData();
+        other.size_ = 0;
+        other.capacity_ = N;
+    }
+
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+    T* data_ = inlineData();
+    size_t size_ = 0;
+    size_t capacity_ = N;
+};
+
+/// Vector of at most N values kept in a std::array with a count, a list parameter target for
+/// lists of a fixed maximum size, e.g. a range of two values:
+///     StaticVector<int, 2> range;
+///     parser.addParam(range, "range", "Range", OPTIONAL);
+/// An argument past N values is a bad argument.
+///
+template<class T, size_t N>
+class StaticVector
+{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    void push_back(const T& value)
+    {
+        checkCapacity();
+        values_[size_++] = value;
+    }
+
+    void push_back(T&& value)
+    {
+        checkCapacity();
+        values_[size_++] = std::move(value);
+    }
+
+    T& operator[](size_t i) { return values_[i]; }
+    const T& operator[](size_t i) const { return values_[i]; }
+
+    iterator begin() { return values_.data(); }
+    iterator end() { return values_.data() + size_; }
+    const_iterator begin() const { return values_.data(); }
+    const_iterator end() const { return values_.data() + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == N; }
+
+    /// Removes all values, the array elements are kept as they are.
+    ///
+    void clear() { size_ = 0; }
+
+    friend bool operator==(const StaticVector& lhs, const StaticVector& rhs)
+    {
+        return lhs.size_ == rhs.size_ && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const StaticVector& lhs, const StaticVector& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    void checkCapacity() const
+    {
+        if (full())
+        {
+            throw Error() << "More than " << N << " values";
+        }
+    }
+
+    std::array<T, N> values_{};
+    size_t size_ = 0;
+};
+
+} // namespace cmd_line_args
+} // namespace over9000
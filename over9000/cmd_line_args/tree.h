@@ -0,0 +1,408 @@
+// Command line argument parser: hierarchical options
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace over9000 {
+namespace cmd_line_args {
+namespace details {
+
+// Bump allocator of trivially destructible objects, clear() keeps the blocks for reuse
+class Arena
+{
+public:
+    void* allocate(size_t size, size_t alignment)
+    {
+        for (; block_ < blocks_.size(); ++block_, offset_ = 0)
+        {
+            auto& block = blocks_[block_];
+            auto address = reinterpret_cast<uintptr_t>(block.data.get());
+            size_t offset = ((address + offset_ + alignment - 1) & ~(alignment - 1)) - address;
+            if (offset + size <= block.size)
+            {
+                offset_ = offset + size;
+                return block.data.get() + offset;
+            }
+        }
+
+        size_t blockSize = blocks_.empty() ? FIRST_BLOCK_SIZE : blocks_.back().size * 2;
+        blockSize = std::max(blockSize, size + alignment);
+        blocks_.push_back({std::unique_ptr<char[]>(new char[blockSize]), blockSize});
+        block_ = blocks_.size() - 1;
+        offset_ = 0;
+        return allocate(size, alignment);
+    }
+
+    template<class T>
+    T* make()
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena objects are not destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T();
+    }
+
+    // Copies a string adding a terminating null
+    template<class C>
+    C* copy(const C* string, size_t size)
+    {
+        auto* result = static_cast<C*>(allocate((size + 1) * sizeof(C), alignof(C)));
+        std::memcpy(result, string, size * sizeof(C));
+        result[size] = '\0';
+        return result;
+    }
+
+    void clear()
+    {
+        block_ = 0;
+        offset_ = 0;
+    }
+
+private:
+    static constexpr size_t FIRST_BLOCK_SIZE = 4096;
+
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t block_ = 0;
+    size_t offset_ = 0;
+};
+
+} // namespace details
+
+/// Tree of dotted option names, e.g. db.replicas.0.host, filled by Parser::addTree().
+/// Nodes, names and values live in an arena and children are found through a single hash
+/// index of the whole tree, so neither building nor querying allocates per node. A value is
+/// overwritten in place when the new one fits, and clear() reuses the whole arena.
+///
+class OptionTree
+{
+public:
+    class Node
+    {
+    public:
+        /// Returns the name segment of the node, empty for the root.
+        ///
+        const char* name() const { return name_; }
+
+        /// Returns the full dotted name of the node.
+        ///
+        std::string path() const
+        {
+            if (parent_ == nullptr || parent_->parent_ == nullptr)
+            {
+                return name_;
+            }
+            return parent_->path() + "." + name_;
+        }
+
+        const Node* parent() const { return parent_; }
+
+        /// Returns the first child, the children are kept in the insertion order.
+        ///
+        const Node* firstChild() const { return firstChild_; }
+
+        const Node* nextSibling() const { return nextSibling_; }
+
+        bool hasValue() const { return value_ != nullptr; }
+
+        /// Returns the null terminated value or nullptr if the node has no value.
+        ///
+        const Char* value() const { return value_; }
+
+        size_t valueSize() const { return valueSize_; }
+
+        /// Converts the value like a parameter of type T, returns false if the node has no value
+        /// or it cannot be converted.
+        ///
+        template<class T>
+        bool get(T& value) const
+        {
+            if (value_ == nullptr)
+            {
+                return false;
+            }
+
+            details::Converter<T> converter;
+            std::basic_stringstream<Char> stream;
+            return details::convert(converter, value_, value_ + valueSize_, stream, value);
+        }
+
+    private:
+        friend class OptionTree;
+
+        const char* name_ = "";
+        uint32_t nameSize_ = 0;
+        uint32_t hash_ = 0;
+        Node* parent_ = nullptr;
+        Node* firstChild_ = nullptr;
+        Node* lastChild_ = nullptr;
+        Node* nextSibling_ = nullptr;
+        Char* value_ = nullptr;
+        size_t valueSize_ = 0;
+        size_t valueCapacity_ = 0;
+    };
+
+    OptionTree() { clear(); }
+
+    OptionTree(const OptionTree&) = delete;
+    OptionTree& operator=(const OptionTree&) = delete;
+
+    /// Moves the nodes, the moved-from tree is left empty.
+    ///
+    OptionTree(OptionTree&& other)
+        : arena_(std::move(other.arena_))
+        , index_(std::move(other.index_))
+        , root_(other.root_)
+        , nodeCount_(other.nodeCount_)
+        , size_(other.size_)
+    {
+        other.clear();
+    }
+
+    OptionTree& operator=(OptionTree&& other)
+    {
+        if (this != &other)
+        {
+            arena_ = std::move(other.arena_);
+            index_ = std::move(other.index_);
+            root_ = other.root_;
+            nodeCount_ = other.nodeCount_;
+            size_ = other.size_;
+            other.clear();
+        }
+        return *this;
+    }
+
+    /// Sets a dotted name to a value, creating the missing nodes.
+    ///
+    void set(const char* key, size_t keySize, const Char* value, size_t valueSize)
+    {
+        Node* node = root_;
+        size_t pos = 0;
+        while (pos <= keySize)
+        {
+            auto* dot = static_cast<const char*>(std::memchr(key + pos, '.', keySize - pos));
+            size_t dotPos = dot != nullptr ? static_cast<size_t>(dot - key) : keySize;
+            if (dotPos == pos)
+            {
+                throw Error() << "Bad option name: " << std::string(key, keySize);
+            }
+
+            node = child(node, key + pos, dotPos - pos);
+            pos = dotPos + 1;
+        }
+
+        if (node->value_ == nullptr)
+        {
+            ++size_;
+        }
+
+        // A value that fits overwrites the old one, so the arena of a tree set by many parses
+        // only grows with new names and longer values
+        if (node->value_ == nullptr || valueSize > node->valueCapacity_)
+        {
+            node->value_ = arena_.copy(value, valueSize);
+            node->valueCapacity_ = valueSize;
+        }
+        else
+        {
+            std::memcpy(node->value_, value, valueSize * sizeof(Char));
+            node->value_[valueSize] = '\0';
+        }
+        node->valueSize_ = valueSize;
+    }
+
+    void set(const std::string& key, const std::basic_string<Char>& value)
+    {
+        set(key.data(), key.size(), value.data(), value.size());
+    }
+
+    /// Returns the node of a dotted name, the root for an empty one, or nullptr if not found.
+    ///
+    const Node* find(const std::string& key) const
+    {
+        if (key.empty())
+        {
+            return root_;
+        }
+
+        const Node* node = root_;
+        size_t pos = 0;
+        while (node != nullptr && pos <= key.size())
+        {
+            const char* name = key.data() + pos;
+            size_t size = std::min(key.find('.', pos), key.size()) - pos;
+            node = findChild(node, name, size, hash(node, name, size));
+            pos += size + 1;
+        }
+        return node;
+    }
+
+    /// Converts the value of a dotted name, returns false if there is no such value or it
+    /// cannot be converted.
+    ///
+    template<class T>
+    bool get(const std::string& key, T& value) const
+    {
+        const Node* node = find(key);
+        return node != nullptr && node->get(value);
+    }
+
+    /// Calls f(const Node&) for the nodes with values in the subtree of a dotted name, including
+    /// its own node, depth first in the insertion order, e.g. forEach("db.replicas", f).
+    ///
+    template<class F>
+    void forEach(const std::string& key, F f) const
+    {
+        const Node* top = find(key);
+        const Node* node = top;
+        while (node != nullptr)
+        {
+            if (node->value_ != nullptr)
+            {
+                f(*node);
+            }
+
+            if (node->firstChild_ != nullptr)
+            {
+                node = node->firstChild_;
+                continue;
+            }
+
+            while (node != top && node->nextSibling_ == nullptr)
+            {
+                node = node->parent_;
+            }
+            node = node != top ? node->nextSibling_ : nullptr;
+        }
+    }
+
+    const Node& root() const { return *root_; }
+
+    /// Returns the number of values.
+    ///
+    size_t size() const { return size_; }
+
+    /// Removes all nodes keeping the memory for reuse.
+    ///
+    void clear()
+    {
+        arena_.clear();
+        index_.assign(index_.empty() ? 64 : index_.size(), nullptr);
+        root_ = arena_.make<Node>();
+        nodeCount_ = 0;
+        size_ = 0;
+    }
+
+private:
+    static uint32_t hash(const Node* parent, const char* name, size_t size)
+    {
+        auto hash = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(parent) >> 4) * 2654435761u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(name[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    Node* findChild(const Node* parent, const char* name, size_t size, uint32_t h) const
+    {
+        size_t mask = index_.size() - 1;
+        for (size_t i = h & mask; index_[i] != nullptr; i = (i + 1) & mask)
+        {
+            Node* node = index_[i];
+            if (node->hash_ == h && node->parent_ == parent && node->nameSize_ == size &&
+                std::memcmp(node->name_, name, size) == 0)
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // Finds a child by name or creates it
+    Node* child(Node* parent, const char* name, size_t size)
+    {
+        uint32_t h = hash(parent, name, size);
+        Node* found = findChild(parent, name, size, h);
+        if (found != nullptr)
+        {
+            return found;
+        }
+
+        Node* node = arena_.make<Node>();
+        node->name_ = arena_.copy(name, size);
+        node->nameSize_ = static_cast<uint32_t>(size);
+        node->hash_ = h;
+        node->parent_ = parent;
+        if (parent->lastChild_ != nullptr)
+        {
+            parent->lastChild_->nextSibling_ = node;
+        }
+        else
+        {
+            parent->firstChild_ = node;
+        }
+        parent->lastChild_ = node;
+
+        if (2 * (nodeCount_ + 1) > index_.size())
+        {
+            rehash(index_.size() * 2);
+        }
+        insert(node);
+        ++nodeCount_;
+        return node;
+    }
+
+    void insert(Node* node)
+    {
+        size_t mask = index_.size() - 1;
+        size_t i = node->hash_ & mask;
+        while (index_[i] != nullptr)
+        {
+            i = (i + 1) & mask;
+        }
+        index_[i] = node;
+    }
+
+    void rehash(size_t size)
+    {
+        std::vector<Node*> index(size);
+        index.swap(index_);
+        for (Node* node : index)
+        {
+            if (node != nullptr)
+            {
+                insert(node);
+            }
+        }
+    }
+
+    details::Arena arena_;
+    std::vector<Node*> index_;
+    Node* root_ = nullptr;
+    size_t nodeCount_ = 0;
+    size_t size_ = 0;
+};
+
+} // namespace cmd_line_args
+} // namespace over9000
@@ -199,6 +199,12 @@ int main(int argc, const char* argv[]) try
     dump("Positional integer", positionalInteger);
     dump("Optional positional enumerations", optionalPositionalEnumerations);
 
+    // All values at once, e.g. for a startup log
+
+    std::string config;
+    parser.dump(config, over9000::cmd_line_args::DumpFormat::TEXT, true);
+    dump(config);
+
     // E.g. the command line
 
     // cmd-line-args-sample -f --integer 1 --string="A B C" --ascii "a b c" --enum value1 \
@@ -226,6 +232,10 @@ int main(int argc, const char* argv[]) try
     // Positional string: --posStr=OK
     // Positional integer: -7
     // Positional enumerations: [VALUE1, VALUE2]
+    // flag = true (command line)
+    // string = A B C (command line)
+    // ...
+    // optPosEnums = [value1, value2] (command line)
 }
 catch (const over9000::cmd_line_args::Error& e)
 {
@@ -0,0 +1,816 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// Randomized differential stress test: generates random schemas and command lines (including
+// malformed ones) and checks that every parse path produces the same values and errors as a
+// straightforward reference model of the parsing rules:
+// - model: the reference model below
+// - parser: Parser with the default converters, reused across command lines
+// - async: Parser with async() converters on an inline executor
+// Reports parses per second of each path. A failing case is shrunk to a minimal schema and
+// command line, which are printed in the cmd-line-args-generator schema format.
+//
+// Usage: cmd-line-args-stress [seconds] [seed]
+//
+#include "over9000/cmd_line_args/parser.h"
+
+#include "over9000/cmd_line_args/async.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using over9000::cmd_line_args::Char;
+using over9000::cmd_line_args::Error;
+using over9000::cmd_line_args::Parser;
+
+enum class Kind
+{
+    INT,
+    STRING,
+    BOOL,
+    FLAG,
+    INT_LIST,
+    STRING_LIST,
+};
+
+struct SchemaParam
+{
+    Kind kind = Kind::INT;
+    std::string longName;
+    char shortName = '\0';
+    bool optional = false;
+    bool positional = false;
+    size_t positionalIndex = 0; // 0-based like Param::index_
+};
+
+struct Schema
+{
+    std::vector<SchemaParam> params; // named params first, then positional ones
+};
+
+using Args = std::vector<std::string>;
+
+struct Value
+{
+    int i = 0;
+    std::string s;
+    bool b = false;
+    std::vector<int> ints;
+    std::vector<std::string> strings;
+
+    bool operator==(const Value& rhs) const
+    {
+        return i == rhs.i && s == rhs.s && b == rhs.b && ints == rhs.ints &&
+               strings == rhs.strings;
+    }
+};
+
+struct Outcome
+{
+    std::string error;
+    std::vector<Value> values;
+
+    bool operator==(const Outcome& rhs) const
+    {
+        return error == rhs.error && (!error.empty() || values == rhs.values);
+    }
+};
+
+bool isList(Kind kind)
+{
+    return kind == Kind::INT_LIST || kind == Kind::STRING_LIST;
+}
+
+// Reference model
+
+std::string displayName(const SchemaParam& param)
+{
+    std::string name;
+    if (param.positional && param.positionalIndex != 0)
+    {
+        name = "#" + std::to_string(param.positionalIndex) + " ";
+    }
+    else if (param.shortName != '\0')
+    {
+        name = std::string("-") + param.shortName + "/";
+    }
+    return name + "--" + param.longName;
+}
+
+// Stream extraction of an integer: optional leading whitespace and sign, decimal digits, nothing
+// after them and no overflow
+bool toLong(const std::string& text, long& value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+
+    errno = 0;
+    char* end = nullptr;
+    value = std::strtol(text.c_str(), &end, 10);
+    return errno == 0 && end != text.c_str() && end == text.c_str() + text.size() &&
+           (end[-1] >= '0' && end[-1] <= '9');
+}
+
+bool modelConvert(Kind kind, const std::string& text, Value& value)
+{
+    long number = 0;
+    switch (kind)
+    {
+    case Kind::INT:
+    case Kind::INT_LIST:
+        if (!toLong(text, number) || number < INT_MIN || number > INT_MAX)
+        {
+            return false;
+        }
+        if (kind == Kind::INT)
+        {
+            value.i = static_cast<int>(number);
+        }
+        else
+        {
+            value.ints.push_back(static_cast<int>(number));
+        }
+        return true;
+
+    case Kind::BOOL:
+    case Kind::FLAG:
+        if (!toLong(text, number) || (number != 0 && number != 1))
+        {
+            return false;
+        }
+        value.b = number == 1;
+        return true;
+
+    case Kind::STRING:
+    case Kind::STRING_LIST:
+        // std::getline() to the end of the value
+        if (text.empty() || text.find('\n') != std::string::npos)
+        {
+            return false;
+        }
+        if (kind == Kind::STRING)
+        {
+            value.s = text;
+        }
+        else
+        {
+            value.strings.push_back(text);
+        }
+        return true;
+    }
+    return false;
+}
+
+Outcome parseModel(const Schema& schema, const Args& args)
+{
+    Outcome outcome;
+    outcome.values.resize(schema.params.size());
+    std::vector<bool> parsed(schema.params.size());
+    std::vector<size_t> positional;
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        if (schema.params[i].positional)
+        {
+            positional.push_back(i);
+        }
+    }
+
+    auto convert = [&](size_t index, const std::string& text) {
+        const auto& param = schema.params[index];
+        auto& value = outcome.values[index];
+        if (isList(param.kind) && !parsed[index])
+        {
+            value.ints.clear();
+            value.strings.clear();
+        }
+        parsed[index] = true;
+        if (!modelConvert(param.kind, text, value))
+        {
+            throw Error() << (param.positional && param.positionalIndex != 0
+                                  ? "Bad positional argument "
+                                  : "Bad argument ")
+                          << displayName(param) << ": " << text;
+        }
+    };
+
+    auto findLong = [&](const std::string& name) {
+        for (size_t i = 0; i < schema.params.size(); ++i)
+        {
+            if (!schema.params[i].positional && schema.params[i].longName == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    };
+
+    auto findShort = [&](char name) {
+        for (size_t i = 0; i < schema.params.size(); ++i)
+        {
+            if (!schema.params[i].positional && schema.params[i].shortName == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    };
+
+    try
+    {
+        size_t positionalPos = 0;
+        int pending = -1;
+        for (const auto& arg : args)
+        {
+            if (pending >= 0)
+            {
+                convert(static_cast<size_t>(pending), arg);
+                pending = -1;
+                continue;
+            }
+
+            int param = -1;
+            size_t equalPos = std::string::npos;
+            if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-')
+            {
+                equalPos = arg.find('=', 2);
+                param = findLong(arg.substr(2, equalPos - 2));
+            }
+            else if (arg.size() == 2 && arg[0] == '-')
+            {
+                param = findShort(arg[1]);
+            }
+
+            if (param >= 0 &&
+                (!parsed[static_cast<size_t>(param)] ||
+                 isList(schema.params[static_cast<size_t>(param)].kind)))
+            {
+                if (equalPos != std::string::npos)
+                {
+                    convert(static_cast<size_t>(param), arg.substr(equalPos + 1));
+                }
+                else if (schema.params[static_cast<size_t>(param)].kind == Kind::FLAG)
+                {
+                    convert(static_cast<size_t>(param), "1");
+                }
+                else
+                {
+                    pending = param;
+                }
+                continue;
+            }
+
+            if (positionalPos >= positional.size())
+            {
+                if (param >= 0)
+                {
+                    throw Error() << "Repeated argument: "
+                                  << displayName(schema.params[static_cast<size_t>(param)]);
+                }
+                throw Error() << "Unexpected argument: " << arg;
+            }
+
+            convert(positional[positionalPos], arg);
+            if (!isList(schema.params[positional[positionalPos]].kind))
+            {
+                ++positionalPos;
+            }
+        }
+
+        for (size_t i = 0; i < schema.params.size(); ++i)
+        {
+            if (!parsed[i] && !schema.params[i].optional)
+            {
+                throw Error() << (schema.params[i].positional ? "Missing positional argument "
+                                                              : "Missing argument: ")
+                              << displayName(schema.params[i]);
+            }
+        }
+    }
+    catch (const Error& error)
+    {
+        outcome.error = error.what();
+    }
+    return outcome;
+}
+
+// Parser paths
+
+std::basic_string<Char> widen(const std::string& string)
+{
+    return {string.begin(), string.end()};
+}
+
+class ParserPath
+{
+public:
+    ParserPath(const Schema& schema, bool async)
+        : parser_("Stress test"), values_(schema.params.size())
+    {
+        if (async)
+        {
+            parser_.setExecutor([](std::function<void()> task) { task(); });
+        }
+
+        for (size_t i = 0; i < schema.params.size(); ++i)
+        {
+            const auto& param = schema.params[i];
+            auto& value = values_[i];
+            switch (param.kind)
+            {
+            case Kind::INT:
+                add(param, value.i, async);
+                break;
+
+            case Kind::STRING:
+                add(param, value.s, async);
+                break;
+
+            case Kind::BOOL:
+                add(param, value.b, async);
+                break;
+
+            case Kind::FLAG:
+                parser_.addFlag(value.b, param.longName, param.shortName, "Flag");
+                break;
+
+            case Kind::INT_LIST:
+                add(param, value.ints, async);
+                break;
+
+            case Kind::STRING_LIST:
+                add(param, value.strings, async);
+                break;
+            }
+        }
+    }
+
+    Outcome parse(const std::vector<const Char*>& argv)
+    {
+        for (auto& value : values_)
+        {
+            value = Value();
+        }
+
+        Outcome outcome;
+        try
+        {
+            parser_.parse(static_cast<int>(argv.size()), argv.data());
+        }
+        catch (const Error& error)
+        {
+            outcome.error = error.what();
+        }
+        outcome.values = values_;
+        return outcome;
+    }
+
+private:
+    template<class T>
+    void add(const SchemaParam& param, T& value, bool async)
+    {
+        auto type = param.optional ? over9000::cmd_line_args::OPTIONAL
+                                   : over9000::cmd_line_args::REQUIRED;
+        if (param.positional && async)
+        {
+            parser_.addPositional(value, param.longName, "Positional",
+                                  over9000::cmd_line_args::async(), type);
+        }
+        else if (param.positional)
+        {
+            parser_.addPositional(value, param.longName, "Positional", type);
+        }
+        else if (async)
+        {
+            parser_.addParam(value, param.longName, param.shortName, "Named",
+                             over9000::cmd_line_args::async(), type);
+        }
+        else
+        {
+            parser_.addParam(value, param.longName, param.shortName, "Named", type);
+        }
+    }
+
+    Parser parser_;
+    std::vector<Value> values_;
+};
+
+// Random generation
+
+const char* const LONG_NAMES[] = {"ab", "abc", "num", "name", "list", "flag", "x1", "nn"};
+const char SHORT_NAMES[] = {'a', 'b', 'n', 'x', 'f', 'l'};
+
+Schema randomSchema(std::mt19937& rng)
+{
+    auto chance = [&](int percent) {
+        return std::uniform_int_distribution<int>(0, 99)(rng) < percent;
+    };
+
+    Schema schema;
+    std::vector<std::string> longNames(std::begin(LONG_NAMES), std::end(LONG_NAMES));
+    std::vector<char> shortNames(std::begin(SHORT_NAMES), std::end(SHORT_NAMES));
+    std::shuffle(longNames.begin(), longNames.end(), rng);
+    std::shuffle(shortNames.begin(), shortNames.end(), rng);
+
+    auto namedCount = std::uniform_int_distribution<size_t>(0, 6)(rng);
+    for (size_t i = 0; i < namedCount; ++i)
+    {
+        SchemaParam param;
+        param.kind = static_cast<Kind>(std::uniform_int_distribution<int>(0, 5)(rng));
+        param.longName = longNames[i];
+        param.shortName = chance(60) ? shortNames[i] : '\0';
+        param.optional = param.kind == Kind::FLAG || chance(60);
+        schema.params.push_back(param);
+    }
+
+    // Required single value positionals, the last one may be optional or a list
+    auto positionalCount = std::uniform_int_distribution<size_t>(0, 3)(rng);
+    for (size_t i = 0; i < positionalCount; ++i)
+    {
+        bool last = i + 1 == positionalCount;
+        SchemaParam param;
+        param.positional = true;
+        param.positionalIndex = i;
+        param.longName = "pos" + std::to_string(i);
+        int kind = std::uniform_int_distribution<int>(0, last ? 3 : 1)(rng);
+        param.kind = kind == 0 ? Kind::INT
+                               : (kind == 1 ? Kind::STRING
+                                            : (kind == 2 ? Kind::INT_LIST : Kind::STRING_LIST));
+        param.optional = last && chance(50);
+        schema.params.push_back(param);
+    }
+    return schema;
+}
+
+std::string randomValue(std::mt19937& rng)
+{
+    static const char* const VALUES[] = {
+        "0",  "1",   "2",    "-1", "-42", "+3",  " 7", "7 ",  "007", "99999999999",
+        "",   "abc", "x y",  "a\nb", "-",  "--", "--=", "-x", "=",   "1e3",
+    };
+    if (std::uniform_int_distribution<int>(0, 3)(rng) == 0)
+    {
+        return std::to_string(std::uniform_int_distribution<int>(-1000, 1000)(rng));
+    }
+    auto count = sizeof(VALUES) / sizeof(VALUES[0]);
+    return VALUES[std::uniform_int_distribution<size_t>(0, count - 1)(rng)];
+}
+
+std::string validValue(std::mt19937& rng, Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::BOOL:
+    case Kind::FLAG:
+        return std::uniform_int_distribution<int>(0, 1)(rng) == 0 ? "0" : "1";
+
+    case Kind::STRING:
+    case Kind::STRING_LIST:
+        return std::uniform_int_distribution<int>(0, 1)(rng) == 0 ? "value" : "-v";
+
+    default:
+        return std::to_string(std::uniform_int_distribution<int>(-1000, 1000)(rng));
+    }
+}
+
+// A mostly well-formed command line giving the parameters in a random order
+Args wellFormedArgs(std::mt19937& rng, const Schema& schema)
+{
+    std::vector<Args> named;
+    Args positional;
+    for (const auto& param : schema.params)
+    {
+        int minCount = param.optional ? 0 : 1;
+        int count = std::uniform_int_distribution<int>(minCount, isList(param.kind) ? 3 : 1)(rng);
+        for (int i = 0; i < count; ++i)
+        {
+            auto value = validValue(rng, param.kind);
+            if (param.positional)
+            {
+                positional.push_back(value);
+            }
+            else if (param.kind == Kind::FLAG)
+            {
+                named.push_back({param.shortName != '\0' && value == "1"
+                                     ? std::string("-") + param.shortName
+                                     : "--" + param.longName + "=" + value});
+            }
+            else if (param.shortName != '\0' && std::uniform_int_distribution<int>(0, 1)(rng))
+            {
+                named.push_back({std::string("-") + param.shortName, value});
+            }
+            else
+            {
+                named.push_back({"--" + param.longName + "=" + value});
+            }
+        }
+    }
+
+    std::shuffle(named.begin(), named.end(), rng);
+    Args args;
+    for (const auto& arg : named)
+    {
+        args.insert(args.end(), arg.begin(), arg.end());
+    }
+
+    // Named arguments may be interleaved with positional ones
+    for (const auto& arg : positional)
+    {
+        auto pos = std::uniform_int_distribution<size_t>(0, args.size())(rng);
+        while (pos < args.size() && pos > 0 && args[pos - 1].size() == 2 &&
+               args[pos - 1][0] == '-')
+        {
+            ++pos;
+        }
+        args.insert(args.begin() + static_cast<std::ptrdiff_t>(pos), arg);
+    }
+
+    if (std::uniform_int_distribution<int>(0, 3)(rng) == 0 && !args.empty())
+    {
+        args[std::uniform_int_distribution<size_t>(0, args.size() - 1)(rng)] = randomValue(rng);
+    }
+    return args;
+}
+
+Args randomArgs(std::mt19937& rng, const Schema& schema)
+{
+    if (std::uniform_int_distribution<int>(0, 1)(rng) == 0)
+    {
+        return wellFormedArgs(rng, schema);
+    }
+
+    Args args;
+    auto count = std::uniform_int_distribution<size_t>(0, 10)(rng);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string name =
+            schema.params.empty() || std::uniform_int_distribution<int>(0, 4)(rng) == 0
+                ? LONG_NAMES[std::uniform_int_distribution<size_t>(0, 7)(rng)]
+                : schema.params[std::uniform_int_distribution<size_t>(
+                                    0, schema.params.size() - 1)(rng)]
+                      .longName;
+        char shortName = SHORT_NAMES[std::uniform_int_distribution<size_t>(0, 5)(rng)];
+
+        switch (std::uniform_int_distribution<int>(0, 4)(rng))
+        {
+        case 0:
+            args.push_back("--" + name);
+            break;
+
+        case 1:
+            args.push_back(std::string("-") + shortName);
+            break;
+
+        case 2:
+            args.push_back("--" + name + "=" + randomValue(rng));
+            break;
+
+        default:
+            args.push_back(randomValue(rng));
+        }
+    }
+    return args;
+}
+
+// Checking
+
+struct Stats
+{
+    const char* name;
+    size_t parses = 0;
+    size_t errors = 0;
+    double seconds = 0;
+};
+
+struct Mismatch
+{
+    Outcome expected;
+    Outcome actual;
+    const char* path = nullptr;
+};
+
+template<class F>
+Outcome timed(Stats& stats, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto outcome = f();
+    stats.seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++stats.parses;
+    stats.errors += outcome.error.empty() ? 0 : 1;
+    return outcome;
+}
+
+std::vector<const Char*> makeArgv(const std::vector<std::basic_string<Char>>& args)
+{
+    static const Char exe[] = {'s', 't', 'r', 'e', 's', 's', '\0'};
+    std::vector<const Char*> argv{exe};
+    for (const auto& arg : args)
+    {
+        argv.push_back(arg.c_str());
+    }
+    return argv;
+}
+
+// Checks command lines against a schema, returns false and fills the mismatch on the first
+// difference
+bool check(const Schema& schema, const std::vector<Args>& commandLines, std::vector<Stats>& stats,
+           Mismatch& mismatch, size_t& failedLine)
+{
+    ParserPath parser(schema, false);
+    ParserPath async(schema, true);
+
+    for (size_t i = 0; i < commandLines.size(); ++i)
+    {
+        const auto& args = commandLines[i];
+        std::vector<std::basic_string<Char>> wideArgs;
+        for (const auto& arg : args)
+        {
+            wideArgs.push_back(widen(arg));
+        }
+        auto argv = makeArgv(wideArgs);
+
+        auto expected = timed(stats[0], [&] { return parseModel(schema, args); });
+        auto parserOutcome = timed(stats[1], [&] { return parser.parse(argv); });
+        auto asyncOutcome = timed(stats[2], [&] { return async.parse(argv); });
+
+        for (auto* path : {&parserOutcome, &asyncOutcome})
+        {
+            if (!(*path == expected))
+            {
+                mismatch.expected = expected;
+                mismatch.actual = *path;
+                mismatch.path = path == &parserOutcome ? "parser" : "async";
+                failedLine = i;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool fails(const Schema& schema, const Args& args)
+{
+    std::vector<Stats> stats(3);
+    Mismatch mismatch;
+    size_t failedLine = 0;
+    return !check(schema, {args}, stats, mismatch, failedLine);
+}
+
+// Greedily removes arguments and parameters while the case still fails
+void shrink(Schema& schema, Args& args)
+{
+    for (bool shrunk = true; shrunk;)
+    {
+        shrunk = false;
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            Args smaller = args;
+            smaller.erase(smaller.begin() + static_cast<std::ptrdiff_t>(i));
+            if (fails(schema, smaller))
+            {
+                args = smaller;
+                shrunk = true;
+                --i;
+            }
+        }
+
+        for (size_t i = 0; i < schema.params.size(); ++i)
+        {
+            Schema smaller = schema;
+            smaller.params.erase(smaller.params.begin() + static_cast<std::ptrdiff_t>(i));
+            size_t positionalIndex = 0;
+            for (auto& param : smaller.params)
+            {
+                if (param.positional)
+                {
+                    param.positionalIndex = positionalIndex++;
+                }
+            }
+
+            if (fails(smaller, args))
+            {
+                schema = smaller;
+                shrunk = true;
+                --i;
+            }
+        }
+    }
+}
+
+std::string quote(const std::string& string)
+{
+    std::string result = "\"";
+    for (char c : string)
+    {
+        result += c == '\n' ? std::string("\\n") : std::string(c == '"' ? "\\\"" : "") + c;
+    }
+    return result + "\"";
+}
+
+void printCase(const Schema& schema, const Args& args, const Mismatch& mismatch)
+{
+    static const char* const TYPES[] = {"int", "string", "bool", "bool", "int[]", "string[]"};
+
+    std::printf("Schema:\n");
+    for (const auto& param : schema.params)
+    {
+        auto type = TYPES[static_cast<int>(param.kind)];
+        if (param.positional)
+        {
+            std::printf("  positional %s %s \"\"%s\n", type, param.longName.c_str(),
+                        param.optional ? " optional" : "");
+        }
+        else if (param.kind == Kind::FLAG)
+        {
+            std::printf("  flag %s%s%c \"\"\n", param.longName.c_str(),
+                        param.shortName != '\0' ? " -" : "", param.shortName);
+        }
+        else
+        {
+            std::printf("  param %s %s%s%c \"\"%s\n", type, param.longName.c_str(),
+                        param.shortName != '\0' ? " -" : "", param.shortName,
+                        param.optional ? " optional" : "");
+        }
+    }
+
+    std::printf("Command line:");
+    for (const auto& arg : args)
+    {
+        std::printf(" %s", quote(arg).c_str());
+    }
+
+    std::printf("\nModel: %s\n%s: %s\n",
+                mismatch.expected.error.empty() ? "ok" : mismatch.expected.error.c_str(),
+                mismatch.path,
+                mismatch.actual.error.empty() ? "ok" : mismatch.actual.error.c_str());
+    if (mismatch.expected.error.empty() && mismatch.actual.error.empty())
+    {
+        std::printf("Values differ\n");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double budget = argc > 1 ? std::strtod(argv[1], nullptr) : 10;
+    auto seed = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10))
+                         : std::random_device()();
+    std::printf("Seed %u, %.1f s\n", seed, budget);
+
+    std::mt19937 rng(seed);
+    std::vector<Stats> stats{{"model"}, {"parser"}, {"async"}};
+    size_t schemas = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() <
+           budget)
+    {
+        auto schema = randomSchema(rng);
+        std::vector<Args> commandLines;
+        for (int i = 0; i < 64; ++i)
+        {
+            commandLines.push_back(randomArgs(rng, schema));
+        }
+
+        Mismatch mismatch;
+        size_t failedLine = 0;
+        if (!check(schema, commandLines, stats, mismatch, failedLine))
+        {
+            auto args = commandLines[failedLine];
+            shrink(schema, args);
+
+            std::vector<Stats> shrinkStats(3);
+            check(schema, {args}, shrinkStats, mismatch, failedLine);
+            printCase(schema, args, mismatch);
+            return 1;
+        }
+
+        ++schemas;
+    }
+
+    std::printf("%zu schemas, %zu command lines, %zu errors\n", schemas, stats[0].parses,
+                stats[0].errors);
+    for (const auto& path : stats)
+    {
+        std::printf("%-8s %12.0f parses/s\n", path.name,
+                    path.seconds > 0 ? path.parses / path.seconds : 0.0);
+    }
+    return 0;
+}
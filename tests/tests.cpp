@@ -5,16 +5,174 @@
 //
 #include "over9000/cmd_line_args/parser.h"
 
+#include "over9000/cmd_line_args/async.h"
+#include "over9000/cmd_line_args/bytes.h"
+#include "over9000/cmd_line_args/chrono.h"
+#include "over9000/cmd_line_args/column.h"
+#include "over9000/cmd_line_args/corpus.h"
+#include "over9000/cmd_line_args/early.h"
+#include "over9000/cmd_line_args/fields.h"
+#include "over9000/cmd_line_args/file.h"
+#include "over9000/cmd_line_args/json.h"
+#include "over9000/cmd_line_args/latency.h"
+#include "over9000/cmd_line_args/pattern.h"
+#include "over9000/cmd_line_args/set.h"
+#include "over9000/cmd_line_args/small_vector.h"
+#include "over9000/cmd_line_args/tree.h"
+
+#include "generated_parser.h"
 #include "gtest/gtest.h"
+#include "positional_first.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <clocale>
 #include <codecvt>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
 #include <locale>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif // _WIN32
 
 namespace {
 
+using over9000::cmd_line_args::async;
+using over9000::cmd_line_args::base64;
+using over9000::cmd_line_args::bytes;
+using over9000::cmd_line_args::CorpusWriter;
+using over9000::cmd_line_args::date;
+using over9000::cmd_line_args::Diagnostic;
+using over9000::cmd_line_args::DiagnosticKind;
+using over9000::cmd_line_args::DumpFormat;
+using over9000::cmd_line_args::EarlyOptions;
 using over9000::cmd_line_args::Error;
+using over9000::cmd_line_args::field;
+using over9000::cmd_line_args::fields;
+using over9000::cmd_line_args::flagField;
+using over9000::cmd_line_args::fromFile;
+using over9000::cmd_line_args::HashSet;
+using over9000::cmd_line_args::hex;
+using over9000::cmd_line_args::IntegerSet;
+using over9000::cmd_line_args::json;
+using over9000::cmd_line_args::jsonField;
+using over9000::cmd_line_args::jsonFields;
+using over9000::cmd_line_args::JsonKind;
+using over9000::cmd_line_args::JsonTape;
+using over9000::cmd_line_args::LatencyHistogram;
+using over9000::cmd_line_args::Limits;
+using over9000::cmd_line_args::matching;
 using over9000::cmd_line_args::OPTIONAL;
+using over9000::cmd_line_args::OptionTree;
+using over9000::cmd_line_args::ParseOutcome;
 using over9000::cmd_line_args::Parser;
+using over9000::cmd_line_args::positionalField;
+using over9000::cmd_line_args::readCorpus;
+using over9000::cmd_line_args::SmallVector;
+using over9000::cmd_line_args::StaticVector;
+using over9000::cmd_line_args::StringColumn;
+using over9000::cmd_line_args::timeOfDay;
+using over9000::cmd_line_args::timestamp;
+
+// Temporary directory removed with its files on destruction, also when a test fails
+class TempDir
+{
+public:
+    TempDir()
+    {
+#ifdef _WIN32
+        std::unique_ptr<char, decltype(&std::free)> name(_tempnam(nullptr, "cmd_line_args"),
+                                                         &std::free);
+        if (name == nullptr || _mkdir(name.get()) != 0)
+        {
+            throw std::runtime_error("Cannot create a temporary directory");
+        }
+        path_ = name.get();
+#else
+        const char* tmp = std::getenv("TMPDIR");
+        path_ = std::string(tmp != nullptr && *tmp != '\0' ? tmp : "/tmp") +
+                "/cmd_line_args_tests.XXXXXX";
+        if (mkdtemp(&path_[0]) == nullptr)
+        {
+            throw std::runtime_error("Cannot create a temporary directory");
+        }
+#endif // _WIN32
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    ~TempDir()
+    {
+        for (const auto& file : files_)
+        {
+            std::remove(file.c_str());
+        }
+#ifdef _WIN32
+        _rmdir(path_.c_str());
+#else
+        rmdir(path_.c_str());
+#endif // _WIN32
+    }
+
+    // Returns the path of a file in the directory, the file is removed with it
+    std::string file(const std::string& name)
+    {
+        files_.push_back(path_ + "/" + name);
+        return files_.back();
+    }
+
+private:
+    std::string path_;
+    std::vector<std::string> files_;
+};
+
+// Switches the global C++ locale to one with a decimal comma, and the C one as well if such a
+// locale is installed
+class CommaLocale
+{
+public:
+    CommaLocale()
+        : previous_(std::locale::global(std::locale(
+              std::locale(std::locale::classic(), new Numpunct<char>), new Numpunct<wchar_t>)))
+        , previousC_(std::setlocale(LC_NUMERIC, nullptr))
+    {
+        for (const char* name : {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "German"})
+        {
+            if (std::setlocale(LC_NUMERIC, name) != nullptr)
+            {
+                break;
+            }
+        }
+    }
+
+    ~CommaLocale()
+    {
+        std::locale::global(previous_);
+        std::setlocale(LC_NUMERIC, previousC_.c_str());
+    }
+
+private:
+    template<class C>
+    struct Numpunct : std::numpunct<C>
+    {
+        C do_decimal_point() const override { return ','; }
+    };
+
+    std::locale previous_;
+    std::string previousC_;
+};
 
 struct Tests : testing::Test
 {
@@ -23,6 +181,12 @@ struct Tests : testing::Test
     Tests() : parser("Description") {}
 
     void parse(const std::vector<const char*>& args)
+    {
+        parse(parser, args);
+    }
+
+    template<class P>
+    static void parse(P& parser, const std::vector<const char*>& args)
     {
 #ifdef _WIN32
         std::vector<std::wstring> wstrings;
@@ -40,6 +204,49 @@ struct Tests : testing::Test
         parser.parse(static_cast<int>(args.size()), args.data());
 #endif
     }
+
+    // The arguments are kept for Parser::parseRemaining()
+    void parseKnown(const std::vector<const char*>& args)
+    {
+#ifdef _WIN32
+        knownStrings.clear();
+        knownStrings.reserve(args.size());
+        knownArgs.clear();
+        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        for (auto* arg : args)
+        {
+            knownStrings.push_back(converter.from_bytes(arg));
+            knownArgs.push_back(knownStrings.back().c_str());
+        }
+        parser.parseKnown(static_cast<int>(knownArgs.size()), knownArgs.data());
+#else
+        parser.parseKnown(static_cast<int>(args.size()), args.data());
+#endif
+    }
+
+    // The arguments are kept for the diagnostics
+    std::vector<Diagnostic> parseAll(const std::vector<const char*>& args)
+    {
+#ifdef _WIN32
+        knownStrings.clear();
+        knownStrings.reserve(args.size());
+        knownArgs.clear();
+        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        for (auto* arg : args)
+        {
+            knownStrings.push_back(converter.from_bytes(arg));
+            knownArgs.push_back(knownStrings.back().c_str());
+        }
+        return parser.parseAll(static_cast<int>(knownArgs.size()), knownArgs.data());
+#else
+        return parser.parseAll(static_cast<int>(args.size()), args.data());
+#endif
+    }
+
+#ifdef _WIN32
+    std::vector<std::wstring> knownStrings;
+    std::vector<const wchar_t*> knownArgs;
+#endif
 };
 
 TEST_F(Tests, stringParams)
@@ -444,4 +651,1717 @@ TEST_F(Tests, anyPositionalAfterPositionalListThrows)
     ASSERT_THROW(parser.addPositional(list1, "list2", "List 2", OPTIONAL), Error);
 }
 
+TEST_F(Tests, hexParams)
+{
+    std::vector<uint8_t> blob;
+    parser.addParam(blob, "blob", "Blob", hex());
+
+    std::array<uint8_t, 4> key{};
+    parser.addParam(key, "key", 'k', "Key", hex());
+
+    std::vector<std::array<uint8_t, 16>> hashes;
+    parser.addParam(hashes, "hashes", "Hashes", hex(), OPTIONAL);
+
+    parse({"exe", "--blob=", "-k", "DEADbeef", "--hashes", "00112233445566778899aabbccddeeff",
+           "--hashes=ffeeddccbbaa99887766554433221100"});
+
+    ASSERT_TRUE(blob.empty());
+    ASSERT_EQ((std::array<uint8_t, 4>{0xde, 0xad, 0xbe, 0xef}), key);
+    ASSERT_EQ(2u, hashes.size());
+    ASSERT_EQ(0x00, hashes[0][0]);
+    ASSERT_EQ(0xff, hashes[0][15]);
+    ASSERT_EQ(0xff, hashes[1][0]);
+    ASSERT_EQ(0x00, hashes[1][15]);
+
+    parse({"exe", "--blob", "0123456789abcdefABCDEF0123456789a0", "--key=00000001"});
+
+    ASSERT_EQ((std::vector<uint8_t>{0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xab, 0xcd,
+                                    0xef, 0x01, 0x23, 0x45, 0x67, 0x89, 0xa0}),
+              blob);
+    ASSERT_EQ((std::array<uint8_t, 4>{0, 0, 0, 1}), key);
+
+    ASSERT_THROW(parse({"exe", "--blob=abc", "--key=00000001"}), Error);
+    ASSERT_THROW(parse({"exe", "--blob=0123456789abcdefABCDEF012345678g", "--key=00000001"}),
+                 Error);
+    ASSERT_THROW(parse({"exe", "--blob=", "--key=0000000g"}), Error);
+    ASSERT_THROW(parse({"exe", "--blob=", "--key=0000000001"}), Error);
+}
+
+TEST_F(Tests, base64Params)
+{
+    std::vector<uint8_t> blob;
+    parser.addParam(blob, "blob", "Blob", base64());
+
+    std::array<uint8_t, 5> key{};
+    parser.addPositional(key, "key", "Key", base64());
+
+    parse({"exe", "--blob=TWFu", "aGVsbG8="});
+
+    ASSERT_EQ((std::vector<uint8_t>{'M', 'a', 'n'}), blob);
+    ASSERT_EQ((std::array<uint8_t, 5>{'h', 'e', 'l', 'l', 'o'}), key);
+
+    parse({"exe", "--blob=TWE=", "aGVsbG8"});
+
+    ASSERT_EQ((std::vector<uint8_t>{'M', 'a'}), blob);
+
+    parse({"exe", "--blob=TQ==", "+/+/+/8"});
+
+    ASSERT_EQ((std::vector<uint8_t>{'M'}), blob);
+    ASSERT_EQ((std::array<uint8_t, 5>{0xfb, 0xff, 0xbf, 0xfb, 0xff}), key);
+
+    ASSERT_THROW(parse({"exe", "--blob=TWF", "aGVsbG8="}), Error);
+    ASSERT_THROW(parse({"exe", "--blob=TR==", "aGVsbG8="}), Error);
+    ASSERT_THROW(parse({"exe", "--blob=T", "aGVsbG8="}), Error);
+    ASSERT_THROW(parse({"exe", "--blob=TW-u", "aGVsbG8="}), Error);
+    ASSERT_THROW(parse({"exe", "--blob=TWFu", "aGVsbA=="}), Error);
+}
+
+TEST_F(Tests, prefixedBytesParams)
+{
+    std::vector<std::vector<uint8_t>> blobs;
+    parser.addParam(blobs, "blob", "Blobs", bytes());
+
+    parse({"exe", "--blob=hex:4d61", "--blob", "b64:TWE="});
+
+    ASSERT_EQ(2u, blobs.size());
+    ASSERT_EQ((std::vector<uint8_t>{'M', 'a'}), blobs[0]);
+    ASSERT_EQ((std::vector<uint8_t>{'M', 'a'}), blobs[1]);
+
+    ASSERT_THROW(parse({"exe", "--blob=4d61"}), Error);
+}
+
+TEST_F(Tests, asyncParams)
+{
+    std::string s;
+    parser.addParam(s, "string", 's', "String", async());
+
+    std::vector<int> ints;
+    parser.addParam(ints, "int", 'i', "Integers", async());
+
+    int positional = 0;
+    parser.addPositional(positional, "positional", "Positional", async(), OPTIONAL);
+
+    parse({"exe", "-i", "1", "--string=a b c", "--int=2", "-i", "3", "4"});
+
+    ASSERT_EQ("a b c", s);
+    ASSERT_EQ((std::vector<int>{1, 2, 3}), ints);
+    ASSERT_EQ(4, positional);
+
+    std::atomic<int> executed{0};
+    parser.setExecutor([&](std::function<void()> task) {
+        ++executed;
+        task();
+    });
+
+    parse({"exe", "-s", "b", "-i", "5"});
+
+    ASSERT_EQ("b", s);
+    ASSERT_EQ((std::vector<int>{5}), ints);
+    ASSERT_EQ(2, executed);
+
+    ASSERT_THROW(parse({"exe", "-s", "b", "-i", "x"}), Error);
+    ASSERT_THROW(parse({"exe", "-s", "b", "-i", "1", "x"}), Error);
+    ASSERT_THROW(parse({"exe", "-i", "1"}), Error);
+
+    // Conversions queued to an executor that never runs them are not waited for
+    std::vector<std::function<void()>> queued;
+    {
+        Parser queueParser("Description");
+        std::vector<int> queuedInts;
+        queueParser.addParam(queuedInts, "int", 'i', "Integers", async());
+        bool first = true;
+        queueParser.setExecutor([&](std::function<void()> task) {
+            if (first)
+            {
+                first = false;
+                task();
+                return;
+            }
+            queued.push_back(std::move(task));
+        });
+        ASSERT_THROW(parse(queueParser, {"exe", "-i", "x", "-i", "1", "-i", "2"}), Error);
+    }
+    ASSERT_EQ(2u, queued.size());
+    for (auto& task : queued)
+    {
+        task();
+    }
+
+    // More conversions than threads
+    std::vector<std::string> strings(1000, "7");
+    std::vector<const char*> args{"exe", "-s", "a"};
+    for (const auto& string : strings)
+    {
+        args.push_back("-i");
+        args.push_back(string.c_str());
+    }
+    parser.setExecutor(nullptr);
+    parse(args);
+    ASSERT_EQ(1000u, ints.size());
+}
+
+TEST_F(Tests, asyncErrorsInArgumentOrder)
+{
+    std::vector<int> async1;
+    parser.addParam(async1, "async1", "Async 1", async(), OPTIONAL);
+
+    int async2 = 0;
+    parser.addParam(async2, "async2", "Async 2", async(), OPTIONAL);
+
+    int sync = 0;
+    parser.addParam(sync, "sync", "Sync", OPTIONAL);
+
+    auto message = [&](const std::vector<const char*>& args) {
+        try
+        {
+            parse(args);
+        }
+        catch (const Error& e)
+        {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    ASSERT_EQ("Bad argument --async1: a",
+              message({"exe", "--async1=1", "--async1=a", "--async2=b", "--sync=c"}));
+    ASSERT_EQ("Bad argument --async2: b", message({"exe", "--async2=b", "--sync=c"}));
+    ASSERT_EQ("Bad argument --sync: c", message({"exe", "--async2=1", "--sync=c", "--async1=a"}));
+    ASSERT_EQ("Bad argument --async2: b", message({"exe", "--async2=b", "--unknown"}));
+}
+
+TEST_F(Tests, argumentKinds)
+{
+    std::string s;
+    parser.addParam(s, "string", 's', "String", OPTIONAL);
+
+    bool f = false;
+    parser.addFlag(f, "flag", 'f', "Flag");
+
+    std::vector<std::string> positional;
+    parser.addPositional(positional, "positional", "Positional", OPTIONAL);
+
+    parse({"exe", "--string=a=b", "--flag=0", "-", "--", "-x", "--=", "--unknown=1", "="});
+
+    ASSERT_EQ("a=b", s);
+    ASSERT_FALSE(f);
+    ASSERT_EQ((std::vector<std::string>{"-", "--", "-x", "--=", "--unknown=1", "="}), positional);
+
+    parse({"exe", "-f", "-s", "-f", "--string", "x"});
+
+    ASSERT_EQ("-f", s);
+    ASSERT_TRUE(f);
+    ASSERT_EQ((std::vector<std::string>{"--string", "x"}), positional);
+
+    ASSERT_THROW(parse({"exe", "-s", "a", nullptr}), Error);
+}
+
+TEST_F(Tests, limits)
+{
+    Enum e = Enum::VALUE0;
+    parser.addParam(e, "enum", "Enum",
+                    {
+                        {"value1", Enum::VALUE1},
+                        {"value2", Enum::VALUE2},
+                    },
+                    OPTIONAL);
+
+    Limits limits;
+    limits.maxArgLength = 14;
+    limits.maxTotalLength = 27;
+    limits.maxErrorLength = 4;
+    parser.setLimits(limits);
+
+    parse({"exe", "--enum=value1"});
+
+    ASSERT_EQ(Enum::VALUE1, e);
+
+    parse({"exe", "--enum", "value2"});
+
+    ASSERT_EQ(Enum::VALUE2, e);
+
+    ASSERT_THROW(parse({"exe", "--enum=value1xx"}), Error);
+    ASSERT_THROW(parse({"exe", "--enum=value1", "--enum=value2"}), Error);
+
+    try
+    {
+        parse({"exe", "--enum", "value3"});
+        FAIL();
+    }
+    catch (const Error& error)
+    {
+        ASSERT_EQ(std::string("Bad argument --enum: valu.... Valid values: valu..."),
+                  error.what());
+    }
+
+    // Only the truncated valid values are built
+    struct ValidValues
+    {
+        bool operator()(const over9000::cmd_line_args::Char*,
+                        const over9000::cmd_line_args::Char*, int&) const
+        {
+            return false;
+        }
+
+        std::string getValidValues() const { return std::string(1000000, 'x'); }
+
+        std::string getValidValues(size_t maxLength) const
+        {
+            return std::string(maxLength, 'y') + "...";
+        }
+    };
+
+    int validValues = 0;
+    parser.addParam(validValues, "valid", "Valid values", ValidValues(), OPTIONAL);
+    try
+    {
+        parse({"exe", "--valid=1"});
+        FAIL();
+    }
+    catch (const Error& error)
+    {
+        ASSERT_EQ(std::string("Bad argument --valid: 1. Valid values: yyyy..."), error.what());
+    }
+
+    try
+    {
+        parse({"exe", "unknown"});
+        FAIL();
+    }
+    catch (const Error& error)
+    {
+        ASSERT_EQ(std::string("Unexpected argument: unkn..."), error.what());
+    }
+}
+
+TEST_F(Tests, generatedParser)
+{
+    struct Values
+    {
+        std::string s;
+        int i = 0;
+        unsigned u = 0;
+        long l = 0;
+        double d = 0;
+        std::vector<int> n;
+        bool b = false;
+        bool f = false;
+        std::string input;
+        int count = 0;
+        std::vector<std::string> rest;
+
+        bool operator==(const Values& rhs) const
+        {
+            return s == rhs.s && i == rhs.i && u == rhs.u && l == rhs.l && d == rhs.d &&
+                   n == rhs.n && b == rhs.b && f == rhs.f && input == rhs.input &&
+                   count == rhs.count && rest == rhs.rest;
+        }
+    };
+
+    Values runtime;
+    Parser runtimeParser("Generated parser test");
+    runtimeParser.addParam(runtime.s, "string", 's', "String");
+    runtimeParser.addParam(runtime.i, "int", 'i', "Int", OPTIONAL);
+    runtimeParser.addParam(runtime.u, "unsigned", "Unsigned", OPTIONAL);
+    runtimeParser.addParam(runtime.l, "long", "Long", OPTIONAL);
+    runtimeParser.addParam(runtime.d, "double", 'd', "Double", OPTIONAL);
+    runtimeParser.addParam(runtime.n, "ints", 'n', "Int list", OPTIONAL);
+    runtimeParser.addParam(runtime.b, "bool", "Bool", OPTIONAL);
+    runtimeParser.addFlag(runtime.f, "flag", 'f', "Flag");
+    runtimeParser.addPositional(runtime.input, "input", "Input");
+    runtimeParser.addPositional(runtime.count, "count", "Count");
+    runtimeParser.addPositional(runtime.rest, "rest", "Rest", OPTIONAL);
+
+    Values generated;
+    GeneratedParser generatedParser(generated.s, generated.i, generated.u, generated.l,
+                                    generated.d, generated.n, generated.b, generated.f,
+                                    generated.input, generated.count, generated.rest);
+
+    const std::vector<std::vector<const char*>> commandLines = {
+        {"exe", "-s", "a", "in", "0"},
+        {"exe", "--string=a=b", "in", "5", "x", "y"},
+        {"exe", "-s", "a", "-i", "-7", "--unsigned", "7", "--long=-1", "-d", "0.5", "in", "1"},
+        {"exe", "-n", "1", "--ints=2", "-n", "3", "-s", "a", "in", "2", "-n"},
+        {"exe", "--bool", "1", "-f", "-s", "a", "-s", "b", "--flag", "--", "-"},
+        {"exe", "--flag=0", "--string", "-f", "in", "1", "--unknown=1"},
+        {"exe", "--strin", "a"},
+        {"exe", "-s", "a", "in"},
+        {"exe", "in", "1"},
+        {"exe", "-s", "a", "-i", "x", "in", "1"},
+        {"exe", "-s", "a", "in", "x"},
+        {"exe", "-s", "a", "-n", "1", "-n", "x", "in", "1"},
+        {"exe", "-s", "a", "in", "1", "--unsigned"},
+    };
+    for (const auto& args : commandLines)
+    {
+        std::string runtimeError;
+        try
+        {
+            parse(runtimeParser, args);
+        }
+        catch (const Error& error)
+        {
+            runtimeError = error.what();
+        }
+
+        std::string generatedError;
+        try
+        {
+            parse(generatedParser, args);
+        }
+        catch (const Error& error)
+        {
+            generatedError = error.what();
+        }
+
+        ASSERT_EQ(runtimeError, generatedError);
+        if (runtimeError.empty())
+        {
+            ASSERT_TRUE(runtime == generated);
+        }
+    }
+
+    std::basic_ostringstream<over9000::cmd_line_args::Char> runtimeHelp;
+    runtimeParser.printHelp(runtimeHelp);
+
+    std::basic_ostringstream<over9000::cmd_line_args::Char> generatedHelp;
+    generatedParser.printHelp(generatedHelp);
+
+    ASSERT_EQ(runtimeHelp.str(), generatedHelp.str());
+}
+
+TEST_F(Tests, treeParams)
+{
+    OptionTree tree;
+    parser.addTree(tree, "db.pool.size", "Pool size", OPTIONAL);
+    parser.addTree(tree, "db.replicas.*.host", "Replica host", OPTIONAL);
+    parser.addTree(tree, "cache.**", "Cache options", OPTIONAL);
+
+    int n = 0;
+    parser.addParam(n, "db.n", "Int", OPTIONAL);
+
+    std::vector<std::string> positional;
+    parser.addPositional(positional, "positional", "Positional", OPTIONAL);
+
+    tree.set("db.pool.size", std::basic_string<over9000::cmd_line_args::Char>(1, '8'));
+
+    parse({"exe", "--db.replicas.0.host=a", "--db.replicas.1.host", "b", "--cache.ttl=5",
+           "--cache.l2.size=1", "--db.n=3", "--db.replicas.0.host=c", "--db.replicas.0.port=1",
+           "--db.replicas..host=x", "--cache", "--cache.x.=1"});
+
+    ASSERT_EQ(3, n);
+    ASSERT_EQ((std::vector<std::string>{"--db.replicas.0.port=1", "--db.replicas..host=x",
+                                        "--cache", "--cache.x.=1"}),
+              positional);
+
+    ASSERT_EQ(5u, tree.size());
+
+    int size = 0;
+    ASSERT_TRUE(tree.get("db.pool.size", size));
+    ASSERT_EQ(8, size);
+
+    std::string host;
+    ASSERT_TRUE(tree.get("db.replicas.0.host", host));
+    ASSERT_EQ("c", host);
+    ASSERT_FALSE(tree.get("db.replicas.0", host));
+    ASSERT_EQ(nullptr, tree.find("db.replicas.2"));
+    ASSERT_EQ(nullptr, tree.find("db."));
+
+    std::vector<std::string> keys;
+    tree.forEach("db.replicas", [&](const OptionTree::Node& node) {
+        std::string value;
+        ASSERT_TRUE(node.get(value));
+        keys.push_back(node.path() + "=" + value);
+    });
+    ASSERT_EQ((std::vector<std::string>{"db.replicas.0.host=c", "db.replicas.1.host=b"}), keys);
+
+    keys.clear();
+    tree.forEach("", [&](const OptionTree::Node& node) { keys.push_back(node.path()); });
+    ASSERT_EQ((std::vector<std::string>{"db.pool.size", "db.replicas.0.host",
+                                        "db.replicas.1.host", "cache.ttl", "cache.l2.size"}),
+              keys);
+
+    // A value that fits reuses the storage of the old one
+    const auto* value = tree.find("db.replicas.0.host")->value();
+    parse({"exe", "--db.replicas.0.host=d"});
+    ASSERT_EQ(value, tree.find("db.replicas.0.host")->value());
+    ASSERT_TRUE(tree.get("db.replicas.0.host", host));
+    ASSERT_EQ("d", host);
+
+    // A moved-from tree is left empty and usable
+    OptionTree moved(std::move(tree));
+    ASSERT_EQ(5u, moved.size());
+    ASSERT_EQ(value, moved.find("db.replicas.0.host")->value());
+    ASSERT_EQ(0u, tree.size());
+    ASSERT_EQ(nullptr, tree.find("db.pool.size"));
+    tree.set("x.y", std::basic_string<over9000::cmd_line_args::Char>(1, '1'));
+    ASSERT_TRUE(tree.find("x.y")->hasValue());
+    tree = std::move(moved);
+    ASSERT_EQ(5u, tree.size());
+    ASSERT_EQ(nullptr, tree.find("x.y"));
+    ASSERT_EQ(0u, moved.size());
+    moved.set("x.y", std::basic_string<over9000::cmd_line_args::Char>(1, '1'));
+    moved.clear();
+    parse({"exe", "--db.replicas.0.host=e"});
+    ASSERT_TRUE(tree.get("db.replicas.0.host", host));
+    ASSERT_EQ("e", host);
+
+    tree.clear();
+    ASSERT_EQ(0u, tree.size());
+    ASSERT_EQ(nullptr, tree.root().firstChild());
+
+    ASSERT_THROW(parser.addTree(tree, "db.**.x", "Bad"), Error);
+    ASSERT_THROW(parser.addTree(tree, "db..x", "Bad"), Error);
+    ASSERT_THROW(parser.addTree(tree, "cache.**", "Repeated"), Error);
+    ASSERT_THROW(parser.addTree(tree, "db.*", "Matching db.n"), Error);
+    ASSERT_THROW(parser.addParam(n, "cache.size", "Matching cache.**", OPTIONAL), Error);
+
+    Parser required("Required");
+    required.addTree(tree, "db.*", "Required");
+    ASSERT_THROW(parse(required, {"exe"}), Error);
+    parse(required, {"exe", "--db.x", "1"});
+    ASSERT_TRUE(tree.find("db.x")->hasValue());
+}
+
+TEST_F(Tests, structParams)
+{
+    struct Options
+    {
+        int port = 0;
+        std::string host = "localhost";
+        bool verbose = false;
+        std::vector<int> ids;
+        std::string input;
+    };
+
+    static const auto OPTIONS =
+        fields(field(&Options::port, "port", 'p', "Port"),
+               field(&Options::host, "host", "Host", OPTIONAL),
+               flagField(&Options::verbose, "verbose", 'v', "Verbose"),
+               field(&Options::ids, "id", "Ids", OPTIONAL),
+               positionalField(&Options::input, "input", "Input"));
+
+    Options options;
+    parser.addStruct(options, OPTIONS);
+
+    parse({"exe", "-p", "80", "--id=1", "-v", "--id", "2", "in"});
+
+    ASSERT_EQ(80, options.port);
+    ASSERT_EQ("localhost", options.host);
+    ASSERT_TRUE(options.verbose);
+    ASSERT_EQ((std::vector<int>{1, 2}), options.ids);
+    ASSERT_EQ("in", options.input);
+
+    parse({"exe", "--host=h", "--port=81", "--id=3", "in2"});
+
+    ASSERT_EQ(81, options.port);
+    ASSERT_EQ("h", options.host);
+    ASSERT_EQ((std::vector<int>{3}), options.ids);
+    ASSERT_EQ("in2", options.input);
+
+    try
+    {
+        parse({"exe", "-p", "x", "in"});
+        FAIL();
+    }
+    catch (const Error& error)
+    {
+        ASSERT_EQ(std::string("Bad argument -p/--port: x"), error.what());
+    }
+
+    ASSERT_THROW(parse({"exe", "in"}), Error);
+
+    Options other;
+    ASSERT_THROW(parser.addStruct(other, OPTIONS), Error);
+
+    Parser otherParser("Other");
+    otherParser.addStruct(other, OPTIONS);
+    parse(otherParser, {"exe", "-p", "1", "x"});
+
+    ASSERT_EQ(1, other.port);
+    ASSERT_EQ("x", other.input);
+    ASSERT_EQ("in", options.input);
+}
+
+TEST_F(Tests, dump)
+{
+    int i = 0;
+    parser.addParam(i, "int", 'i', "Int");
+
+    std::string s = "a \"b\"\n";
+    parser.addParam(s, "string", "String", OPTIONAL);
+
+    double d = 0.1;
+    parser.addParam(d, "double", "Double", OPTIONAL);
+
+    bool f = false;
+    parser.addFlag(f, "flag", "Flag");
+
+    Enum e = Enum::VALUE0;
+    parser.addParam(e, "enum", "Enum",
+                    {
+                        {"value1", Enum::VALUE1},
+                        {"value2", Enum::VALUE2},
+                    },
+                    OPTIONAL);
+
+    std::vector<Enum> enums;
+    parser.addParam(enums, "enums", "Enums",
+                    {
+                        {"value1", Enum::VALUE1},
+                        {"value2", Enum::VALUE2},
+                    },
+                    OPTIONAL);
+
+    std::vector<long long> numbers;
+    parser.addPositional(numbers, "numbers", "Numbers", OPTIONAL);
+
+    parse({"exe", "-i", "-42", "--flag", "--enums=value2", "--enums", "value1", "0",
+           "-9223372036854775808", "18"});
+
+    std::string text;
+    parser.dump(text);
+
+    ASSERT_EQ("int = -42\n"
+              "string = a \"b\"\n\n"
+              "double = 0.1\n"
+              "flag = true\n"
+              "enum = 0\n"
+              "enums = [value2, value1]\n"
+              "numbers = [0, -9223372036854775808, 18]\n",
+              text);
+
+    std::string json = "config: ";
+    parser.dump(json, DumpFormat::JSON);
+
+    ASSERT_EQ("config: {\"int\":-42,\"string\":\"a \\\"b\\\"\\u000a\",\"double\":0.1,"
+              "\"flag\":true,\"enum\":0,\"enums\":[\"value2\",\"value1\"],"
+              "\"numbers\":[0,-9223372036854775808,18]}",
+              json);
+
+    {
+        CommaLocale commaLocale;
+        json.clear();
+        parser.dump(json, DumpFormat::JSON);
+        ASSERT_NE(std::string::npos, json.find("\"double\":0.1,"));
+    }
+
+    parse({"exe", "--int=1", "--enum=value1", "--double=1e300"});
+
+    text.clear();
+    parser.dump(text, DumpFormat::TEXT, true);
+
+    ASSERT_EQ("int = 1 (command line)\n"
+              "string = a \"b\"\n (default)\n"
+              "double = 1e+300 (command line)\n"
+              "flag = true (default)\n"
+              "enum = value1 (command line)\n"
+              "enums = [value2, value1] (default)\n"
+              "numbers = [0, -9223372036854775808, 18] (default)\n",
+              text);
+
+    json.clear();
+    parser.dump(json, DumpFormat::JSON, true);
+
+    ASSERT_EQ(0u, json.find("{\"int\":{\"value\":1,\"source\":\"command line\"},\"string\":"
+                            "{\"value\":\"a \\\"b\\\"\\u000a\",\"source\":\"default\"}"));
+}
+
+TEST_F(Tests, pluginParams)
+{
+    std::string name;
+    parser.addParam(name, "name", "Name");
+
+    bool verbose = false;
+    parser.addFlag(verbose, "verbose", 'v', "Verbose");
+
+    std::string input;
+    parser.addPositional(input, "input", "Input");
+
+    parseKnown({"exe", "--name", "core", "--level", "3", "-p", "in", "--mode=fast", "-v"});
+
+    ASSERT_EQ("core", name);
+    ASSERT_TRUE(verbose);
+    ASSERT_EQ("", input);
+
+    // The plugins register their parameters after the core ones are parsed
+    name = "unchanged";
+
+    int level = 0;
+    parser.addParam(level, "level", "Level");
+
+    bool plugin = false;
+    parser.addFlag(plugin, "plugin", 'p', "Plugin");
+
+    parser.parseRemaining(false);
+
+    ASSERT_EQ("unchanged", name);
+    ASSERT_EQ(3, level);
+    ASSERT_TRUE(plugin);
+    ASSERT_EQ("in", input);
+
+    ASSERT_THROW(parser.parseRemaining(), Error);
+
+    std::string mode;
+    parser.addParam(mode, "mode", "Mode");
+
+    parseKnown({"exe", "--level", "4", "--mode=fast", "--name", "core", "in", "--other", "1"});
+    parser.parseRemaining(false);
+
+    ASSERT_EQ(4, level);
+    ASSERT_EQ("fast", mode);
+
+    std::vector<int> others;
+    parser.addParam(others, "other", "Other");
+    parser.parseRemaining();
+
+    ASSERT_EQ(std::vector<int>{1}, others);
+
+    ASSERT_THROW(parseKnown({"exe", "--name", "core", "--level", "4", "--mode=fast"}), Error);
+}
+
+TEST_F(Tests, patternParams)
+{
+    std::string bucket;
+    parser.addParam(bucket, "bucket", "Bucket", matching("[a-z0-9][a-z0-9.-]{2,8}"));
+
+    std::vector<std::string> ids;
+    parser.addParam(ids, "id", "Id", matching("(job|task)-\\d+(\\.[^.]*)?"), OPTIONAL);
+
+    parse({"exe", "--bucket", "my-bucket", "--id=job-1", "--id", "task-42.a-b", "--id=job-7."});
+
+    ASSERT_EQ("my-bucket", bucket);
+    ASSERT_EQ((std::vector<std::string>{"job-1", "task-42.a-b", "job-7."}), ids);
+
+    try
+    {
+        parse({"exe", "--bucket", "my_bucket"});
+        FAIL();
+    }
+    catch (const Error& e)
+    {
+        ASSERT_STREQ("Bad argument --bucket: my_bucket (mismatch at offset 2). "
+                     "Valid values: strings matching [a-z0-9][a-z0-9.-]{2,8}",
+                     e.what());
+    }
+
+    ASSERT_THROW(parse({"exe", "--bucket", "ab"}), Error);
+    ASSERT_THROW(parse({"exe", "--bucket", "abcdefghij"}), Error);
+    ASSERT_NO_THROW(parse({"exe", "--bucket", "abcdefghi"}));
+
+    try
+    {
+        parse({"exe", "--bucket", "abc", "--id", "job-"});
+        FAIL();
+    }
+    catch (const Error& e)
+    {
+        ASSERT_EQ(0, std::string(e.what()).find("Bad argument --id: job- (mismatch at offset 4)"));
+    }
+
+    ASSERT_THROW(parse({"exe", "--bucket", "abc", "--id", "job-1.x.y"}), Error);
+
+    for (const char* pattern : {"(a", "a)", "[a-", "[b-a]", "a**", "a{2,1}", "a{1001}", "*",
+                                "\\q", "a{"})
+    {
+        ASSERT_THROW(matching(pattern), Error) << pattern;
+    }
+    ASSERT_NO_THROW(matching("[]a-]|[^]]|\\.|a{0}|()"));
+}
+
+TEST_F(Tests, columnParams)
+{
+    StringColumn names;
+    parser.addParam(names, "name", 'n', "Name", OPTIONAL);
+
+    StringColumn files(true);
+    parser.addPositional(files, "files", "Files");
+
+    parse({"exe", "a.txt", "-n", "x", "b.txt", "--name=", "a.txt", "c.txt", "b.txt"});
+
+    std::vector<std::string> values;
+    for (auto name : names)
+    {
+        values.push_back(std::string(name.begin(), name.end()));
+    }
+    ASSERT_EQ((std::vector<std::string>{"x", ""}), values);
+
+    values.clear();
+    for (auto file : files)
+    {
+        values.push_back(std::string(file.begin(), file.end()));
+    }
+    ASSERT_EQ((std::vector<std::string>{"a.txt", "b.txt", "a.txt", "c.txt", "b.txt"}), values);
+
+    // The repeated files refer to the characters of their first occurrences
+    ASSERT_EQ(15u, files.charCount());
+    ASSERT_EQ(files[0].data(), files[2].data());
+    ASSERT_EQ(files[1], files[4]);
+    ASSERT_NE(files[0], files[1]);
+
+    std::string json;
+    parser.dump(json, DumpFormat::JSON);
+    ASSERT_EQ("{\"name\":[\"x\",\"\"],\"files\":[\"a.txt\",\"b.txt\",\"a.txt\",\"c.txt\","
+              "\"b.txt\"]}",
+              json);
+
+    parse({"exe", "d.txt"});
+
+    ASSERT_EQ(1u, files.size());
+    ASSERT_EQ(5u, files.charCount());
+    ASSERT_EQ(2u, names.size());
+
+    StringColumn many(true);
+    for (int i = 0; i < 1000; ++i)
+    {
+        many.push_back(std::to_string(i % 300));
+    }
+    ASSERT_EQ(1000u, many.size());
+    ASSERT_EQ("99", std::string(many[999].begin(), many[999].end()));
+    ASSERT_EQ(many[0].data(), many[900].data());
+}
+
+TEST_F(Tests, chronoParams)
+{
+    using namespace std::chrono;
+    using Days = duration<int64_t, std::ratio<86400>>;
+
+    system_clock::time_point since;
+    parser.addParam(since, "since", "Since");
+
+    time_point<system_clock, milliseconds> until;
+    parser.addParam(until, "until", "Until", timestamp(), OPTIONAL);
+
+    std::vector<time_point<system_clock, Days>> dates;
+    parser.addParam(dates, "date", "Dates", date(), OPTIONAL);
+
+    seconds at{};
+    parser.addParam(at, "at", "At", timeOfDay(), OPTIONAL);
+
+    // The range of system_clock::time_point depends on the standard library
+    time_point<system_clock, nanoseconds> precise;
+    parser.addParam(precise, "precise", "Precise", timestamp(), OPTIONAL);
+
+    parse({"exe", "--since=2024-06-01T00:00:00Z", "--until", "2024-06-01 12:30:00.2509+02:00",
+           "--date=1970-01-01", "--date", "2024-02-29", "--date=1969-12-31", "--at=23:59:59"});
+
+    ASSERT_EQ(1717200000, duration_cast<seconds>(since.time_since_epoch()).count());
+    ASSERT_EQ(1717237800250, until.time_since_epoch().count());
+    ASSERT_EQ(3u, dates.size());
+    ASSERT_EQ(0, dates[0].time_since_epoch().count());
+    ASSERT_EQ(19782, dates[1].time_since_epoch().count());
+    ASSERT_EQ(-1, dates[2].time_since_epoch().count());
+    ASSERT_EQ(86399, at.count());
+
+    parse({"exe", "--since=1969-12-31t23:59:59.5z", "--until=2024-06-01T00:00-0130",
+           "--at=07:05"});
+
+    ASSERT_EQ(-500, duration_cast<milliseconds>(since.time_since_epoch()).count());
+    ASSERT_EQ(1717205400000, until.time_since_epoch().count());
+    ASSERT_EQ(25500, at.count());
+
+    parse({"exe", "--since=2024-06-01"});
+    ASSERT_EQ(1717200000, duration_cast<seconds>(since.time_since_epoch()).count());
+
+    for (const char* arg :
+         {"--since=2024-06-01T00:00:00", "--since=2024-13-01", "--since=2023-02-29",
+          "--since=2024-06-01T24:00:00Z", "--since=2024-06-01T00:00:00.Z",
+          "--since=2024-06-01T00:00:00.1234567890Z", "--since=2024-06-01T00:00:00+2",
+          "--since=2024-6-01", "--since= 2024-06-01"})
+    {
+        ASSERT_THROW(parse({"exe", arg}), Error) << arg;
+    }
+
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--date=2024-06-01T00:00:00Z"}), Error);
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--at=12:60"}), Error);
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--precise=9999-12-31"}), Error);
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--precise=2262-04-11T23:47:16.9Z"}), Error);
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--precise=2262-04-11T23:47:16.854775808Z"}),
+                 Error);
+    parse({"exe", "--since=2024-06-01", "--precise=2262-04-11T23:47:16.854775807Z"});
+    ASSERT_EQ(nanoseconds::max().count(), precise.time_since_epoch().count());
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--precise=1677-09-21T00:12:43.145224191Z"}),
+                 Error);
+    parse({"exe", "--since=2024-06-01", "--precise=1677-09-21T00:12:43.145224192Z"});
+    ASSERT_EQ(nanoseconds::min().count(), precise.time_since_epoch().count());
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01T12:30.5Z"}), Error);
+    ASSERT_THROW(parse({"exe", "--since=2024-06-01", "--at=12:30.5"}), Error);
+    parse({"exe", "--since=2024-06-01", "--precise=2262-01-01"});
+    ASSERT_EQ(9214646400, duration_cast<seconds>(precise.time_since_epoch()).count());
+
+    parse({"exe", "--since=2024-06-01T12:30:00.25Z", "--until=1969-12-31T23:59:59.999Z"});
+
+    std::string text;
+    parser.dump(text);
+    ASSERT_EQ(0u, text.find("since = 2024-06-01T12:30:00.25Z\n"
+                            "until = 1969-12-31T23:59:59.999Z\n"));
+
+    parse({"exe", "--since=2024-06-01", "--date=1970-01-01", "--date=1969-12-31"});
+
+    text.clear();
+    parser.dump(text);
+    ASSERT_NE(std::string::npos,
+              text.find("date = [1970-01-01T00:00:00Z, 1969-12-31T00:00:00Z]\n"));
+}
+
+TEST_F(Tests, jsonParams)
+{
+    struct Limits
+    {
+        int cpu = 0;
+        double memory = 0;
+    };
+
+    struct Rule
+    {
+        std::string name;
+        std::vector<int> ports;
+    };
+
+    struct Policy
+    {
+        std::string name;
+        bool enabled = false;
+        Limits limits;
+        std::vector<Rule> rules;
+    };
+
+    static const auto LIMITS = jsonFields(jsonField(&Limits::cpu, "cpu"),
+                                          jsonField(&Limits::memory, "memory", OPTIONAL));
+    static const auto RULE =
+        jsonFields(jsonField(&Rule::name, "name"), jsonField(&Rule::ports, "ports", OPTIONAL));
+    static const auto POLICY = jsonFields(jsonField(&Policy::name, "name"),
+                                          jsonField(&Policy::enabled, "enabled", OPTIONAL),
+                                          jsonField(&Policy::limits, "limits", LIMITS),
+                                          jsonField(&Policy::rules, "rules", RULE, OPTIONAL));
+
+    Policy policy;
+    parser.addParam(policy, "policy", "Policy", json(POLICY));
+
+    JsonTape extra;
+    parser.addParam(extra, "extra", "Extra", OPTIONAL);
+
+    parseKnown({"exe",
+                R"(--policy={"name": "a\"bé😀", "enabled": true,)"
+                R"( "limits": {"cpu": -4, "memory": 1.5e3},)"
+                R"( "rules": [{"name": "web", "ports": [80, 443]}, {"name": "any"}]})",
+                R"(--extra=[null, {"k": [1, "two", false]}, -0.5])"});
+
+    ASSERT_EQ("a\"b\xc3\xa9\xf0\x9f\x98\x80", policy.name);
+    ASSERT_TRUE(policy.enabled);
+    ASSERT_EQ(-4, policy.limits.cpu);
+    ASSERT_EQ(1500, policy.limits.memory);
+    ASSERT_EQ(2u, policy.rules.size());
+    ASSERT_EQ("web", policy.rules[0].name);
+    ASSERT_EQ((std::vector<int>{80, 443}), policy.rules[0].ports);
+    ASSERT_EQ("any", policy.rules[1].name);
+    ASSERT_TRUE(policy.rules[1].ports.empty());
+
+    auto root = extra.root();
+    ASSERT_EQ(JsonKind::ARRAY, root.kind());
+    ASSERT_EQ(3u, root.size());
+    ASSERT_EQ(JsonKind::NULL_VALUE, root[0].kind());
+    auto list = root[1].find("k");
+    ASSERT_EQ(3u, list.size());
+    int one = 0;
+    ASSERT_TRUE(list[0].get(one));
+    ASSERT_EQ(1, one);
+    std::string two;
+    ASSERT_TRUE(list[1].get(two));
+    ASSERT_EQ("two", two);
+    ASSERT_EQ(JsonKind::BOOLEAN, list[2].kind());
+    ASSERT_FALSE(list[1].get(one));
+    ASSERT_EQ(JsonKind::NONE, root[1].find("x").kind());
+    double half = 0;
+    ASSERT_TRUE(root[2].get(half));
+    ASSERT_EQ(-0.5, half);
+
+    std::string text;
+    parser.dump(text, DumpFormat::JSON);
+    ASSERT_NE(std::string::npos, text.find(R"("extra":[null, {"k": [1, "two", false]}, -0.5])"));
+
+    auto expectError = [this](const char* arg, const char* error) {
+        try
+        {
+            parse({"exe", arg});
+            FAIL() << arg;
+        }
+        catch (const Error& e)
+        {
+            ASSERT_NE(std::string::npos, std::string(e.what()).find(error)) << e.what();
+        }
+    };
+
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 1.5}})",
+                "($.limits.cpu: expected an integer in range at offset 32)");
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 99999999999}})",
+                "$.limits.cpu: expected an integer in range");
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 1, "memory": 1e999}})",
+                "$.limits.memory: expected a number in range");
+    expectError(R"(--policy={"name": "a", "limits": {}})", "$.limits.cpu: missing");
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 1}, "x": 1})", "$.x: unknown name");
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 1}, "rules": [{"name": 1}]})",
+                "$.rules[0].name: expected a string");
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 1}, "rules": [{"name": "b",)"
+                R"( "ports": [1, "2"]}]})",
+                "$.rules[0].ports[1]: expected an integer in range");
+    expectError(R"(--policy={"name": "a", "limits": {"cpu": 01}})",
+                "$.limits: expected ',' or '}' at offset 33");
+    expectError(R"(--policy={"name": "a\x"})", "$.name: bad escape");
+    expectError(R"(--policy={"name": "a"} x)", "$: unexpected character at offset 14");
+    expectError(R"(--policy=)", "$: unexpected end at offset 0");
+    expectError(R"(--extra=[1, [tru]])", "$[1][0]: unexpected character");
+
+    std::string deep(100, '[');
+    deep.insert(0, "--extra=");
+    expectError(deep.c_str(), "too deep nesting");
+
+    {
+        CommaLocale commaLocale;
+        parse({"exe", R"(--policy={"name": "a", "limits": {"cpu": 1, "memory": 2.5}})"});
+    }
+    ASSERT_EQ(2.5, policy.limits.memory);
+}
+
+TEST_F(Tests, restoreDefaults)
+{
+    struct Options
+    {
+        int port = 80;
+        std::string host = "localhost";
+    };
+
+    static const auto OPTIONS = fields(field(&Options::port, "port", "Port", OPTIONAL),
+                                       field(&Options::host, "host", "Host", OPTIONAL));
+
+    int i = 1;
+    parser.addParam(i, "int", 'i', "Integer", OPTIONAL);
+
+    std::string s = "default";
+    parser.addParam(s, "string", "String", OPTIONAL);
+
+    std::vector<int> list{1, 2};
+    parser.addParam(list, "list", "List", OPTIONAL);
+
+    Options options;
+    parser.addStruct(options, OPTIONS);
+
+    std::vector<std::string> files{"-"};
+    parser.addPositional(files, "files", "Files", OPTIONAL);
+
+    parser.captureDefaults();
+
+    double d = 0.5;
+    parser.addParam(d, "double", "Double", OPTIONAL);
+
+    parse({"exe", "-i", "10", "--string=given", "--list=3", "--port=8080", "--double=1.5", "a",
+           "b"});
+
+    ASSERT_EQ(10, i);
+    ASSERT_EQ("given", s);
+    ASSERT_EQ((std::vector<int>{3}), list);
+    ASSERT_EQ(8080, options.port);
+    ASSERT_EQ("localhost", options.host);
+    ASSERT_EQ(1.5, d);
+    ASSERT_EQ((std::vector<std::string>{"a", "b"}), files);
+
+    parse({"exe", "--host=example.com"});
+
+    ASSERT_EQ(1, i);
+    ASSERT_EQ("default", s);
+    ASSERT_EQ((std::vector<int>{1, 2}), list);
+    ASSERT_EQ(80, options.port);
+    ASSERT_EQ("example.com", options.host);
+    ASSERT_EQ(0.5, d);
+    ASSERT_EQ((std::vector<std::string>{"-"}), files);
+
+    std::string text;
+    parser.dump(text, DumpFormat::TEXT, true);
+    ASSERT_NE(std::string::npos, text.find("int = 1 (default)\n"));
+
+    // The values of a failed parse are restored too
+    ASSERT_THROW(parse({"exe", "--int=20", "--list=4", "--list=x"}), Error);
+    parse({"exe"});
+
+    ASSERT_EQ(1, i);
+    ASSERT_EQ((std::vector<int>{1, 2}), list);
+    ASSERT_EQ("localhost", options.host);
+}
+
+TEST_F(Tests, transactionalParse)
+{
+    struct Options
+    {
+        int port = 80;
+        std::string host = "localhost";
+    };
+
+    static const auto OPTIONS = fields(field(&Options::port, "port", "Port", OPTIONAL),
+                                       field(&Options::host, "host", "Host", OPTIONAL));
+
+    int i = 1;
+    parser.addParam(i, "int", 'i', "Integer", OPTIONAL);
+
+    std::vector<int> list{1, 2};
+    parser.addParam(list, "list", "List", OPTIONAL);
+
+    Options options;
+    parser.addStruct(options, OPTIONS);
+
+    std::string file;
+    parser.addPositional(file, "file", "File");
+
+    parser.setTransactional(true);
+
+    parse({"exe", "-i", "10", "--host=example.com", "a"});
+
+    ASSERT_THROW(parse({"exe", "--list=3", "--port=8080", "-i", "20", "--list=x", "b"}), Error);
+
+    ASSERT_EQ(10, i);
+    ASSERT_EQ((std::vector<int>{1, 2}), list);
+    ASSERT_EQ(80, options.port);
+    ASSERT_EQ("example.com", options.host);
+    ASSERT_EQ("a", file);
+
+    // A missing argument rolls back the given ones
+    ASSERT_THROW(parse({"exe", "--list=3", "--port=8080"}), Error);
+
+    ASSERT_EQ((std::vector<int>{1, 2}), list);
+    ASSERT_EQ(80, options.port);
+
+    std::string text;
+    parser.dump(text, DumpFormat::TEXT, true);
+    ASSERT_NE(std::string::npos, text.find("int = 10 (command line)\n"));
+
+    // The restored defaults are rolled back too
+    parser.captureDefaults();
+    parse({"exe", "--list=3", "b"});
+    ASSERT_THROW(parse({"exe", "-i", "x", "c"}), Error);
+
+    ASSERT_EQ(10, i);
+    ASSERT_EQ((std::vector<int>{3}), list);
+    ASSERT_EQ("b", file);
+
+    parse({"exe", "c"});
+
+    ASSERT_EQ(10, i);
+    ASSERT_EQ((std::vector<int>{1, 2}), list);
+    ASSERT_EQ("c", file);
+}
+
+TEST_F(Tests, fileParams)
+{
+    struct Limits
+    {
+        int cpu = 0;
+    };
+
+    static const auto LIMITS = jsonFields(jsonField(&Limits::cpu, "cpu"));
+
+    TempDir dir;
+    auto configPath = dir.file("config.txt");
+    auto keyPath = dir.file("key.txt");
+    auto limitsPath = dir.file("limits.json");
+    const char* configFile = configPath.c_str();
+    const char* keyFile = keyPath.c_str();
+    const char* limitsFile = limitsPath.c_str();
+    std::ofstream(configFile, std::ios::binary).write("a = 1\n\0b", 8);
+    std::ofstream(keyFile, std::ios::binary) << "00ff10\r\n";
+    std::ofstream(limitsFile, std::ios::binary) << R"({"cpu": 4})" << '\n';
+
+    std::string config;
+    parser.addParam(config, "config", "Config", fromFile());
+
+    std::vector<std::vector<uint8_t>> keys;
+    parser.addParam(keys, "key", "Keys", fromFile(hex()), OPTIONAL);
+
+    Limits limits;
+    parser.addParam(limits, "limits", "Limits", fromFile(json(LIMITS)), OPTIONAL);
+
+    parse({"exe", "--config", configFile, "--key", keyFile, "--limits", limitsFile, "--key",
+           keyFile});
+
+    ASSERT_EQ(std::string("a = 1\n\0b", 8), config);
+    ASSERT_EQ(2u, keys.size());
+    ASSERT_EQ((std::vector<uint8_t>{0x00, 0xff, 0x10}), keys[1]);
+    ASSERT_EQ(4, limits.cpu);
+
+    try
+    {
+        parse({"exe", "--config", configFile, "--key", "cmd_line_args_tests_missing.txt"});
+        FAIL();
+    }
+    catch (const Error& e)
+    {
+        ASSERT_NE(std::string::npos,
+                  std::string(e.what()).find("cmd_line_args_tests_missing.txt (cannot read the "
+                                             "file). Valid values: paths of readable files"));
+    }
+
+    std::ofstream(limitsFile, std::ios::binary) << R"({"cpu": "4"})";
+    try
+    {
+        parse({"exe", "--config", configFile, "--limits", limitsFile});
+        FAIL();
+    }
+    catch (const Error& e)
+    {
+        ASSERT_NE(std::string::npos, std::string(e.what()).find("($.cpu: expected an integer"));
+    }
+
+    ASSERT_THROW(parse({"exe", "--config="}), Error);
+}
+
+TEST_F(Tests, earlyOptions)
+{
+    int arenas = 0;
+    bool hugepages = false;
+    double ratio = 0;
+    unsigned node = 7;
+
+    EarlyOptions<4> early;
+    early.addParam(arenas, "malloc-arenas", 'm', "Malloc arenas");
+    early.addFlag(hugepages, "hugepages", "Use huge pages");
+    early.addParam(ratio, "ratio", "Ratio");
+    early.addParam(node, "numa-node", "NUMA node");
+    ASSERT_THROW(early.addParam(ratio, "extra", "Extra"), Error);
+
+    std::vector<const char*> args = {"exe",   "--name", "value",     "-m",         "-4",
+                                     "other", "-x",     "--ratio=.5", "--hugepages", "--"};
+    parse(early, args);
+    ASSERT_EQ(nullptr, early.error());
+    ASSERT_EQ(-4, arenas);
+    ASSERT_TRUE(hugepages);
+    ASSERT_EQ(0.5, ratio);
+    ASSERT_EQ(7u, node);
+
+    parse(early, {"exe", "--numa-node", "-1"});
+    ASSERT_STREQ("Bad value of an early option", early.error());
+    ASSERT_EQ(1, early.errorArg());
+
+    for (const char* ratioArg : {"1e999", "0.5x", " 0.5", "0x1p-1", "inf", ""})
+    {
+        parse(early, {"exe", "--ratio", ratioArg});
+        ASSERT_STREQ("Bad value of an early option", early.error()) << ratioArg;
+    }
+
+    parse(early, {"exe", "--ratio", "1", "--malloc-arenas"});
+    ASSERT_STREQ("Missing value of an early option", early.error());
+    ASSERT_EQ(3, early.errorArg());
+
+    parse(early, args);
+    ASSERT_EQ(nullptr, early.error());
+
+    std::string name;
+    parser.addParam(name, "name", "Name", OPTIONAL);
+    parser.addEarly(early);
+
+    std::vector<std::string> positional;
+    parser.addPositional(positional, "positional", "Positional", OPTIONAL);
+
+    std::vector<const char*> fullArgs = {"exe", "--name", "value", "-m", "-4", "other",
+                                         "--ratio=.5", "--hugepages"};
+    parse(fullArgs);
+    ASSERT_EQ("value", name);
+    ASSERT_EQ((std::vector<std::string>{"other"}), positional);
+
+    {
+        CommaLocale commaLocale;
+        parse(early, args);
+        ASSERT_EQ(nullptr, early.error());
+        ASSERT_EQ(0.5, ratio);
+        parse(fullArgs);
+    }
+
+    std::string text;
+    parser.dump(text);
+    ASSERT_NE(std::string::npos, text.find("malloc-arenas = -4\n"
+                                           "hugepages = true\n"
+                                           "ratio = 0.5\n"
+                                           "numa-node = 7\n"));
+
+    try
+    {
+        parse({"exe", "--ratio=0.25"});
+        FAIL();
+    }
+    catch (const Error& e)
+    {
+        ASSERT_STREQ("Bad argument --ratio: 0.25 (differs from the early parse)", e.what());
+    }
+
+#ifndef _WIN32
+    const char* logLevel = "info";
+    EarlyOptions<> logOptions;
+    logOptions.addParam(logLevel, "log-level", "Log level");
+
+    std::vector<const char*> logArgs = {"exe", "--log-level", "debug"};
+    ASSERT_TRUE(logOptions.parse(static_cast<int>(logArgs.size()), logArgs.data()));
+    ASSERT_STREQ("debug", logLevel);
+
+    Parser logParser("Description");
+    logParser.addEarly(logOptions);
+    parse(logParser, logArgs);
+    ASSERT_THROW(parse(logParser, {"exe", "--log-level=trace"}), Error);
+#endif // _WIN32
+}
+
+TEST_F(Tests, corpusCapture)
+{
+    const char* corpusFile = "cmd_line_args_tests.corpus";
+    std::remove(corpusFile);
+
+    std::string name;
+    parser.addParam(name, "name", 'n', "Name", OPTIONAL);
+
+    std::vector<int> ints;
+    parser.addParam(ints, "int", "Integers", OPTIONAL);
+
+    std::vector<std::string> files;
+    parser.addPositional(files, "files", "Files", OPTIONAL);
+
+    parser.setCapture(CorpusWriter(corpusFile));
+    parse({"exe", "--name=Secret 1", "--int", "1024", "-n", "a\tb\\c", "/home/user/file.txt"});
+    ASSERT_THROW(parse({"exe", "--int=x"}), Error);
+
+    parser.setCapture(CorpusWriter(corpusFile, false));
+    parse({"exe", "--name=Secret 1", "--int", "-5"});
+
+    auto records = readCorpus(corpusFile);
+    ASSERT_EQ(3u, records.size());
+
+    ASSERT_FALSE(records[0].error);
+    const auto& args = records[0].args;
+    ASSERT_EQ(6u, args.size());
+    ASSERT_EQ(0u, args[0].find("--name="));
+    ASSERT_EQ(15u, args[0].size());
+    ASSERT_EQ(' ', args[0][13]);
+    ASSERT_NE("--name=Secret 1", args[0]);
+    ASSERT_EQ("--int", args[1]);
+    ASSERT_EQ(4u, args[2].size());
+    ASSERT_EQ(std::string::npos, args[2].find_first_not_of("0123456789"));
+    ASSERT_NE('0', args[2][0]);
+    ASSERT_EQ("-n", args[3]);
+    ASSERT_EQ(5u, args[4].size());
+    ASSERT_EQ('\t', args[4][1]);
+    ASSERT_EQ('\\', args[4][3]);
+    ASSERT_EQ(19u, args[5].size());
+    ASSERT_EQ(0u, args[5].find('/'));
+    ASSERT_EQ(15u, args[5].find('.'));
+
+    ASSERT_TRUE(records[1].error);
+    ASSERT_EQ(1u, records[1].args.size());
+    ASSERT_EQ(7u, records[1].args[0].size());
+
+    ASSERT_FALSE(records[2].error);
+    ASSERT_EQ((std::vector<std::string>{"--name=Secret 1", "--int", "-5"}), records[2].args);
+
+    // Equal values are hashed equally by a writer or writers with the same key only
+    parser.setCapture(CorpusWriter(corpusFile));
+    parse({"exe", "--name=Secret 1"});
+    ASSERT_NE(records[0].args[0], readCorpus(corpusFile).back().args[0]);
+
+    parser.setCapture(CorpusWriter(corpusFile, true, 42));
+    parse({"exe", "--name=Secret 1"});
+    auto keyed = readCorpus(corpusFile).back().args[0];
+    parser.setCapture(CorpusWriter(corpusFile, true, 42));
+    parse({"exe", "--name=Secret 1"});
+    ASSERT_EQ(keyed, readCorpus(corpusFile).back().args[0]);
+
+    std::remove(corpusFile);
+}
+
+TEST_F(Tests, collectErrors)
+{
+    int i = 0;
+    parser.addParam(i, "int", 'i', "Integer");
+
+    std::string s;
+    parser.addParam(s, "string", "String");
+
+    std::vector<int> ints;
+    parser.addParam(ints, "ints", "Integers", async(), OPTIONAL);
+
+    int flag = 0;
+    parser.addFlag(flag, "flag", 'f', "Flag");
+
+    auto diagnostics = parseAll(
+        {"exe", "--ints", "x", "-i", "y", "--unknown", "-f", "-i", "1", "--ints=2", "-f"});
+
+    ASSERT_EQ(6u, diagnostics.size());
+    std::vector<DiagnosticKind> kinds;
+    std::vector<int> args;
+    for (const auto& diagnostic : diagnostics)
+    {
+        kinds.push_back(diagnostic.kind);
+        args.push_back(diagnostic.arg);
+    }
+    ASSERT_EQ((std::vector<DiagnosticKind>{
+                  DiagnosticKind::BAD_ARGUMENT, DiagnosticKind::BAD_ARGUMENT,
+                  DiagnosticKind::UNEXPECTED_ARGUMENT, DiagnosticKind::REPEATED_ARGUMENT,
+                  DiagnosticKind::REPEATED_ARGUMENT, DiagnosticKind::MISSING_ARGUMENT}),
+              kinds);
+    ASSERT_EQ((std::vector<int>{2, 4, 5, 7, 10, 0}), args);
+    ASSERT_EQ(std::string("ints"), diagnostics[0].name);
+    ASSERT_EQ(nullptr, diagnostics[2].name);
+    ASSERT_EQ(1u, diagnostics[1].size);
+
+    ASSERT_EQ("Bad argument -i/--int: y", parser.format(diagnostics[1]));
+    ASSERT_EQ("Unexpected argument: --unknown", parser.format(diagnostics[2]));
+    ASSERT_EQ("Repeated argument: -i/--int", parser.format(diagnostics[3]));
+    ASSERT_EQ("Missing argument: --string", parser.format(diagnostics[5]));
+
+    // The good arguments are parsed
+    ASSERT_EQ((std::vector<int>{2}), ints);
+    ASSERT_EQ(1, flag);
+
+    ASSERT_TRUE(parseAll({"exe", "-i", "1", "--string=a"}).empty());
+    ASSERT_EQ(1, i);
+    ASSERT_EQ("a", s);
+
+    // A transactional parser rolls them back
+    parser.setTransactional(true);
+    ASSERT_EQ(1u, parseAll({"exe", "-i", "2", "--string=b", "--ints", "3", "x"}).size());
+    ASSERT_EQ(1, i);
+    ASSERT_EQ("a", s);
+    ASSERT_EQ((std::vector<int>{2}), ints);
+
+    try
+    {
+        parse({"exe", "-i", "1", "-i", "2", "--string=a"});
+        FAIL();
+    }
+    catch (const Error& error)
+    {
+        ASSERT_EQ(std::string("Repeated argument: -i/--int"), error.what());
+    }
+}
+
+TEST_F(Tests, setParams)
+{
+    HashSet<std::string> users;
+    parser.addParam(users, "allow-user", 'u', "Allowed users", OPTIONAL);
+
+    IntegerSet<int> shards;
+    parser.addParam(shards, "exclude-shard", "Excluded shards", OPTIONAL);
+
+    IntegerSet<uint32_t> ids(true);
+    parser.addParam(ids, "id", "IDs", OPTIONAL);
+
+    parse({"exe", "-u", "bob", "--allow-user=alice", "-u", "bob", "--exclude-shard", "7",
+           "--exclude-shard=-3", "--exclude-shard", "7"});
+
+    ASSERT_EQ((std::vector<std::string>{"bob", "alice"}),
+              std::vector<std::string>(users.begin(), users.end()));
+    ASSERT_TRUE(users.contains("alice"));
+    ASSERT_FALSE(users.contains("carol"));
+
+    ASSERT_EQ((std::vector<int>{-3, 7}), std::vector<int>(shards.begin(), shards.end()));
+    ASSERT_TRUE(shards.contains(-3));
+    ASSERT_FALSE(shards.contains(0));
+
+    std::string text;
+    parser.dump(text);
+    ASSERT_NE(std::string::npos, text.find("exclude-shard = [-3, 7]"));
+
+    // Compressed into 2 bit deltas
+    std::vector<std::string> strings;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        strings.push_back("--id=" + std::to_string(1000000 + (i * 7919) % 1000 * 3));
+    }
+    std::vector<const char*> args{"exe"};
+    for (const auto& string : strings)
+    {
+        args.push_back(string.c_str());
+    }
+    args.push_back("--id=1000000");
+    parse(args);
+
+    ASSERT_EQ(1000u, ids.size());
+    ASSERT_LT(ids.byteCount(), 1000u);
+    ASSERT_TRUE(ids.contains(1000000));
+    ASSERT_TRUE(ids.contains(1002997));
+    ASSERT_FALSE(ids.contains(1000001));
+    ASSERT_FALSE(ids.contains(999999));
+    ASSERT_FALSE(ids.contains(1003000));
+    std::vector<uint32_t> values(ids.begin(), ids.end());
+    ASSERT_TRUE(std::is_sorted(values.begin(), values.end()));
+    ASSERT_EQ(1002997u, values.back());
+
+    // Repeated parses replace the values
+    parse({"exe", "-u", "carol", "--id", "5"});
+    ASSERT_EQ(1u, users.size());
+    ASSERT_TRUE(users.contains("carol"));
+    ASSERT_FALSE(users.contains("bob"));
+    ASSERT_EQ(1u, ids.size());
+    ASSERT_TRUE(ids.contains(5));
+}
+
+TEST_F(Tests, mountedOptionGroups)
+{
+    struct StorageOptions
+    {
+        std::string endpoint;
+        int timeout = 30;
+        int verbose = 0;
+    };
+
+    static const auto STORAGE_OPTIONS =
+        fields(field(&StorageOptions::endpoint, "endpoint", 'e', "Endpoint"),
+               field(&StorageOptions::timeout, "timeout", "Timeout", OPTIONAL),
+               flagField(&StorageOptions::verbose, "verbose", 'v', "Verbose"));
+
+    StorageOptions storage;
+    parser.addStruct(storage, STORAGE_OPTIONS, "storage.");
+
+    StorageOptions backup;
+    parser.addStruct(backup, STORAGE_OPTIONS, "backup.");
+
+    StorageOptions local;
+    parser.addStruct(local, STORAGE_OPTIONS);
+
+    parse({"exe", "--storage.endpoint", "a:1", "--backup.endpoint=b:2", "--backup.timeout", "5",
+           "--storage.verbose", "-e", "c:3"});
+
+    ASSERT_EQ("a:1", storage.endpoint);
+    ASSERT_EQ(30, storage.timeout);
+    ASSERT_EQ(1, storage.verbose);
+    ASSERT_EQ("b:2", backup.endpoint);
+    ASSERT_EQ(5, backup.timeout);
+    ASSERT_EQ(0, backup.verbose);
+    ASSERT_EQ("c:3", local.endpoint);
+
+    // The parameters refer to the field names, the prefixed ones composed per group
+    auto diagnostics = parseAll({"exe", "-e", "a", "--storage.endpoint=b", "--backup.endpoint=c",
+                                 "--timeout=x", "--backup.timeout=y", "--storage.timeout=z"});
+    ASSERT_EQ(3u, diagnostics.size());
+    ASSERT_STREQ("timeout", diagnostics[0].name);
+    ASSERT_STREQ("backup.timeout", diagnostics[1].name);
+    ASSERT_STREQ("storage.timeout", diagnostics[2].name);
+
+    ASSERT_THROW(parser.addStruct(storage, STORAGE_OPTIONS, "storage."), Error);
+
+    // Temporary table
+    Parser temporaryParser("Temporary table");
+    StorageOptions temporary;
+    temporaryParser.addStruct(temporary,
+                              fields(field(&StorageOptions::endpoint, "endpoint", "Endpoint"),
+                                     field(&StorageOptions::timeout, "timeout", "Timeout")),
+                              "db.");
+    parse(temporaryParser, {"exe", "--db.endpoint=d:4", "--db.timeout", "9"});
+    ASSERT_EQ("d:4", temporary.endpoint);
+    ASSERT_EQ(9, temporary.timeout);
+
+    // Many groups
+    Parser manyParser("Many groups");
+    std::vector<StorageOptions> groups(100);
+    std::vector<std::string> strings;
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        auto prefix = "group" + std::to_string(i) + ".";
+        manyParser.addStruct(groups[i], STORAGE_OPTIONS, prefix);
+        strings.push_back("--" + prefix + "endpoint=" + std::to_string(i));
+    }
+
+    std::vector<const char*> args{"exe"};
+    for (const auto& string : strings)
+    {
+        args.push_back(string.c_str());
+    }
+    args.push_back("--group42.timeout=7");
+    parse(manyParser, args);
+
+    ASSERT_EQ("99", groups[99].endpoint);
+    ASSERT_EQ(7, groups[42].timeout);
+    ASSERT_EQ(30, groups[41].timeout);
+}
+
+TEST_F(Tests, listContainers)
+{
+    SmallVector<int, 4> ints;
+    parser.addParam(ints, "int", 'i', "Integers", OPTIONAL);
+
+    SmallVector<std::string, 2> strings;
+    parser.addParam(strings, "string", 's', "Strings", OPTIONAL);
+
+    std::deque<double> doubles;
+    parser.addParam(doubles, "double", "Doubles", OPTIONAL);
+
+    StaticVector<int, 2> range;
+    parser.addPositional(range, "range", "Range", OPTIONAL);
+
+    parse({"exe", "-i", "1", "-i", "2", "-s", "a", "-s", "b", "-s", "c", "--double=0.5", "3",
+           "4"});
+
+    ASSERT_EQ((std::vector<int>{1, 2}), std::vector<int>(ints.begin(), ints.end()));
+    ASSERT_TRUE(ints.isInline());
+    ASSERT_EQ((std::vector<std::string>{"a", "b", "c"}),
+              std::vector<std::string>(strings.begin(), strings.end()));
+    ASSERT_FALSE(strings.isInline());
+    ASSERT_EQ((std::deque<double>{0.5}), doubles);
+    ASSERT_EQ((std::vector<int>{3, 4}), std::vector<int>(range.begin(), range.end()));
+
+    auto copy = strings;
+    ASSERT_EQ(strings, copy);
+    auto moved = std::move(copy);
+    ASSERT_EQ(strings, moved);
+    ASSERT_TRUE(copy.empty());
+
+    parse({"exe", "-s", "x"});
+    ASSERT_EQ(1u, strings.size());
+    ASSERT_EQ("x", strings[0]);
+
+    try
+    {
+        parse({"exe", "3", "4", "5"});
+        FAIL();
+    }
+    catch (const Error& error)
+    {
+        ASSERT_EQ(std::string("Bad argument --range: 5 (too many values)"), error.what());
+    }
+
+    // The reason of a bad value is the one when it was reported
+    auto diagnostics = parseAll({"exe", "x", "3", "4", "5"});
+    ASSERT_EQ(2u, diagnostics.size());
+    ASSERT_EQ("Bad argument --range: x", parser.format(diagnostics[0]));
+    ASSERT_EQ("Bad argument --range: 5 (too many values)", parser.format(diagnostics[1]));
+
+    // Asynchronously converted values past N are bad arguments as well
+    StaticVector<int, 2> asyncRange;
+    parser.addParam(asyncRange, "async-range", "Async range", async(), OPTIONAL);
+    diagnostics = parseAll({"exe", "--async-range=1", "--async-range=x", "--async-range=2",
+                            "--async-range=3", "--async-range=4"});
+    ASSERT_EQ(3u, diagnostics.size());
+    ASSERT_EQ("Bad argument --async-range: x", parser.format(diagnostics[0]));
+    ASSERT_EQ("Bad argument --async-range: 3 (too many values)", parser.format(diagnostics[1]));
+    ASSERT_EQ(5, diagnostics[2].arg);
+
+    parse({"exe", "--async-range=1", "--async-range=2"});
+    ASSERT_EQ((std::vector<int>{1, 2}), std::vector<int>(asyncRange.begin(), asyncRange.end()));
+}
+
+TEST_F(Tests, latencyHistogram)
+{
+    LatencyHistogram histogram;
+    parser.setLatencyObserver(histogram);
+
+    std::vector<int> ints;
+    parser.addParam(ints, "int", 'i', "Integers", OPTIONAL);
+
+    int value = 0;
+    parser.addParam(value, "value", "Value", OPTIONAL);
+
+    parse({"exe", "-i", "1"});
+    parse({"exe", "-i", "1", "-i", "2", "-i", "3"});
+    ASSERT_THROW(parse({"exe", "-i", "x"}), Error);
+    ASSERT_THROW(parse({"exe", "--unknown"}), Error);
+    ASSERT_EQ(1u, parseAll({"exe", "--value", "1", "--value", "2"}).size());
+
+    std::thread thread([histogram] {
+        Parser threadParser("Description");
+        threadParser.setLatencyObserver(histogram);
+        for (int i = 0; i < 10; ++i)
+        {
+            parse(threadParser, {"exe"});
+        }
+    });
+    thread.join();
+
+    auto snapshot = histogram.snapshot();
+    ASSERT_EQ(12u, snapshot.count(ParseOutcome::SUCCESS));
+    ASSERT_EQ(11u, snapshot.count(ParseOutcome::SUCCESS, 0));
+    ASSERT_EQ(1u, snapshot.count(ParseOutcome::SUCCESS, 1));
+    ASSERT_EQ(1u, snapshot.count(ParseOutcome::BAD_ARGUMENT));
+    ASSERT_EQ(1u, snapshot.count(ParseOutcome::UNEXPECTED_ARGUMENT));
+    ASSERT_EQ(1u, snapshot.count(ParseOutcome::REPEATED_ARGUMENT, 1));
+    ASSERT_EQ(0u, snapshot.count(ParseOutcome::MISSING_ARGUMENT));
+    ASSERT_EQ(std::chrono::nanoseconds(0), snapshot.percentile(ParseOutcome::MISSING_ARGUMENT, 50));
+
+    LatencyHistogram direct;
+    for (int i = 0; i < 99; ++i)
+    {
+        direct(1, ParseOutcome::OTHER_ERROR, std::chrono::nanoseconds(1000));
+    }
+    direct(100, ParseOutcome::OTHER_ERROR, std::chrono::seconds(1));
+
+    auto directSnapshot = direct.snapshot();
+    auto p50 = directSnapshot.percentile(ParseOutcome::OTHER_ERROR, 50);
+    ASSERT_LE(std::chrono::nanoseconds(1000), p50);
+    ASSERT_GT(std::chrono::nanoseconds(1125), p50);
+    ASSERT_LE(std::chrono::seconds(1), directSnapshot.percentile(ParseOutcome::OTHER_ERROR, 100));
+    ASSERT_EQ(p50, directSnapshot.percentile(ParseOutcome::OTHER_ERROR, 0, 100));
+
+    directSnapshot.merge(direct.snapshot());
+    ASSERT_EQ(200u, directSnapshot.count(ParseOutcome::OTHER_ERROR));
+
+    std::string text;
+    directSnapshot.dump(text);
+    ASSERT_EQ(0u, text.find("other-error 0-3: count 198, p50 " + std::to_string(p50.count())));
+    ASSERT_NE(std::string::npos, text.find("\nother-error 64+: count 2, p50 "));
+
+    std::string dump;
+    directSnapshot.dump(dump, DumpFormat::JSON);
+    ASSERT_EQ(0u, dump.find("{\"other-error\":{\"0-3\":{\"count\":198,\"p50\":"));
+    ASSERT_NE(std::string::npos, dump.find("},\"64+\":{\"count\":2,"));
+    ASSERT_EQ("}}}", dump.substr(dump.size() - 3));
+}
+
+TEST_F(Tests, generatedParserOrder)
+{
+    std::string input;
+    std::string name;
+    int count = 0;
+    bool flag = false;
+    PositionalFirstParser generatedParser(input, name, count, flag);
+
+    parse(generatedParser, {"exe", "-n", "NAME", "INPUT", "5", "-f"});
+    ASSERT_EQ("INPUT", input);
+    ASSERT_EQ("NAME", name);
+    ASSERT_EQ(5, count);
+    ASSERT_TRUE(flag);
+
+    std::string runtimeInput;
+    std::string runtimeName;
+    int runtimeCount = 0;
+    bool runtimeFlag = false;
+    Parser runtimeParser("Generated parser order test");
+    runtimeParser.addPositional(runtimeInput, "input", "Input");
+    runtimeParser.addParam(runtimeName, "name", 'n', "Name");
+    runtimeParser.addPositional(runtimeCount, "count", "Count", OPTIONAL);
+    runtimeParser.addFlag(runtimeFlag, "flag", 'f', "Flag");
+
+    const std::vector<std::vector<const char*>> commandLines = {
+        {"exe", "in", "-n", "a", "1", "-n", "b"},
+        {"exe", "in", "-n", "a", "1", "--name=b"},
+        {"exe", "in", "-n", "a", "1", "2"},
+    };
+    for (const auto& args : commandLines)
+    {
+        std::string runtimeError;
+        try
+        {
+            parse(runtimeParser, args);
+        }
+        catch (const Error& error)
+        {
+            runtimeError = error.what();
+        }
+
+        std::string generatedError;
+        try
+        {
+            parse(generatedParser, args);
+        }
+        catch (const Error& error)
+        {
+            generatedError = error.what();
+        }
+
+        ASSERT_FALSE(runtimeError.empty());
+        ASSERT_EQ(runtimeError, generatedError);
+    }
+}
+
 } // namespace
@@ -0,0 +1,977 @@
+// Command line argument parser
+//
+// Copyright 2020, Dmitry Tarakanov
+// SPDX-License-Identifier: MIT
+//
+// Generates a parser class specialized for a schema file, see cmd_line_args_generate() in
+// CMakeLists.txt. The generated class binds values like Parser, throws the same errors and prints
+// the same help, but has a perfect hash name table, switch based dispatch, inline converters and
+// static help text instead of the runtime registration.
+//
+// Usage: cmd-line-args-generator <schema> <class name> <output directory>
+//
+// Schema lines (# starts a comment):
+//   description "<description>"
+//   param <type> <long name> [-<short name>] "<help>" [optional]
+//   flag <long name> [-<short name>] "<help>"
+//   positional <type> <name> "<help>" [optional]
+// Types: bool, int, unsigned, long, double, string or any of them followed by [] for a list.
+//
+#include "over9000/cmd_line_args/parser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using over9000::cmd_line_args::Char;
+using over9000::cmd_line_args::Error;
+using over9000::cmd_line_args::OPTIONAL;
+using over9000::cmd_line_args::Parser;
+using over9000::cmd_line_args::REQUIRED;
+
+struct Param
+{
+    std::string type; // C++ value type
+    std::string longName;
+    char shortName = '\0';
+    std::string help;
+    bool optional = false;
+    bool flag = false;
+    bool list = false;
+    bool positional = false;
+    size_t positionalIndex = 0;
+    size_t schemaIndex = 0; // Declaration order in the schema
+};
+
+struct Schema
+{
+    std::string description;
+    std::vector<Param> params; // named params first, then positional ones
+};
+
+const std::pair<const char*, const char*> TYPES[] = {
+    {"bool", "bool"},
+    {"int", "int"},
+    {"unsigned", "unsigned"},
+    {"long", "long"},
+    {"double", "double"},
+    {"string", "std::string"},
+};
+
+std::vector<std::string> tokenize(const std::string& line, size_t lineNumber)
+{
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < line.size())
+    {
+        if (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r')
+        {
+            ++pos;
+        }
+        else if (line[pos] == '#')
+        {
+            break;
+        }
+        else if (line[pos] == '"')
+        {
+            std::string token;
+            for (++pos; pos < line.size() && line[pos] != '"'; ++pos)
+            {
+                if (line[pos] == '\\' && pos + 1 < line.size())
+                {
+                    ++pos;
+                }
+                token += line[pos];
+            }
+            if (pos == line.size())
+            {
+                throw Error() << "Line " << lineNumber << ": unterminated string";
+            }
+            ++pos;
+            tokens.push_back("\"" + token);
+        }
+        else
+        {
+            size_t end = line.find_first_of(" \t\r#", pos);
+            end = end == std::string::npos ? line.size() : end;
+            tokens.push_back(line.substr(pos, end - pos));
+            pos = end;
+        }
+    }
+    return tokens;
+}
+
+Schema readSchema(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw Error() << "Cannot open " << path;
+    }
+
+    Schema schema;
+    std::vector<Param> positional;
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        auto tokens = tokenize(line, lineNumber);
+        if (tokens.empty())
+        {
+            continue;
+        }
+
+        size_t pos = 0;
+        auto next = [&]() -> const std::string& {
+            if (pos == tokens.size())
+            {
+                throw Error() << "Line " << lineNumber << ": unexpected end of line";
+            }
+            return tokens[pos++];
+        };
+        auto quoted = [&] {
+            const auto& token = next();
+            if (token.empty() || token[0] != '"')
+            {
+                throw Error() << "Line " << lineNumber << ": expected a quoted string";
+            }
+            return token.substr(1);
+        };
+
+        const auto& kind = next();
+        if (kind == "description")
+        {
+            schema.description = quoted();
+        }
+        else if (kind == "param" || kind == "flag" || kind == "positional")
+        {
+            Param param;
+            param.schemaIndex = schema.params.size() + positional.size();
+            param.flag = kind == "flag";
+            param.positional = kind == "positional";
+
+            std::string type = param.flag ? "bool" : next();
+            if (type.size() > 2 && type.compare(type.size() - 2, 2, "[]") == 0)
+            {
+                param.list = true;
+                type.erase(type.size() - 2);
+            }
+            for (const auto& t : TYPES)
+            {
+                if (type == t.first)
+                {
+                    param.type = t.second;
+                }
+            }
+            if (param.type.empty())
+            {
+                throw Error() << "Line " << lineNumber << ": unknown type " << type;
+            }
+
+            param.longName = next();
+            if (!param.positional && pos < tokens.size() && tokens[pos].size() == 2 &&
+                tokens[pos][0] == '-')
+            {
+                param.shortName = next()[1];
+            }
+            param.help = quoted();
+            param.optional = param.flag;
+            if (pos < tokens.size() && tokens[pos] == "optional")
+            {
+                param.optional = true;
+                ++pos;
+            }
+
+            if (param.positional)
+            {
+                param.positionalIndex = positional.size();
+                positional.push_back(param);
+            }
+            else
+            {
+                schema.params.push_back(param);
+            }
+        }
+        else
+        {
+            throw Error() << "Line " << lineNumber << ": unknown kind " << kind;
+        }
+
+        if (pos != tokens.size())
+        {
+            throw Error() << "Line " << lineNumber << ": unexpected " << tokens[pos];
+        }
+    }
+
+    schema.params.insert(schema.params.end(), positional.begin(), positional.end());
+    return schema;
+}
+
+// Registers the schema in a runtime parser, which validates it and renders the help
+class RuntimeParser
+{
+public:
+    explicit RuntimeParser(const Schema& schema) : parser_(schema.description)
+    {
+        for (const auto& param : schema.params)
+        {
+            add<bool>(param, "bool") || add<int>(param, "int") ||
+                add<unsigned>(param, "unsigned") || add<long>(param, "long") ||
+                add<double>(param, "double") || add<std::string>(param, "std::string");
+        }
+    }
+
+    std::string params()
+    {
+        std::basic_ostringstream<Char> stream;
+        parser_.printParams(stream);
+        auto string = stream.str();
+        return {string.begin(), string.end()};
+    }
+
+private:
+    template<class T>
+    bool add(const Param& param, const char* type)
+    {
+        if (param.type != type)
+        {
+            return false;
+        }
+
+        auto paramType = param.optional ? OPTIONAL : REQUIRED;
+        if (param.list)
+        {
+            add(param, make<std::vector<T>>(), paramType);
+        }
+        else
+        {
+            add(param, make<T>(), paramType);
+        }
+        return true;
+    }
+
+    template<class T>
+    void add(const Param& param, T& value, over9000::cmd_line_args::ParamType type)
+    {
+        if (param.positional)
+        {
+            parser_.addPositional(value, param.longName, param.help, type);
+        }
+        else
+        {
+            parser_.addParam(value, param.longName, param.shortName, param.help, type);
+        }
+    }
+
+    void add(const Param& param, bool& value, over9000::cmd_line_args::ParamType type)
+    {
+        if (param.flag)
+        {
+            parser_.addFlag(value, param.longName, param.shortName, param.help);
+        }
+        else
+        {
+            add<bool>(param, value, type);
+        }
+    }
+
+    template<class T>
+    T& make()
+    {
+        auto value = std::make_shared<T>();
+        values_.push_back(value);
+        return *value;
+    }
+
+    Parser parser_;
+    std::vector<std::shared_ptr<void>> values_;
+};
+
+// Perfect hash of the long names: a name hash selects a bucket whose displacement maps the
+// names of the bucket to distinct slots
+struct PerfectHash
+{
+    uint32_t seed = 0;
+    std::vector<uint32_t> displacements;
+    std::vector<int> slots; // Param index or -1
+};
+
+uint32_t hashName(uint32_t seed, const std::string& name)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name)
+    {
+        hash ^= static_cast<uint32_t>(static_cast<Char>(c));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t mix(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+PerfectHash makePerfectHash(const Schema& schema)
+{
+    std::vector<size_t> named;
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        if (!schema.params[i].positional)
+        {
+            named.push_back(i);
+        }
+    }
+
+    uint32_t slotCount = 1;
+    while (slotCount < 2 * named.size())
+    {
+        slotCount *= 2;
+    }
+    auto bucketCount = static_cast<uint32_t>(std::max<size_t>(1, (named.size() + 3) / 4));
+
+    for (uint32_t seed = 0;; ++seed)
+    {
+        PerfectHash hash;
+        hash.seed = seed;
+        hash.displacements.assign(bucketCount, 0);
+        hash.slots.assign(slotCount, -1);
+
+        std::vector<std::vector<std::pair<uint32_t, int>>> buckets(bucketCount);
+        for (size_t i : named)
+        {
+            uint32_t h = hashName(seed, schema.params[i].longName);
+            buckets[h % bucketCount].emplace_back(h, static_cast<int>(i));
+        }
+
+        std::vector<uint32_t> order(bucketCount);
+        for (uint32_t i = 0; i < bucketCount; ++i)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        bool found = true;
+        for (uint32_t bucket : order)
+        {
+            found = false;
+            for (uint32_t displacement = 0; displacement < (1u << 16) && !found; ++displacement)
+            {
+                std::vector<uint32_t> slots;
+                for (const auto& key : buckets[bucket])
+                {
+                    uint32_t slot = mix(key.first ^ displacement) & (slotCount - 1);
+                    if (hash.slots[slot] != -1 ||
+                        std::find(slots.begin(), slots.end(), slot) != slots.end())
+                    {
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+
+                if (slots.size() == buckets[bucket].size())
+                {
+                    for (size_t i = 0; i < slots.size(); ++i)
+                    {
+                        hash.slots[slots[i]] = buckets[bucket][i].second;
+                    }
+                    hash.displacements[bucket] = displacement;
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                break;
+            }
+        }
+
+        if (found)
+        {
+            return hash;
+        }
+    }
+}
+
+std::string literal(const std::string& string)
+{
+    std::ostringstream output;
+    output << '"';
+    for (char c : string)
+    {
+        switch (c)
+        {
+        case '"':
+            output << "\\\"";
+            break;
+
+        case '\\':
+            output << "\\\\";
+            break;
+
+        case '\n':
+            output << "\\n";
+            break;
+
+        default:
+            if (static_cast<unsigned char>(c) < ' ' || static_cast<unsigned char>(c) > '~')
+            {
+                char octal[8];
+                std::snprintf(octal, sizeof(octal), "\\%03o", static_cast<unsigned char>(c));
+                output << octal;
+            }
+            else
+            {
+                output << c;
+            }
+        }
+    }
+    output << '"';
+    return output.str();
+}
+
+std::string charLiteral(char c)
+{
+    auto string = literal(std::string(1, c));
+    return "'" + (c == '\'' ? "\\'" : string.substr(1, string.size() - 2)) + "'";
+}
+
+// Returns a literal split into lines
+std::string multilineLiteral(const std::string& string, const char* indent)
+{
+    std::string result;
+    size_t pos = 0;
+    while (pos < string.size())
+    {
+        size_t end = string.find('\n', pos);
+        end = end == std::string::npos ? string.size() : end + 1;
+        result += (pos == 0 ? "" : std::string("\n") + indent) +
+                  literal(string.substr(pos, end - pos));
+        pos = end;
+    }
+    return result.empty() ? "\"\"" : result;
+}
+
+// Returns the name as printed in errors
+std::string displayName(const Param& param)
+{
+    std::string name;
+    if (param.positional && param.positionalIndex != 0)
+    {
+        name = "#" + std::to_string(param.positionalIndex) + " ";
+    }
+    else if (param.shortName != '\0')
+    {
+        name = std::string("-") + param.shortName + "/";
+    }
+    return name + "--" + param.longName;
+}
+
+std::string boolArray(const Schema& schema, bool Param::*field)
+{
+    std::string result;
+    for (const auto& param : schema.params)
+    {
+        result += (result.empty() ? "" : ", ") + std::string(param.*field ? "true" : "false");
+    }
+    return result;
+}
+
+std::string valueType(const Param& param)
+{
+    return param.list ? "std::vector<" + param.type + ">" : param.type;
+}
+
+// Returns the parameters in the schema order, the order of the constructor arguments
+std::vector<const Param*> boundParams(const Schema& schema)
+{
+    std::vector<const Param*> bound;
+    for (const auto& param : schema.params)
+    {
+        bound.push_back(&param);
+    }
+    std::sort(bound.begin(), bound.end(), [](const Param* lhs, const Param* rhs) {
+        return lhs->schemaIndex < rhs->schemaIndex;
+    });
+    return bound;
+}
+
+void writeHeader(std::ostream& output, const Schema& schema, const std::string& className,
+                 const std::string& schemaName)
+{
+    auto bound = boundParams(schema);
+
+    output << "// Generated by cmd-line-args-generator from " << schemaName << ", do not edit\n"
+           << "//\n"
+           << "#pragma once\n"
+           << "\n"
+           << "#include \"over9000/cmd_line_args/parser.h\"\n"
+           << "\n"
+           << "#include <array>\n"
+           << "#include <ostream>\n"
+           << "#include <sstream>\n"
+           << "#include <string>\n"
+           << "#include <vector>\n"
+           << "\n"
+           << "/// Command line arguments parser generated from " << schemaName << ".\n"
+           << "///\n"
+           << "class " << className << "\n"
+           << "{\n"
+           << "public:\n"
+           << "    using Char = over9000::cmd_line_args::Char;\n"
+           << "\n"
+           << "    /// Binds the parameters in the schema order.\n"
+           << "    ///\n"
+           << "    explicit " << className << "(";
+    for (size_t i = 0; i < bound.size(); ++i)
+    {
+        auto index = static_cast<size_t>(bound[i] - schema.params.data());
+        output << (i == 0 ? "" : ",\n        ") << valueType(*bound[i]) << "& value" << index
+               << " /* " << displayName(*bound[i]) << " */";
+    }
+    output << ");\n"
+           << "\n"
+           << "    /// Parses the command line arguments.\n"
+           << "    ///\n"
+           << "    void parse(int argc, const Char* const argv[]);\n"
+           << "\n"
+           << "    /// Prints full help on all parameters.\n"
+           << "    ///\n"
+           << "    void printHelp(std::basic_ostream<Char>& stream);\n"
+           << "\n"
+           << "    /// Prints the program description.\n"
+           << "    ///\n"
+           << "    void printDescription(std::basic_ostream<Char>& stream);\n"
+           << "\n"
+           << "    /// Prints command line usage.\n"
+           << "    ///\n"
+           << "    void printUsage(std::basic_ostream<Char>& stream);\n"
+           << "\n"
+           << "    /// Prints command line parameters.\n"
+           << "    ///\n"
+           << "    void printParams(std::basic_ostream<Char>& stream);\n"
+           << "\n"
+           << "private:\n"
+           << "    void parseArg(int param, const Char* begin, const Char* end,\n"
+           << "                  std::basic_stringstream<Char>& stream);\n"
+           << "\n";
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        output << "    " << valueType(schema.params[i]) << "& value" << i << "_;\n";
+    }
+    output << "    std::array<bool, " << schema.params.size() << "> parsed_{};\n"
+           << "    std::basic_string<Char> exeName_;\n"
+           << "    std::vector<over9000::cmd_line_args::details::Token> tokens_;\n"
+           << "};\n";
+}
+
+void writeSource(std::ostream& output, const Schema& schema, const std::string& className,
+                 const std::string& schemaName, const std::string& headerName)
+{
+    auto hash = makePerfectHash(schema);
+    RuntimeParser runtimeParser(schema);
+
+    std::vector<size_t> positional;
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        if (schema.params[i].positional)
+        {
+            positional.push_back(i);
+        }
+    }
+
+    output << "// Generated by cmd-line-args-generator from " << schemaName << ", do not edit\n"
+           << "//\n"
+           << "#include \"" << headerName << "\"\n"
+           << "\n"
+           << "#include <cstdint>\n"
+           << "#include <iterator>\n"
+           << "#include <utility>\n"
+           << "\n"
+           << "namespace {\n"
+           << "\n"
+           << "using over9000::cmd_line_args::Char;\n"
+           << "using over9000::cmd_line_args::Error;\n"
+           << "namespace details = over9000::cmd_line_args::details;\n"
+           << "\n"
+           << "const size_t POSITIONAL_COUNT = " << positional.size() << ";\n"
+           << "const int POSITIONALS[] = {";
+    for (size_t i : positional)
+    {
+        output << i << ", ";
+    }
+    output << "-1};\n"
+           << "\n"
+           << "const bool IS_LIST[] = {" << boolArray(schema, &Param::list) << "};\n"
+           << "const bool IS_FLAG[] = {" << boolArray(schema, &Param::flag) << "};\n"
+           << "const bool IS_OPTIONAL[] = {" << boolArray(schema, &Param::optional) << "};\n"
+           << "const bool IS_POSITIONAL[] = {" << boolArray(schema, &Param::positional) << "};\n"
+           << "\n"
+           << "// Names as printed in errors\n"
+           << "const char* const NAMES[] = {\n";
+    for (const auto& param : schema.params)
+    {
+        output << "    " << literal(displayName(param)) << ",\n";
+    }
+    output << "};\n"
+           << "\n"
+           << "const char* const BAD_ARGUMENT[] = {\n";
+    for (const auto& param : schema.params)
+    {
+        output << "    "
+               << (param.positional && param.positionalIndex != 0 ? "\"Bad positional argument \""
+                                                                  : "\"Bad argument \"")
+               << ",\n";
+    }
+    output << "};\n"
+           << "\n"
+           << "const uint32_t HASH_SEED = " << hash.seed << "u;\n"
+           << "const uint32_t BUCKET_COUNT = " << hash.displacements.size() << ";\n"
+           << "const uint32_t DISPLACEMENTS[] = {";
+    for (size_t i = 0; i < hash.displacements.size(); ++i)
+    {
+        output << (i % 12 == 0 ? "\n    " : " ") << hash.displacements[i] << "u,";
+    }
+    output << "\n};\n"
+           << "\n"
+           << "struct Slot\n"
+           << "{\n"
+           << "    const char* name;\n"
+           << "    uint32_t size;\n"
+           << "    int param;\n"
+           << "};\n"
+           << "\n"
+           << "const uint32_t SLOT_MASK = " << hash.slots.size() - 1 << ";\n"
+           << "const Slot SLOTS[] = {\n";
+    for (int param : hash.slots)
+    {
+        if (param < 0)
+        {
+            output << "    {nullptr, 0, -1},\n";
+        }
+        else
+        {
+            const auto& name = schema.params[static_cast<size_t>(param)].longName;
+            output << "    {" << literal(name) << ", " << name.size() << ", " << param << "},\n";
+        }
+    }
+    output << "};\n"
+           << "\n"
+           << "uint32_t mix(uint32_t hash)\n"
+           << "{\n"
+           << "    hash ^= hash >> 16;\n"
+           << "    hash *= 0x85ebca6bu;\n"
+           << "    hash ^= hash >> 13;\n"
+           << "    hash *= 0xc2b2ae35u;\n"
+           << "    hash ^= hash >> 16;\n"
+           << "    return hash;\n"
+           << "}\n"
+           << "\n"
+           << "int findLongName(const Char* begin, const Char* end)\n"
+           << "{\n"
+           << "    uint32_t hash = 2166136261u ^ HASH_SEED;\n"
+           << "    for (const Char* c = begin; c != end; ++c)\n"
+           << "    {\n"
+           << "        hash ^= static_cast<uint32_t>(*c);\n"
+           << "        hash *= 16777619u;\n"
+           << "    }\n"
+           << "\n"
+           << "    const Slot& slot = SLOTS[mix(hash ^ DISPLACEMENTS[hash % BUCKET_COUNT]) & "
+              "SLOT_MASK];\n"
+           << "    if (slot.name == nullptr || slot.size != static_cast<uint32_t>(end - begin))\n"
+           << "    {\n"
+           << "        return -1;\n"
+           << "    }\n"
+           << "\n"
+           << "    for (uint32_t i = 0; i < slot.size; ++i)\n"
+           << "    {\n"
+           << "        if (begin[i] != static_cast<Char>(slot.name[i]))\n"
+           << "        {\n"
+           << "            return -1;\n"
+           << "        }\n"
+           << "    }\n"
+           << "    return slot.param;\n"
+           << "}\n"
+           << "\n"
+           << "int findShortName(Char name)\n"
+           << "{\n"
+           << "    switch (name)\n"
+           << "    {\n";
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        if (schema.params[i].shortName != '\0')
+        {
+            output << "    case " << charLiteral(schema.params[i].shortName) << ":\n"
+                   << "        return " << i << ";\n";
+        }
+    }
+    output << "    default:\n"
+           << "        return -1;\n"
+           << "    }\n"
+           << "}\n"
+           << "\n"
+           << "const char DESCRIPTION[] = " << literal(schema.description) << ";\n"
+           << "\n"
+           << "const char PARAMS[] = " << multilineLiteral(runtimeParser.params(), "    ")
+           << ";\n"
+           << "\n"
+           << "const char* const USAGES[] = {\n";
+    for (const auto& param : schema.params)
+    {
+        auto usage = param.positional
+                         ? over9000::cmd_line_args::details::positionalUsage(
+                               param.longName, param.optional, param.list)
+                         : over9000::cmd_line_args::details::namedUsage(
+                               param.longName, param.shortName, param.optional, param.flag,
+                               param.list);
+        output << "    " << literal(usage) << ",\n";
+    }
+    output << "};\n"
+           << "\n"
+           << "} // namespace\n"
+           << "\n"
+           << className << "::" << className << "(";
+    auto bound = boundParams(schema);
+    for (size_t i = 0; i < bound.size(); ++i)
+    {
+        auto index = static_cast<size_t>(bound[i] - schema.params.data());
+        output << (i == 0 ? "" : ", ") << valueType(*bound[i]) << "& value" << index;
+    }
+    output << ")\n";
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        output << (i == 0 ? "    : " : "    , ") << "value" << i << "_(value" << i << ")\n";
+    }
+    output << "{\n"
+           << "}\n"
+           << "\n"
+           << "void " << className << "::parse(int argc, const Char* const argv[])\n"
+           << "{\n"
+           << "    exeName_ = argv[0];\n"
+           << "\n"
+           << "#ifdef _WIN32\n"
+           << "    auto slashPos = exeName_.find_last_of(L\"\\\\/\");\n"
+           << "#else\n"
+           << "    auto slashPos = exeName_.find_last_of(\"/\");\n"
+           << "#endif //_WIN32\n"
+           << "\n"
+           << "    if (slashPos != std::basic_string<Char>::npos)\n"
+           << "    {\n"
+           << "        exeName_.erase(0, slashPos + 1);\n"
+           << "    }\n"
+           << "\n"
+           << "    parsed_.fill(false);\n"
+           << "\n"
+           << "    details::classify(argc, argv, over9000::cmd_line_args::Limits(), tokens_);\n"
+           << "\n"
+           << "    static const Char flagValue[] = {'1'};\n"
+           << "\n"
+           << "    std::basic_stringstream<Char> stream;\n"
+           << "    size_t currentPositionalPos = 0;\n"
+           << "    int currentNamedParam = -1;\n"
+           << "    for (const auto& token : tokens_)\n"
+           << "    {\n"
+           << "        const Char* arg = token.arg;\n"
+           << "        const Char* argEnd = token.arg + token.size;\n"
+           << "\n"
+           << "        if (currentNamedParam >= 0)\n"
+           << "        {\n"
+           << "            parseArg(currentNamedParam, arg, argEnd, stream);\n"
+           << "            currentNamedParam = -1;\n"
+           << "            continue;\n"
+           << "        }\n"
+           << "\n"
+           << "        int param = -1;\n"
+           << "        switch (token.kind)\n"
+           << "        {\n"
+           << "        case details::TokenKind::SHORT:\n"
+           << "            param = findShortName(arg[1]);\n"
+           << "            break;\n"
+           << "\n"
+           << "        case details::TokenKind::LONG:\n"
+           << "            param = findLongName(arg + 2, argEnd);\n"
+           << "            break;\n"
+           << "\n"
+           << "        case details::TokenKind::LONG_WITH_VALUE:\n"
+           << "            param = findLongName(arg + 2, arg + token.equalPos);\n"
+           << "            break;\n"
+           << "\n"
+           << "        case details::TokenKind::VALUE:\n"
+           << "            break;\n"
+           << "        }\n"
+           << "\n"
+           << "        if (param >= 0 && (!parsed_[param] || IS_LIST[param]))\n"
+           << "        {\n"
+           << "            if (token.kind == details::TokenKind::LONG_WITH_VALUE)\n"
+           << "            {\n"
+           << "                parseArg(param, arg + token.equalPos + 1, argEnd, stream);\n"
+           << "            }\n"
+           << "            else if (IS_FLAG[param])\n"
+           << "            {\n"
+           << "                parseArg(param, flagValue, flagValue + 1, stream);\n"
+           << "            }\n"
+           << "            else\n"
+           << "            {\n"
+           << "                currentNamedParam = param;\n"
+           << "            }\n"
+           << "            continue;\n"
+           << "        }\n"
+           << "\n"
+           << "        if (currentPositionalPos >= POSITIONAL_COUNT)\n"
+           << "        {\n"
+           << "            if (param >= 0)\n"
+           << "            {\n"
+           << "                throw Error() << \"Repeated argument: \" << NAMES[param];\n"
+           << "            }\n"
+           << "            throw Error() << \"Unexpected argument: \" << arg;\n"
+           << "        }\n"
+           << "\n"
+           << "        int positional = POSITIONALS[currentPositionalPos];\n"
+           << "        parseArg(positional, arg, argEnd, stream);\n"
+           << "        if (!IS_LIST[positional])\n"
+           << "        {\n"
+           << "            ++currentPositionalPos;\n"
+           << "        }\n"
+           << "    }\n"
+           << "\n"
+           << "    for (size_t i = 0; i < parsed_.size(); ++i)\n"
+           << "    {\n"
+           << "        if (!parsed_[i] && !IS_OPTIONAL[i])\n"
+           << "        {\n"
+           << "            throw Error() << (IS_POSITIONAL[i] ? \"Missing positional argument \"\n"
+           << "                                               : \"Missing argument: \")\n"
+           << "                          << NAMES[i];\n"
+           << "        }\n"
+           << "    }\n"
+           << "}\n"
+           << "\n"
+           << "void " << className << "::parseArg(int param, const Char* begin, const Char* end,\n"
+           << "                  std::basic_stringstream<Char>& stream)\n"
+           << "{\n"
+           << "    bool ok = false;\n"
+           << "    switch (param)\n"
+           << "    {\n";
+    for (size_t i = 0; i < schema.params.size(); ++i)
+    {
+        const auto& param = schema.params[i];
+        output << "    case " << i << ":\n"
+               << "    {\n"
+               << "        details::Converter<" << param.type << "> converter;\n";
+        if (param.list)
+        {
+            output << "        if (!parsed_[" << i << "])\n"
+                   << "        {\n"
+                   << "            value" << i << "_.clear();\n"
+                   << "        }\n"
+                   << "        " << param.type << " value{};\n"
+                   << "        ok = details::convert(converter, begin, end, stream, value);\n"
+                   << "        if (ok)\n"
+                   << "        {\n"
+                   << "            value" << i << "_.push_back(std::move(value));\n"
+                   << "        }\n";
+        }
+        else
+        {
+            output << "        ok = details::convert(converter, begin, end, stream, value" << i
+                   << "_);\n";
+        }
+        output << "        break;\n"
+               << "    }\n";
+    }
+    output << "    }\n"
+           << "\n"
+           << "    parsed_[static_cast<size_t>(param)] = true;\n"
+           << "    if (!ok)\n"
+           << "    {\n"
+           << "        throw Error() << BAD_ARGUMENT[param] << NAMES[param] << \": \"\n"
+           << "                      << std::basic_string<Char>(begin, end);\n"
+           << "    }\n"
+           << "}\n"
+           << "\n"
+           << "void " << className << "::printHelp(std::basic_ostream<Char>& stream)\n"
+           << "{\n"
+           << "    printDescription(stream);\n"
+           << "    printUsage(stream);\n"
+           << "    printParams(stream);\n"
+           << "}\n"
+           << "\n"
+           << "void " << className << "::printDescription(std::basic_ostream<Char>& stream)\n"
+           << "{\n"
+           << "    stream << details::fromASCII(DESCRIPTION) << \"\\n\\n\";\n"
+           << "}\n"
+           << "\n"
+           << "void " << className << "::printUsage(std::basic_ostream<Char>& stream)\n"
+           << "{\n"
+           << "    details::printUsage(stream, exeName_,\n"
+           << "                        std::vector<std::string>(std::begin(USAGES), "
+              "std::end(USAGES)));\n"
+           << "}\n"
+           << "\n"
+           << "void " << className << "::printParams(std::basic_ostream<Char>& stream)\n"
+           << "{\n"
+           << "    stream << details::fromASCII(PARAMS);\n"
+           << "}\n";
+}
+
+void write(const std::string& path, const std::string& content)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    if (!file)
+    {
+        throw Error() << "Cannot write " << path;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) try
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: cmd-line-args-generator <schema> <class name> <output directory>\n";
+        return 1;
+    }
+
+    std::string schemaPath = argv[1];
+    std::string className = argv[2];
+    std::string outputDir = argv[3];
+
+    auto schema = readSchema(schemaPath);
+    if (schema.params.empty())
+    {
+        throw Error() << "No parameters in " << schemaPath;
+    }
+
+    auto schemaName = schemaPath.substr(schemaPath.find_last_of("\\/") + 1);
+    auto name = schemaName.substr(0, schemaName.find('.'));
+
+    std::ostringstream header;
+    writeHeader(header, schema, className, schemaName);
+
+    std::ostringstream source;
+    writeSource(source, schema, className, schemaName, name + ".h");
+
+    write(outputDir + "/" + name + ".h", header.str());
+    write(outputDir + "/" + name + ".cpp", source.str());
+    return 0;
+}
+catch (const std::exception& e)
+{
+    std::cerr << argv[1] << ": " << e.what() << std::endl;
+    return 1;
+}